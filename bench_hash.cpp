@@ -2,20 +2,29 @@
 #include <iostream>
 #include <vector>
 
-#include <papi.h>
-
 #include "common/arg_parser.h"
 #include "common/benchmark.h"
 #include "common/comparison.h"
 #include "common/contenders.h"
+#include "common/devirtualize.h"
+#include "common/displacement.h"
 #include "common/experiments.h"
 #include "common/hack.h"
 #include "common/instrumentation.h"
+#include "common/latency.h"
+#include "common/perf_instrumentation.h"
+#include "common/scheduler.h"
+#include "common/statistics.h"
 
+#include "hashtable/cuckoo_pages.h"
 #include "hashtable/dense_hash_map.h"
+#include "hashtable/lockfree_linear_probing.h"
+#include "hashtable/robin_hood.h"
 #include "hashtable/sparse_hash_map.h"
+#include "hashtable/swiss_table.h"
 #include "hashtable/unordered_map.h"
 #include "hashtable/microbenchmark.h"
+#include "hashtable/relational.h"
 #include "hashtable/wordcount.h"
 
 void usage(char* name) {
@@ -25,39 +34,132 @@ void usage(char* name) {
          << "Options:" << endl
          << "-a            append results instead of replacing" << endl
          << "-o <filename> result serialization filename (default: data_hash.txt)" << endl
+         << "-ow <filename> result serialization filename for wordcount" << endl
+         << "              (default: data_hash_wordcount.txt)" << endl
+         << "-or <filename> result serialization filename for group-by and hash join" << endl
+         << "              (default: data_hash_relational.txt)" << endl
          << "-p <prefix>   result filename prefix (default: results_hash_)" << endl
-         << "-n <int>      number of repetitions for each benchmark (default: 1)" << endl
+         << "-n <int>      number of repetitions for each benchmark (default: 1), or the" << endl
+         << "              minimum number with -ci or -tb (default: 5)" << endl
+         << "-ci <double>  repeat until the 95% confidence interval of the median of the" << endl
+         << "              first result component (e.g. the time) is at most this wide," << endl
+         << "              relative to the median, e.g. 0.02" << endl
+         << "-tb <double>  time budget in seconds for the repetitions of a configuration." << endl
+         << "              Without -ci, repeat until it's used up" << endl
+         << "-nmax <int>   maximum number of repetitions with -ci or -tb (default: 100)" << endl
          << "-c <double>   cutoff, at which difference ratio to stop printing (deafult: 1.01)" << endl
          << "-m <int>      maximum number of differences to print (default: 25)" << endl
          << "-b <int>      which contender to compare to the others (default: 0)" << endl
+         << "-j <int>      run the benchmarks on this many worker processes, each" << endl
+         << "              pinned to a physical core of its own (default: 1)" << endl
+         << "-ja <keys>    benchmarks (comma-separated keys) that need the memory" << endl
+         << "              bandwidth to themselves, run while the other workers wait" << endl
+         << "-nW           skip the wordcount benchmarks" << endl
+         << "-nR           skip the group-by and hash join benchmarks" << endl
+         << "-nL           skip wordcount on the large synthetic texts (10^7 distinct words)" << endl
+         << "              and group-by and hash join on tables of millions of elements" << endl
          << endl
          << "Instrumentation options:" << endl
          << "-nt           disable timer instrumentation" << endl
-         << "-np           disable all PAPI instrumentations" << endl
-         << "-npc          disable PAPI cache instrumentation" << endl
-         << "-npi          disable PAPI instruction instrumentation" << endl;
+         << "-nl           disable per-operation latency instrumentation" << endl
+         << "-nd           disable displacement instrumentation (Robin Hood hashing)" << endl
+         << "-np           disable all hardware counter instrumentations" << endl
+         << "-npc          disable cache counter instrumentations" << endl
+         << "-npi          disable instruction counter instrumentations" << endl
+         << "-e <events>   count these perf events, separated by commas. Groups of" << endl
+         << "              events are separated by slashes, e.g." << endl
+         << "              cycles,instructions/LLC-loads,LLC-load-misses" << endl;
     exit(0);
 }
 
+#ifdef DEVIRTUALIZE
+// The contender types to run again without virtual calls
+template <typename Runner>
+void add_devirtualized(Runner &devirtualized) {
+    devirtualized.template add<hashtable::unordered_map<int, int>>("std::unordered_map", "std::unordered-map");
+    devirtualized.template add<hashtable::dense_hash_map<int, int>>("dense_hash_map", "dense-hash-map");
+#ifdef __SSE2__
+    devirtualized.template add<hashtable::swiss_table<int, int, hashtable::swiss::sse2_group>>(
+        "Swiss table (SSE2)", "swiss-table-sse2");
+#endif
+    devirtualized.template add<hashtable::robin_hood<int, int, 80>>("Robin Hood (max load 80%)", "robin-hood-80");
+    devirtualized.template add<hashtable::cuckoo_pages<int, int, 2, 64, 4>>(
+        "Cuckoo with pages (2 cells + backup, 64B pages, stash 4)", "cuckoo-pages-c2-p64-s4");
+    devirtualized.template add<hashtable::lockfree_linear_probing<int, int>>(
+        "lock-free linear probing (growing, max load 50%)", "lockfree-linear-probing");
+}
+#endif
+
+// Run benchmarks that have a configuration type of their own, with a result
+// set of their own. Suite is their class template, for the devirtualized runs,
+// and large tells whether its large benchmarks were registered.
+template <typename Configuration, template <typename> class Suite, typename HashTable>
+void run_separately(common::contender_list<HashTable> &contenders,
+                    common::contender_list<common::instrumentation> &instrumentations,
+                    common::contender_list<common::benchmark<HashTable, Configuration>> &benchmarks,
+                    const common::repetition_policy &repetitions,
+                    const std::string &resultfn_prefix,
+                    const std::string &serializationfn, bool append_results,
+                    double cutoff, int max_results, int base_contender,
+                    __attribute__((unused)) bool large, const common::schedule &schedule)
+{
+    std::vector<std::vector<common::benchmark_result_aggregate>> results;
+    common::experiment_runner<HashTable, Configuration> runner(contenders, instrumentations, benchmarks, results);
+    runner.run(repetitions, resultfn_prefix, true, schedule);
+
+#ifdef DEVIRTUALIZE
+    common::devirtualized_runner<Configuration, Suite> devirtualized(instrumentations, results, large);
+    add_devirtualized(devirtualized);
+    devirtualized.run(repetitions, resultfn_prefix, schedule);
+#endif
+
+    if (contenders.size() > 1) {
+        common::comparison comparison(results, base_contender);
+        comparison.compare();
+        comparison.print(std::cout, cutoff, max_results);
+    }
+
+    runner.serialize(serializationfn, append_results);
+    runner.shutdown();
+}
+
 int main(int argc, char** argv) {
     // Parse command-line arguments
     common::arg_parser args(argc, argv);
     if (args.is_set("h") || args.is_set("-help")) usage(argv[0]);
     const std::string resultfn_prefix = args.get<std::string>("p", "results_hash_"),
-                      serializationfn = args.get<std::string>("o", "data_hash.txt");
-    const int repetitions    = args.get<int>("n", 1),
-              max_results    = args.get<int>("m", 25),
+                      serializationfn = args.get<std::string>("o", "data_hash.txt"),
+                      serializationfn_wordcount = args.get<std::string>("ow", "data_hash_wordcount.txt"),
+                      serializationfn_relational = args.get<std::string>("or", "data_hash_relational.txt");
+    const common::repetition_policy repetitions = (args.is_set("ci") || args.is_set("tb"))
+        ? common::repetition_policy::adaptive(args.get<double>("ci", 0), args.get<double>("tb", 0) * 1000,
+                                              args.get<size_t>("n", 5), args.get<size_t>("nmax", 100))
+        : common::repetition_policy(args.get<size_t>("n", 1));
+    const int max_results    = args.get<int>("m", 25),
               base_contender = args.get<int>("b", 0);
     const double cutoff = args.get<double>("c", 1.01);
     __attribute__((unused)) // don't warn when compiling malloc target
-    const bool disable_timer      = args.is_set("nt"),
-               disable_papi_cache = args.is_set("npc") || args.is_set("np"),
-               disable_papi_instr = args.is_set("npi") || args.is_set("np"),
+    const bool disable_timer          = args.is_set("nt"),
+               disable_latency        = args.is_set("nl"),
+               disable_displacement   = args.is_set("nd"),
+               disable_cache_counters = args.is_set("npc") || args.is_set("np"),
+               disable_instr_counters = args.is_set("npi") || args.is_set("np"),
+               disable_wordcount      = args.is_set("nW"),
+               disable_relational     = args.is_set("nR"),
+               disable_large          = args.is_set("nL"),
                append_results = args.is_set("a");
+    const std::string perf_events = args.get<std::string>("e", "");
+    common::schedule schedule;
+    schedule.workers = args.get<size_t>("j", 1);
+    schedule.alone = common::schedule::parse_keys(args.get<std::string>("ja", ""));
 
     using HashTable = hashtable::hashtable<int, int>;
-    using Configuration = std::pair<size_t, size_t>;
+    using Configuration = common::key_configuration;
     using Benchmark = common::benchmark<HashTable, Configuration>;
+    using CorpusConfiguration = common::corpus_configuration;
+    using WordcountBenchmark = common::benchmark<HashTable, CorpusConfiguration>;
+    using RelationalConfiguration = common::relational_configuration;
+    using RelationalBenchmark = common::benchmark<HashTable, RelationalConfiguration>;
 
     // Set up data structure contenders
     common::contender_list<HashTable> contenders;
@@ -68,10 +170,29 @@ int main(int argc, char** argv) {
     hashtable::dense_hash_map<int, int>::register_contenders(contenders);
     hashtable::sparse_hash_map<int, int>::register_contenders(contenders);
 
+    // Open addressing with SIMD group probing on control bytes
+    hashtable::swiss_table<int, int>::register_contenders(contenders);
+
+    // Linear probing with Robin Hood insertion and backward-shift deletion
+    hashtable::robin_hood<int, int>::register_contenders(contenders);
+
+    // Cuckoo hashing with cache-line sized pages
+    hashtable::cuckoo_pages<int, int>::register_contenders(contenders);
+
+    // Lock-free linear probing on packed 64-bit cells with cooperative growing
+    hashtable::lockfree_linear_probing<int, int>::register_contenders(contenders);
+
     // Register Benchmarks
     common::contender_list<Benchmark> benchmarks;
     hashtable::microbenchmark<HashTable>::register_benchmarks(benchmarks);
-    hashtable::wordcount<HashTable>::register_benchmarks(benchmarks);
+
+    // wordcount, group-by and hash join have configuration types of their
+    // own, so they run separately
+    common::contender_list<WordcountBenchmark> wordcount_benchmarks;
+    common::register_suite<hashtable::wordcount<HashTable>>(wordcount_benchmarks, !disable_large);
+
+    common::contender_list<RelationalBenchmark> relational_benchmarks;
+    common::register_suite<hashtable::relational<HashTable>>(relational_benchmarks, !disable_large);
 
     // Register instrumentations
     common::contender_list<common::instrumentation> instrumentations;
@@ -80,13 +201,38 @@ int main(int argc, char** argv) {
     instrumentations.register_contender("timer", "timer",
         [](){ return new common::timer_instrumentation(); });
 
-    if (!disable_papi_cache)
+    if (!disable_latency)
+    instrumentations.register_contender("latency", "latency",
+        [](){ return new common::latency_instrumentation(); });
+
+    if (!disable_displacement)
+    instrumentations.register_contender("displacement", "displacement",
+        [](){ return new common::displacement_instrumentation(); });
+
+    if (!disable_cache_counters)
+    instrumentations.register_contender("perf cache", "perf_cache",
+        [](){ return common::perf_instrumentation_cache(); });
+
+    if (!disable_instr_counters)
+    instrumentations.register_contender("perf instruction", "perf_instr",
+        [](){ return common::perf_instrumentation_instr(); });
+
+    if (!perf_events.empty()) {
+        // Check the event names before running anything
+        const auto groups = common::perf_event::parse_groups(perf_events);
+        instrumentations.register_contender("perf " + perf_events, "perf",
+            [groups](){ return new common::perf_instrumentation(groups); });
+    }
+
+#ifdef WITH_PAPI
+    if (!disable_cache_counters)
     instrumentations.register_contender("PAPI cache", "PAPI_cache",
         [](){ return new common::papi_instrumentation_cache(); });
 
-    if (!disable_papi_instr)
+    if (!disable_instr_counters)
     instrumentations.register_contender("PAPI instruction", "PAPI_instr",
         [](){ return new common::papi_instrumentation_instr(); });
+#endif
 #else
     instrumentations.register_contender("memory usage", "memory",
         [](){ return new common::memory_instrumentation(); });
@@ -96,7 +242,15 @@ int main(int argc, char** argv) {
 
     // Run the benchmarks
     common::experiment_runner<HashTable, Configuration> runner(contenders, instrumentations, benchmarks, results);
-    runner.run(repetitions, resultfn_prefix);
+    runner.run(repetitions, resultfn_prefix, false, schedule);
+
+#ifdef DEVIRTUALIZE
+    // Run the benchmarks again, instantiated for each concrete contender type
+    common::devirtualized_runner<Configuration, hashtable::microbenchmark>
+        devirtualized(instrumentations, results);
+    add_devirtualized(devirtualized);
+    devirtualized.run(repetitions, resultfn_prefix, schedule);
+#endif
 
     // Evaluate the result
     if (contenders.size() > 1) {
@@ -108,5 +262,15 @@ int main(int argc, char** argv) {
     // Serialize results to disk for further evaluation
     runner.serialize(serializationfn, append_results);
 
+    if (!disable_wordcount)
+        run_separately<CorpusConfiguration, hashtable::wordcount>(
+            contenders, instrumentations, wordcount_benchmarks, repetitions, resultfn_prefix,
+            serializationfn_wordcount, append_results, cutoff, max_results, base_contender, !disable_large, schedule);
+
+    if (!disable_relational)
+        run_separately<RelationalConfiguration, hashtable::relational>(
+            contenders, instrumentations, relational_benchmarks, repetitions, resultfn_prefix,
+            serializationfn_relational, append_results, cutoff, max_results, base_contender, !disable_large, schedule);
+
     runner.shutdown();
 }
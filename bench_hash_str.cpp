@@ -0,0 +1,196 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/arg_parser.h"
+#include "common/benchmark.h"
+#include "common/comparison.h"
+#include "common/contenders.h"
+#include "common/experiments.h"
+#include "common/hack.h"
+#include "common/instrumentation.h"
+#include "common/latency.h"
+#include "common/perf_instrumentation.h"
+#include "common/scheduler.h"
+#include "common/statistics.h"
+#include "common/string_view.h"
+
+#include "hashtable/cuckoo_pages.h"
+#include "hashtable/dense_hash_map.h"
+#include "hashtable/robin_hood.h"
+#include "hashtable/swiss_table.h"
+#include "hashtable/unordered_map.h"
+#include "hashtable/wordcount.h"
+
+void usage(char* name) {
+    using std::cout;
+    using std::endl;
+    cout << "Usage: " << name << " <options>" << endl << endl
+         << "Counts the words of the wordcount texts with the words themselves as keys," << endl
+         << "once as std::string and once as string_view into the text." << endl << endl
+         << "Options:" << endl
+         << "-a            append results instead of replacing" << endl
+         << "-o <filename> result serialization filename for std::string keys" << endl
+         << "              (default: data_hash_str.txt)" << endl
+         << "-ov <filename> result serialization filename for string_view keys" << endl
+         << "              (default: data_hash_str_view.txt)" << endl
+         << "-p <prefix>   result filename prefix (default: results_hash_str_)" << endl
+         << "-n <int>      number of repetitions for each benchmark (default: 1), or the" << endl
+         << "              minimum number with -ci or -tb (default: 5)" << endl
+         << "-ci <double>  repeat until the 95% confidence interval of the median of the" << endl
+         << "              first result component (e.g. the time) is at most this wide," << endl
+         << "              relative to the median, e.g. 0.02" << endl
+         << "-tb <double>  time budget in seconds for the repetitions of a configuration." << endl
+         << "              Without -ci, repeat until it's used up" << endl
+         << "-nmax <int>   maximum number of repetitions with -ci or -tb (default: 100)" << endl
+         << "-c <double>   cutoff, at which difference ratio to stop printing (deafult: 1.01)" << endl
+         << "-m <int>      maximum number of differences to print (default: 25)" << endl
+         << "-b <int>      which contender to compare to the others (default: 0)" << endl
+         << "-j <int>      run the benchmarks on this many worker processes, each" << endl
+         << "              pinned to a physical core of its own (default: 1)" << endl
+         << "-ja <keys>    benchmarks (comma-separated keys) that need the memory" << endl
+         << "              bandwidth to themselves, run while the other workers wait" << endl
+         << "-ns           skip the std::string keys" << endl
+         << "-nv           skip the string_view keys" << endl
+         << "-nL           skip the large synthetic texts (10^7 distinct words)" << endl
+         << endl
+         << "Instrumentation options:" << endl
+         << "-nt           disable timer instrumentation" << endl
+         << "-nl           disable per-operation latency instrumentation" << endl
+         << "-np           disable all hardware counter instrumentations" << endl
+         << "-npc          disable cache counter instrumentations" << endl
+         << "-npi          disable instruction counter instrumentations" << endl
+         << "-e <events>   count these perf events, separated by commas. Groups of" << endl
+         << "              events are separated by slashes, e.g." << endl
+         << "              cycles,instructions/LLC-loads,LLC-load-misses" << endl;
+    exit(0);
+}
+
+// Register the contenders that can handle string keys
+template <typename Key>
+void register_contenders(common::contender_list<hashtable::hashtable<Key, int>> &contenders) {
+    using Factory = common::contender_factory<hashtable::hashtable<Key, int>>;
+    hashtable::unordered_map<Key, int>::register_contenders(contenders);
+
+    // No word is empty or contains a space, so these can be the empty and
+    // deleted keys. The realloc-based default allocator can't move strings.
+    contenders.register_contender(Factory("dense_hash_map", "dense-hash-map",
+        [](){ return new hashtable::dense_hash_map<Key, int, std::hash<Key>, std::equal_to<Key>,
+                                                   std::allocator<std::pair<const Key, int>>>(
+                  0, Key(""), Key(" ")); }
+    ));
+
+    hashtable::swiss_table<Key, int>::register_contenders(contenders);
+    hashtable::robin_hood<Key, int>::register_contenders(contenders);
+    hashtable::cuckoo_pages<Key, int>::register_contenders(contenders);
+}
+
+template <typename Key>
+void run(common::contender_list<common::instrumentation> &instrumentations,
+         const common::repetition_policy &repetitions,
+         const std::string &resultfn_prefix,
+         const std::string &serializationfn, bool append_results, bool large,
+         double cutoff, int max_results, int base_contender,
+         const common::schedule &schedule)
+{
+    using HashTable = hashtable::hashtable<Key, int>;
+    using Configuration = common::corpus_configuration;
+    using Benchmark = common::benchmark<HashTable, Configuration>;
+
+    common::contender_list<HashTable> contenders;
+    register_contenders<Key>(contenders);
+
+    common::contender_list<Benchmark> benchmarks;
+    hashtable::wordcount<HashTable>::register_benchmarks(benchmarks);
+    if (large)
+        hashtable::wordcount<HashTable>::register_large_benchmarks(benchmarks);
+
+    std::vector<std::vector<common::benchmark_result_aggregate>> results;
+    common::experiment_runner<HashTable, Configuration> runner(contenders, instrumentations, benchmarks, results);
+    runner.run(repetitions, resultfn_prefix, false, schedule);
+
+    if (contenders.size() > 1) {
+        common::comparison comparison(results, base_contender);
+        comparison.compare();
+        comparison.print(std::cout, cutoff, max_results);
+    }
+
+    runner.serialize(serializationfn, append_results);
+    runner.shutdown();
+    hashtable::wordcount<HashTable>::clear_cache();
+}
+
+int main(int argc, char** argv) {
+    // Parse command-line arguments
+    common::arg_parser args(argc, argv);
+    if (args.is_set("h") || args.is_set("-help")) usage(argv[0]);
+    const std::string resultfn_prefix = args.get<std::string>("p", "results_hash_str_"),
+                      serializationfn = args.get<std::string>("o", "data_hash_str.txt"),
+                      serializationfn_view = args.get<std::string>("ov", "data_hash_str_view.txt");
+    const common::repetition_policy repetitions = (args.is_set("ci") || args.is_set("tb"))
+        ? common::repetition_policy::adaptive(args.get<double>("ci", 0), args.get<double>("tb", 0) * 1000,
+                                              args.get<size_t>("n", 5), args.get<size_t>("nmax", 100))
+        : common::repetition_policy(args.get<size_t>("n", 1));
+    const int max_results    = args.get<int>("m", 25),
+              base_contender = args.get<int>("b", 0);
+    const double cutoff = args.get<double>("c", 1.01);
+    const bool disable_timer          = args.is_set("nt"),
+               disable_latency        = args.is_set("nl"),
+               disable_cache_counters = args.is_set("npc") || args.is_set("np"),
+               disable_instr_counters = args.is_set("npi") || args.is_set("np"),
+               disable_string         = args.is_set("ns"),
+               disable_view           = args.is_set("nv"),
+               disable_large          = args.is_set("nL"),
+               append_results = args.is_set("a");
+    const std::string perf_events = args.get<std::string>("e", "");
+    common::schedule schedule;
+    schedule.workers = args.get<size_t>("j", 1);
+    schedule.alone = common::schedule::parse_keys(args.get<std::string>("ja", ""));
+
+    // Register instrumentations
+    common::contender_list<common::instrumentation> instrumentations;
+    if (!disable_timer)
+    instrumentations.register_contender("timer", "timer",
+        [](){ return new common::timer_instrumentation(); });
+
+    if (!disable_latency)
+    instrumentations.register_contender("latency", "latency",
+        [](){ return new common::latency_instrumentation(); });
+
+    if (!disable_cache_counters)
+    instrumentations.register_contender("perf cache", "perf_cache",
+        [](){ return common::perf_instrumentation_cache(); });
+
+    if (!disable_instr_counters)
+    instrumentations.register_contender("perf instruction", "perf_instr",
+        [](){ return common::perf_instrumentation_instr(); });
+
+    if (!perf_events.empty()) {
+        // Check the event names before running anything
+        const auto groups = common::perf_event::parse_groups(perf_events);
+        instrumentations.register_contender("perf " + perf_events, "perf",
+            [groups](){ return new common::perf_instrumentation(groups); });
+    }
+
+#ifdef WITH_PAPI
+    if (!disable_cache_counters)
+    instrumentations.register_contender("PAPI cache", "PAPI_cache",
+        [](){ return new common::papi_instrumentation_cache(); });
+
+    if (!disable_instr_counters)
+    instrumentations.register_contender("PAPI instruction", "PAPI_instr",
+        [](){ return new common::papi_instrumentation_instr(); });
+#endif
+
+    // Run the benchmarks, separately for each key type
+    if (!disable_string)
+        run<std::string>(instrumentations, repetitions, resultfn_prefix,
+                         serializationfn, append_results, !disable_large, cutoff, max_results,
+                         base_contender, schedule);
+
+    if (!disable_view)
+        run<common::string_view>(instrumentations, repetitions, resultfn_prefix + "view_",
+                                 serializationfn_view, append_results, !disable_large, cutoff, max_results,
+                                 base_contender, schedule);
+}
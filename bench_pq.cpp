@@ -2,21 +2,28 @@
 #include <iostream>
 #include <vector>
 
-#include <papi.h>
-
 #include "common/arg_parser.h"
 #include "common/benchmark.h"
 #include "common/comparison.h"
 #include "common/contenders.h"
+#include "common/devirtualize.h"
 #include "common/experiments.h"
 #include "common/hack.h"
 #include "common/instrumentation.h"
+#include "common/latency.h"
+#include "common/perf_instrumentation.h"
+#include "common/scheduler.h"
+#include "common/statistics.h"
 
 #include "pq/priority_queue.h"
 #include "pq/std_pq.h"
+#include "pq/dary_heap.h"
+#include "pq/sequence_heap.h"
 #include "pq/gnu_pq.h"
+#include "pq/radix_heap.h"
 #include "pq/microbenchmark.h"
 #include "pq/heapsort.h"
+#include "pq/hold_model.h"
 
 void usage(char* name) {
     using std::cout;
@@ -25,20 +32,69 @@ void usage(char* name) {
          << "Options:" << endl
          << "-a            append results instead of replacing" << endl
          << "-o <filename> result serialization filename (default: data_pq.txt)" << endl
+         << "-ol <filename> result serialization filename for the large instances" << endl
+         << "              (default: data_pq_large.txt)" << endl
+         << "-om <filename> result serialization filename for the monotone benchmarks" << endl
+         << "              (default: data_pq_monotone.txt)" << endl
          << "-p <prefix>   result filename prefix (default: results_pq_)" << endl
-         << "-n <int>      number of repetitions for each benchmark (default: 1)" << endl
+         << "-n <int>      number of repetitions for each benchmark (default: 1), or the" << endl
+         << "              minimum number with -ci or -tb (default: 5)" << endl
+         << "-ci <double>  repeat until the 95% confidence interval of the median of the" << endl
+         << "              first result component (e.g. the time) is at most this wide," << endl
+         << "              relative to the median, e.g. 0.02" << endl
+         << "-tb <double>  time budget in seconds for the repetitions of a configuration." << endl
+         << "              Without -ci, repeat until it's used up" << endl
+         << "-nmax <int>   maximum number of repetitions with -ci or -tb (default: 100)" << endl
          << "-c <double>   cutoff, at which difference ratio to stop printing (deafult: 1.01)" << endl
          << "-m <int>      maximum number of differences to print (default: 25)" << endl
          << "-b <int>      which contender to compare to the others (default: 0)" << endl
+         << "-j <int>      run the benchmarks on this many worker processes, each" << endl
+         << "              pinned to a physical core of its own (default: 1)" << endl
+         << "-ja <keys>    benchmarks (comma-separated keys) that need the memory" << endl
+         << "              bandwidth to themselves, run while the other workers wait" << endl
+         << "-nL           don't run the large instances (2^22 to 2^26 elements) on" << endl
+         << "              the contenders that are meant for them" << endl
+         << "-nM           don't run the monotone benchmarks (hold model), which" << endl
+         << "              monotone queues like radix heaps take part in" << endl
          << endl
          << "Instrumentation options:" << endl
          << "-nt           disable timer instrumentation" << endl
-         << "-np           disable all PAPI instrumentations" << endl
-         << "-npc          disable PAPI cache instrumentation" << endl
-         << "-npi          disable PAPI instruction instrumentation" << endl;
+         << "-nl           disable per-operation latency instrumentation" << endl
+         << "-np           disable all hardware counter instrumentations" << endl
+         << "-npc          disable cache counter instrumentations" << endl
+         << "-npi          disable instruction counter instrumentations" << endl
+         << "-e <events>   count these perf events, separated by commas. Groups of" << endl
+         << "              events are separated by slashes, e.g." << endl
+         << "              cycles,instructions/LLC-loads,LLC-load-misses" << endl;
     exit(0);
 }
 
+/// Run benchmarks on another set of contenders than the main run. The
+/// results are appended to the same RESULT files, but compared and
+/// serialized on their own, as they don't line up with the main results.
+template <typename PQ, typename Configuration>
+void run_separately(common::contender_list<PQ> &contenders,
+                    common::contender_list<common::instrumentation> &instrumentations,
+                    common::contender_list<common::benchmark<PQ, Configuration>> &benchmarks,
+                    const common::repetition_policy &repetitions,
+                    const std::string &resultfn_prefix,
+                    const std::string &serializationfn, bool append_results,
+                    double cutoff, int max_results, const common::schedule &schedule)
+{
+    std::vector<std::vector<common::benchmark_result_aggregate>> results;
+    common::experiment_runner<PQ, Configuration> runner(contenders, instrumentations, benchmarks, results);
+    runner.run(repetitions, resultfn_prefix, true, schedule);
+
+    if (contenders.size() > 1) {
+        common::comparison comparison(results, 0);
+        comparison.compare();
+        comparison.print(std::cout, cutoff, max_results);
+    }
+
+    runner.serialize(serializationfn, append_results);
+    runner.shutdown();
+}
+
 int main(int argc, char** argv) {
     // Parse command-line arguments
     common::arg_parser args(argc, argv);
@@ -46,16 +102,28 @@ int main(int argc, char** argv) {
         usage(argv[0]);
     }
     const std::string resultfn_prefix = args.get<std::string>("p", "results_pq_"),
-                      serializationfn = args.get<std::string>("o", "data_pq.txt");
-    const int repetitions    = args.get<int>("n", 1),
-              max_results    = args.get<int>("m", 25),
+                      serializationfn = args.get<std::string>("o", "data_pq.txt"),
+                      serializationfn_large = args.get<std::string>("ol", "data_pq_large.txt"),
+                      serializationfn_monotone = args.get<std::string>("om", "data_pq_monotone.txt");
+    const common::repetition_policy repetitions = (args.is_set("ci") || args.is_set("tb"))
+        ? common::repetition_policy::adaptive(args.get<double>("ci", 0), args.get<double>("tb", 0) * 1000,
+                                              args.get<size_t>("n", 5), args.get<size_t>("nmax", 100))
+        : common::repetition_policy(args.get<size_t>("n", 1));
+    const int max_results    = args.get<int>("m", 25),
               base_contender = args.get<int>("b", 0);
     const double cutoff = args.get<double>("c", 1.01);
     __attribute__((unused)) // don't warn when compiling malloc target
-    const bool disable_timer      = args.is_set("nt"),
-               disable_papi_cache = args.is_set("npc") || args.is_set("np"),
-               disable_papi_instr = args.is_set("npi") || args.is_set("np"),
+    const bool disable_timer          = args.is_set("nt"),
+               disable_latency        = args.is_set("nl"),
+               disable_cache_counters = args.is_set("npc") || args.is_set("np"),
+               disable_instr_counters = args.is_set("npi") || args.is_set("np"),
+               disable_large = args.is_set("nL"),
+               disable_monotone = args.is_set("nM"),
                append_results = args.is_set("a");
+    const std::string perf_events = args.get<std::string>("e", "");
+    common::schedule schedule;
+    schedule.workers = args.get<size_t>("j", 1);
+    schedule.alone = common::schedule::parse_keys(args.get<std::string>("ja", ""));
 
     using PQ = pq::priority_queue<int>;
     using Configuration = std::pair<size_t, size_t>;
@@ -68,6 +136,12 @@ int main(int argc, char** argv) {
     // Add std::priority_queue
     pq::std_pq<int>::register_contenders(contenders);
 
+    // Implicit d-ary heaps whose sibling groups are aligned to cache lines
+    pq::dary_heap<int>::register_contenders(contenders);
+
+    // Sequence heaps for queues that don't fit into the cache
+    pq::sequence_heap<int>::register_contenders(contenders);
+
 #if defined(__GNUG__) && !(defined(__APPLE_CC__))
     // These are from GNU libstdc++ policy-based datastructures library
     // Only use if available
@@ -79,6 +153,20 @@ int main(int argc, char** argv) {
     pq::microbenchmark<PQ>::register_benchmarks(benchmarks);
     pq::heapsort<PQ>::register_benchmarks(benchmarks);
 
+    // Large instances, only for the contenders that can handle them
+    common::contender_list<PQ> large_contenders;
+    pq::sequence_heap<int>::register_contenders(large_contenders);
+    common::contender_list<Benchmark> large_benchmarks;
+    pq::microbenchmark<PQ>::register_large_benchmarks(large_benchmarks);
+
+    // Monotone benchmarks, in which monotone queues can take part as well
+    common::contender_list<PQ> monotone_contenders;
+    for (const auto &factory : contenders)
+        monotone_contenders.register_contender(factory);
+    pq::radix_heap<int>::register_contenders(monotone_contenders);
+    common::contender_list<Benchmark> monotone_benchmarks;
+    pq::hold_model<PQ>::register_benchmarks(monotone_benchmarks);
+
     // Register instrumentations
     common::contender_list<common::instrumentation> instrumentations;
 #ifndef MALLOC_INSTR
@@ -86,13 +174,34 @@ int main(int argc, char** argv) {
     instrumentations.register_contender("timer", "timer",
         [](){ return new common::timer_instrumentation(); });
 
-    if (!disable_papi_cache)
+    if (!disable_latency)
+    instrumentations.register_contender("latency", "latency",
+        [](){ return new common::latency_instrumentation(); });
+
+    if (!disable_cache_counters)
+    instrumentations.register_contender("perf cache", "perf_cache",
+        [](){ return common::perf_instrumentation_cache(); });
+
+    if (!disable_instr_counters)
+    instrumentations.register_contender("perf instruction", "perf_instr",
+        [](){ return common::perf_instrumentation_instr(); });
+
+    if (!perf_events.empty()) {
+        // Check the event names before running anything
+        const auto groups = common::perf_event::parse_groups(perf_events);
+        instrumentations.register_contender("perf " + perf_events, "perf",
+            [groups](){ return new common::perf_instrumentation(groups); });
+    }
+
+#ifdef WITH_PAPI
+    if (!disable_cache_counters)
     instrumentations.register_contender("PAPI cache", "PAPI_cache",
         [](){ return new common::papi_instrumentation_cache(); });
 
-    if (!disable_papi_instr)
+    if (!disable_instr_counters)
     instrumentations.register_contender("PAPI instruction", "PAPI_instr",
         [](){ return new common::papi_instrumentation_instr(); });
+#endif
 #else
     instrumentations.register_contender("memory usage", "memory",
         [](){ return new common::memory_instrumentation(); });
@@ -102,7 +211,20 @@ int main(int argc, char** argv) {
 
     // Run the benchmarks
     common::experiment_runner<PQ, Configuration> runner(contenders, instrumentations, benchmarks, results);
-    runner.run(repetitions, resultfn_prefix);
+    runner.run(repetitions, resultfn_prefix, false, schedule);
+
+#ifdef DEVIRTUALIZE
+    // Run the benchmarks again, instantiated for each concrete contender type
+    common::devirtualized_runner<Configuration, pq::microbenchmark, pq::heapsort>
+        devirtualized(instrumentations, results);
+    devirtualized.add<pq::std_pq<int>>("std::priority_queue", "std::priority-queue");
+    devirtualized.add<pq::dary_heap<int, 8>>("aligned 8-ary heap", "dary-heap-8");
+    devirtualized.add<pq::sequence_heap<int>>("sequence heap m=256 k=64", "sequence-heap-256-64");
+#if defined(__GNUG__) && !(defined(__APPLE_CC__))
+    devirtualized.add<pq::gnu_pq<int>>("GNU Pairing Heap", "GNU-pairing-heap");
+#endif
+    devirtualized.run(repetitions, resultfn_prefix, schedule);
+#endif
 
     // Evaluate the result
     if (contenders.size() > 1) {
@@ -114,5 +236,15 @@ int main(int argc, char** argv) {
     // Serialize results to disk for further evaluation
     runner.serialize(serializationfn, append_results);
 
+    if (!disable_large)
+        run_separately(large_contenders, instrumentations, large_benchmarks,
+                       repetitions, resultfn_prefix, serializationfn_large,
+                       append_results, cutoff, max_results, schedule);
+
+    if (!disable_monotone)
+        run_separately(monotone_contenders, instrumentations, monotone_benchmarks,
+                       repetitions, resultfn_prefix, serializationfn_monotone,
+                       append_results, cutoff, max_results, schedule);
+
     runner.shutdown();
 }
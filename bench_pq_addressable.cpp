@@ -0,0 +1,143 @@
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "common/arg_parser.h"
+#include "common/benchmark.h"
+#include "common/comparison.h"
+#include "common/contenders.h"
+#include "common/experiments.h"
+#include "common/instrumentation.h"
+#include "common/perf_instrumentation.h"
+#include "common/scheduler.h"
+#include "common/statistics.h"
+
+#include "pq/addressable_priority_queue.h"
+#include "pq/dijkstra.h"
+#include "pq/gnu_pq.h"
+
+void usage(char* name) {
+    using std::cout;
+    using std::endl;
+    cout << "Usage: " << name << " <options>" << endl << endl
+         << "Options:" << endl
+         << "-a            append results instead of replacing" << endl
+         << "-o <filename> result serialization filename (default: data_pq_addressable.txt)" << endl
+         << "-p <prefix>   result filename prefix (default: results_pq_addressable_)" << endl
+         << "-n <int>      number of repetitions for each benchmark (default: 1), or the" << endl
+         << "              minimum number with -ci or -tb (default: 5)" << endl
+         << "-ci <double>  repeat until the 95% confidence interval of the median of the" << endl
+         << "              first result component (e.g. the time) is at most this wide," << endl
+         << "              relative to the median, e.g. 0.02" << endl
+         << "-tb <double>  time budget in seconds for the repetitions of a configuration." << endl
+         << "              Without -ci, repeat until it's used up" << endl
+         << "-nmax <int>   maximum number of repetitions with -ci or -tb (default: 100)" << endl
+         << "-c <double>   cutoff, at which difference ratio to stop printing (deafult: 1.01)" << endl
+         << "-m <int>      maximum number of differences to print (default: 25)" << endl
+         << "-b <int>      which contender to compare to the others (default: 0)" << endl
+         << "-j <int>      run the benchmarks on this many worker processes, each" << endl
+         << "              pinned to a physical core of its own (default: 1)" << endl
+         << "-ja <keys>    benchmarks (comma-separated keys) that need the memory" << endl
+         << "              bandwidth to themselves, run while the other workers wait" << endl
+         << endl
+         << "Instrumentation options:" << endl
+         << "-nt           disable timer instrumentation" << endl
+         << "-np           disable all hardware counter instrumentations" << endl
+         << "-npc          disable cache counter instrumentations" << endl
+         << "-npi          disable instruction counter instrumentations" << endl
+         << "-e <events>   count these perf events, separated by commas. Groups of" << endl
+         << "              events are separated by slashes, e.g." << endl
+         << "              cycles,instructions/LLC-loads,LLC-load-misses" << endl;
+    exit(0);
+}
+
+int main(int argc, char** argv) {
+    // Parse command-line arguments
+    common::arg_parser args(argc, argv);
+    if (args.is_set("h") || args.is_set("-help")) usage(argv[0]);
+    const std::string resultfn_prefix = args.get<std::string>("p", "results_pq_addressable_"),
+                      serializationfn = args.get<std::string>("o", "data_pq_addressable.txt");
+    const common::repetition_policy repetitions = (args.is_set("ci") || args.is_set("tb"))
+        ? common::repetition_policy::adaptive(args.get<double>("ci", 0), args.get<double>("tb", 0) * 1000,
+                                              args.get<size_t>("n", 5), args.get<size_t>("nmax", 100))
+        : common::repetition_policy(args.get<size_t>("n", 1));
+    const int max_results    = args.get<int>("m", 25),
+              base_contender = args.get<int>("b", 0);
+    const double cutoff = args.get<double>("c", 1.01);
+    const bool disable_timer          = args.is_set("nt"),
+               disable_cache_counters = args.is_set("npc") || args.is_set("np"),
+               disable_instr_counters = args.is_set("npi") || args.is_set("np"),
+               append_results = args.is_set("a");
+    const std::string perf_events = args.get<std::string>("e", "");
+    common::schedule schedule;
+    schedule.workers = args.get<size_t>("j", 1);
+    schedule.alone = common::schedule::parse_keys(args.get<std::string>("ja", ""));
+
+    // Distances and node IDs
+    using PQ = pq::addressable_priority_queue<uint64_t, uint32_t>;
+    using Configuration = pq::graph_configuration;
+    using Benchmark = common::benchmark<PQ, Configuration>;
+
+    // Set up data structure contenders
+    common::contender_list<PQ> contenders;
+    // TODO: add your own implementation here!
+
+#if defined(__GNUG__) && !(defined(__APPLE_CC__))
+    // These are from GNU libstdc++ policy-based datastructures library
+    // Only use if available
+    pq::gnu_addressable_pq<uint64_t, uint32_t>::register_contenders(contenders);
+#endif
+
+    // Register Benchmarks
+    common::contender_list<Benchmark> benchmarks;
+    pq::dijkstra<PQ>::register_benchmarks(benchmarks);
+
+    // Register instrumentations
+    common::contender_list<common::instrumentation> instrumentations;
+    if (!disable_timer)
+    instrumentations.register_contender("timer", "timer",
+        [](){ return new common::timer_instrumentation(); });
+
+    if (!disable_cache_counters)
+    instrumentations.register_contender("perf cache", "perf_cache",
+        [](){ return common::perf_instrumentation_cache(); });
+
+    if (!disable_instr_counters)
+    instrumentations.register_contender("perf instruction", "perf_instr",
+        [](){ return common::perf_instrumentation_instr(); });
+
+    if (!perf_events.empty()) {
+        // Check the event names before running anything
+        const auto groups = common::perf_event::parse_groups(perf_events);
+        instrumentations.register_contender("perf " + perf_events, "perf",
+            [groups](){ return new common::perf_instrumentation(groups); });
+    }
+
+#ifdef WITH_PAPI
+    if (!disable_cache_counters)
+    instrumentations.register_contender("PAPI cache", "PAPI_cache",
+        [](){ return new common::papi_instrumentation_cache(); });
+
+    if (!disable_instr_counters)
+    instrumentations.register_contender("PAPI instruction", "PAPI_instr",
+        [](){ return new common::papi_instrumentation_instr(); });
+#endif
+
+    std::vector<std::vector<common::benchmark_result_aggregate>> results;
+
+    // Run the benchmarks
+    common::experiment_runner<PQ, Configuration> runner(contenders, instrumentations, benchmarks, results);
+    runner.run(repetitions, resultfn_prefix, false, schedule);
+
+    // Evaluate the result
+    if (contenders.size() > 1) {
+        common::comparison comparison(results, base_contender);
+        comparison.compare();
+        comparison.print(std::cout, cutoff, max_results);
+    }
+
+    // Serialize results to disk for further evaluation
+    runner.serialize(serializationfn, append_results);
+
+    runner.shutdown();
+}
@@ -0,0 +1,120 @@
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "common/arg_parser.h"
+#include "common/benchmark.h"
+#include "common/comparison.h"
+#include "common/concurrency.h"
+#include "common/contenders.h"
+#include "common/experiments.h"
+#include "common/instrumentation.h"
+#include "common/statistics.h"
+#include "common/rank_error.h"
+
+#include "pq/concurrent_microbenchmark.h"
+#include "pq/concurrent_priority_queue.h"
+#include "pq/locked_pq.h"
+#include "pq/multiqueue.h"
+
+void usage(char* name) {
+    using std::cout;
+    using std::endl;
+    cout << "Usage: " << name << " <options>" << endl << endl
+         << "Options:" << endl
+         << "-a            append results instead of replacing" << endl
+         << "-o <filename> result serialization filename (default: data_pq_mt.txt)" << endl
+         << "-p <prefix>   result filename prefix (default: results_pq_mt_)" << endl
+         << "-n <int>      number of repetitions for each benchmark (default: 1), or the" << endl
+         << "              minimum number with -ci or -tb (default: 5)" << endl
+         << "-ci <double>  repeat until the 95% confidence interval of the median of the" << endl
+         << "              first result component (e.g. the time) is at most this wide," << endl
+         << "              relative to the median, e.g. 0.02" << endl
+         << "-tb <double>  time budget in seconds for the repetitions of a configuration." << endl
+         << "              Without -ci, repeat until it's used up" << endl
+         << "-nmax <int>   maximum number of repetitions with -ci or -tb (default: 100)" << endl
+         << "-c <double>   cutoff, at which difference ratio to stop printing (deafult: 1.01)" << endl
+         << "-m <int>      maximum number of differences to print (default: 25)" << endl
+         << "-b <int>      which contender to compare to the others (default: 0)" << endl
+         << "-t <list>     comma-separated thread counts (default: powers of two up to" << endl
+         << "              the number of hardware threads)" << endl
+         << endl
+         << "Instrumentation options:" << endl
+         << "-nt           disable timer instrumentation" << endl
+         << "-nx           disable throughput instrumentation" << endl
+         << "-nr           disable rank error instrumentation" << endl;
+    exit(0);
+}
+
+int main(int argc, char** argv) {
+    // Parse command-line arguments
+    common::arg_parser args(argc, argv);
+    if (args.is_set("h") || args.is_set("-help")) usage(argv[0]);
+    const std::string resultfn_prefix = args.get<std::string>("p", "results_pq_mt_"),
+                      serializationfn = args.get<std::string>("o", "data_pq_mt.txt");
+    const common::repetition_policy repetitions = (args.is_set("ci") || args.is_set("tb"))
+        ? common::repetition_policy::adaptive(args.get<double>("ci", 0), args.get<double>("tb", 0) * 1000,
+                                              args.get<size_t>("n", 5), args.get<size_t>("nmax", 100))
+        : common::repetition_policy(args.get<size_t>("n", 1));
+    const int max_results    = args.get<int>("m", 25),
+              base_contender = args.get<int>("b", 0);
+    const double cutoff = args.get<double>("c", 1.01);
+    const bool disable_timer      = args.is_set("nt"),
+               disable_throughput = args.is_set("nx"),
+               disable_rank_error = args.is_set("nr"),
+               append_results = args.is_set("a");
+    const std::vector<size_t> thread_counts = args.is_set("t")
+        ? common::util::parse_thread_list(args.get<std::string>("t"))
+        : common::util::thread_sweep();
+
+    using PQ = pq::concurrent_priority_queue<int>;
+    using Configuration = common::concurrent_configuration;
+    using Benchmark = common::benchmark<PQ, Configuration>;
+
+    // Set up data structure contenders
+    common::contender_list<PQ> contenders;
+
+    // Baseline: std::priority_queue behind a global lock
+    pq::locked_pq<int>::register_contenders(contenders);
+
+    // Relaxed: sequential heaps with a lock each, pop from the better of two
+    pq::multiqueue<int>::register_contenders(contenders);
+
+    // Register Benchmarks
+    common::contender_list<Benchmark> benchmarks;
+    pq::concurrent_microbenchmark<PQ>::register_benchmarks(benchmarks, thread_counts);
+
+    // Register instrumentations. PAPI counters are per thread, so they would
+    // only see the calling thread's share of the work.
+    common::contender_list<common::instrumentation> instrumentations;
+    if (!disable_timer)
+    instrumentations.register_contender("timer", "timer",
+        [](){ return new common::timer_instrumentation(); });
+
+    if (!disable_throughput)
+    instrumentations.register_contender("throughput", "throughput",
+        [](){ return new common::throughput_instrumentation(); });
+
+    // Logs every operation, so it only runs on its own
+    if (!disable_rank_error)
+    instrumentations.register_contender("rank error", "rank_error",
+        [](){ return new common::rank_error_instrumentation(); });
+
+    std::vector<std::vector<common::benchmark_result_aggregate>> results;
+
+    // Run the benchmarks
+    common::experiment_runner<PQ, Configuration> runner(contenders, instrumentations, benchmarks, results);
+    runner.run(repetitions, resultfn_prefix);
+
+    // Evaluate the result
+    if (contenders.size() > 1) {
+        common::comparison comparison(results, base_contender);
+        comparison.compare();
+        comparison.print(std::cout, cutoff, max_results);
+    }
+
+    // Serialize results to disk for further evaluation
+    runner.serialize(serializationfn, append_results);
+
+    runner.shutdown();
+}
@@ -1,13 +1,19 @@
 #pragma once
 
+#include <algorithm>
 #include <functional>
+#include <initializer_list>
+#include <limits>
 #include <string>
 #include <sstream>
 #include <type_traits>
 
 #include <boost/serialization/base_object.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 
 #include "contenders.h"
+#include "statistics.h"
 #include "terminal.h"
 
 namespace common {
@@ -27,6 +33,15 @@ public:
     virtual std::vector<double> compare_to(const benchmark_result *other) = 0;
     virtual std::ostream& print_component(int component, std::ostream &os) = 0;
 
+    /// The values of all components, in the order of compare_to
+    virtual std::vector<double> components() const = 0;
+    /// Set all components to values, e.g. to statistics of several results
+    virtual void set_components(const std::vector<double> &values) = 0;
+
+    /// Whether a larger value of a component is an improvement, e.g. for
+    /// throughput, as opposed to time or cache misses
+    virtual bool larger_is_better(int) const { return false; }
+
     virtual std::ostream& print(std::ostream &os) const = 0;
     virtual std::ostream& result(std::ostream &os) const = 0;
 
@@ -46,33 +61,107 @@ protected:
     }
 };
 
+/// The results of several runs of a benchmark on one configuration. Besides
+/// their minimum, maximum and average, it keeps every run's components, and
+/// the median, standard deviation and median absolute deviation of each
+/// component. Runs that are outliers in any component by their MAD are
+/// left out of all of these but the samples.
 class benchmark_result_aggregate {
     friend class boost::serialization::access;
+    friend class result_store;
 public:
-    benchmark_result_aggregate() : min(nullptr), max(nullptr), avg(nullptr), num_results(0) {}
-    benchmark_result_aggregate(benchmark_result *min, benchmark_result *max, benchmark_result *avg)
-        : min(min), max(max), avg(avg), num_results(0) {}
+    benchmark_result_aggregate()
+        : min(nullptr), max(nullptr), avg(nullptr)
+        , median(nullptr), stddev(nullptr), mad(nullptr)
+        , num_results(0), num_outliers(0) {}
+    benchmark_result_aggregate(benchmark_result *min, benchmark_result *max, benchmark_result *avg,
+                               benchmark_result *median = nullptr, benchmark_result *stddev = nullptr,
+                               benchmark_result *mad = nullptr)
+        : min(min), max(max), avg(avg)
+        , median(median), stddev(stddev), mad(mad)
+        , num_results(0), num_outliers(0) {}
     benchmark_result_aggregate(const benchmark_result_aggregate &other) = default;
 
     void destroy() { // can't put this in d'tor because copies are made
-        if (min != nullptr) delete min; min = nullptr;
-        if (max != nullptr) delete max; max = nullptr;
-        if (avg != nullptr) delete avg; avg = nullptr;
+        for (benchmark_result **r : {&min, &max, &avg, &median, &stddev, &mad}) {
+            delete *r;
+            *r = nullptr;
+        }
+        for (benchmark_result *run : runs)
+            delete run;
+        runs.clear();
     }
-    void add_result(const benchmark_result *const result) {
-        ++num_results;
-        min->min(result);
-        max->max(result);
-        avg->add(result);
+
+    /// Add the result of a run, which the aggregate takes ownership of
+    void add_result(benchmark_result *result) {
+        runs.push_back(result);
+        samples.push_back(result->components());
+    }
+
+    /// The first component of every run so far, e.g. to decide whether more
+    /// runs are needed
+    std::vector<double> first_components() const {
+        std::vector<double> values;
+        for (const auto &sample : samples)
+            values.push_back(sample[0]);
+        return values;
     }
 
     void finish() {
-        avg->div(num_results);
+        // Every component's outliers are determined over all runs, so that
+        // their flags line up with the runs
+        const std::vector<bool> none(runs.size(), false);
+        std::vector<bool> outlier(runs.size(), false);
+        const size_t num_components = samples.empty() ? 0 : samples[0].size();
+        for (size_t c = 0; c < num_components; ++c) {
+            const auto out = util::mad_outliers(component(c, none));
+            for (size_t i = 0; i < runs.size(); ++i)
+                if (out[i]) outlier[i] = true;
+        }
+        for (size_t i = 0; i < runs.size(); ++i) {
+            if (outlier[i]) {
+                ++num_outliers;
+                continue;
+            }
+            ++num_results;
+            min->min(runs[i]);
+            max->max(runs[i]);
+            avg->add(runs[i]);
+        }
+        if (num_results > 0) avg->div(num_results);
+
+        if (median != nullptr && num_results > 0) {
+            // Start from a kept run for everything but the components
+            const size_t first = std::find(outlier.begin(), outlier.end(), false) - outlier.begin();
+            std::vector<double> medians, stddevs, mads;
+            for (size_t c = 0; c < num_components; ++c) {
+                const auto values = component(c, outlier);
+                medians.push_back(util::median(values));
+                stddevs.push_back(util::stddev(values));
+                mads.push_back(util::mad(values));
+            }
+            for (auto r : {std::make_pair(median, &medians), std::make_pair(stddev, &stddevs),
+                           std::make_pair(mad, &mads)}) {
+                r.first->add(runs[first]);
+                r.first->set_components(*r.second);
+            }
+        }
+
+        for (benchmark_result *run : runs)
+            delete run;
+        runs.clear();
     }
 
     const benchmark_result * minimum() const { return min; }
     const benchmark_result * maximum() const { return max; }
     const benchmark_result * average() const { return avg; }
+    /// These are nullptr for results from before they were recorded
+    const benchmark_result * med() const { return median; }
+    const benchmark_result * standard_deviation() const { return stddev; }
+    const benchmark_result * median_deviation() const { return mad; }
+
+    /// The components of every run, including outliers
+    const std::vector<std::vector<double>>& runs_components() const { return samples; }
 
     std::vector<double> compare_to(const benchmark_result_aggregate &other) {
         return avg->compare_to(other.avg);
@@ -82,6 +171,37 @@ public:
         return avg->print_component(component, os);
     }
 
+    /// The median of a component, or the average for results without it
+    std::ostream& print_median_component(int component, std::ostream &os) {
+        return (median != nullptr ? median : avg)->print_component(component, os);
+    }
+
+    /// The medians of the components, or their averages for results
+    /// without them
+    std::vector<double> medians() const {
+        return (median != nullptr ? median : avg)->components();
+    }
+
+    /// For each component, the p-value of the Mann-Whitney U test of whether
+    /// the runs of both aggregates come from the same distribution, or NaN
+    /// if there are too few runs for any difference to be significant at
+    /// level alpha (e.g. results from before the runs were stored)
+    std::vector<double> significance(const benchmark_result_aggregate &other, double alpha = 0.05) const {
+        const size_t num_components = avg->components().size();
+        if (samples.size() < 2 || other.samples.size() < 2 ||
+            util::mann_whitney_u_min(samples.size(), other.samples.size()) >= alpha)
+            return std::vector<double>(num_components, std::numeric_limits<double>::quiet_NaN());
+        std::vector<double> p;
+        const std::vector<bool> mine(samples.size(), false), theirs(other.samples.size(), false);
+        for (size_t c = 0; c < num_components; ++c)
+            p.push_back(util::mann_whitney_u(component(c, mine), other.component(c, theirs)));
+        return p;
+    }
+
+    bool larger_is_better(int component) const {
+        return avg->larger_is_better(component);
+    }
+
     template <typename Configuration>
     void set_properties(const std::string &benchmark_name,
         const std::string &instance_desc,
@@ -122,10 +242,18 @@ public:
     friend std::ostream& operator<<(std::ostream &os, const benchmark_result_aggregate &res) {
         res.describe(os);
         if (res.num_results > 1) {
-            os << res.num_results << " runs.";
+            os << res.num_results << " runs";
+            if (res.num_outliers > 0)
+                os << " (" << res.num_outliers << " outliers left out)";
+            os << ".";
             os << std::endl << "\tmin: "; res.min->print(os);
             os << std::endl << "\tmax: "; res.max->print(os);
             os << std::endl << "\tavg: "; res.avg->print(os);
+            if (res.median != nullptr) {
+                os << std::endl << "\tmedian: "; res.median->print(os);
+                os << std::endl << "\tstddev: "; res.stddev->print(os);
+                os << std::endl << "\tMAD: "; res.mad->print(os);
+            }
         } else { // only one run, they're all equal
             res.min->print(os);
         }
@@ -133,20 +261,49 @@ public:
     }
 
     template <typename Archive>
-    void serialize(Archive & ar, const unsigned int) {
+    void serialize(Archive & ar, const unsigned int version) {
         ar & benchmark & instance & configuration & instrumentation;
         ar & min & max & avg & num_results;
+        if (version >= 1)
+            ar & median & stddev & mad & samples & num_outliers;
     }
 
     bool is_same_type(const benchmark_result_aggregate &other) const {
         return avg->is_same_type(other.avg);
     }
 protected:
+    // Component c of the runs that aren't outliers
+    std::vector<double> component(size_t c, const std::vector<bool> &outlier) const {
+        std::vector<double> values;
+        for (size_t i = 0; i < samples.size(); ++i)
+            if (!outlier[i]) values.push_back(samples[i][c]);
+        return values;
+    }
+
     std::string benchmark, instance, configuration, instrumentation;
     benchmark_result *min, *max, *avg;
-    int num_results;
+    benchmark_result *median, *stddev, *mad;
+    std::vector<benchmark_result*> runs; // until finish()
+    std::vector<std::vector<double>> samples;
+    int num_results, num_outliers;
 };
 
+// Print a configuration as RESULT columns for sqlplot-tools. Pairs become
+// config_1 and config_2, other configuration types provide a result member
+// like benchmark_result does.
+template <typename T1, typename T2>
+std::ostream& print_configuration(std::ostream &os, const std::pair<T1, T2> &configuration) {
+    return os << " config_1=" << configuration.first
+              << " config_2=" << configuration.second;
+}
+
+template <typename Configuration>
+auto print_configuration(std::ostream &os, const Configuration &configuration)
+    -> decltype(configuration.result(os))
+{
+    return configuration.result(os);
+}
+
 template <typename DataStructure, typename Configuration>
 class benchmark {
 public:
@@ -192,11 +349,13 @@ public:
 
         // Set up instrumentation
         instrumentation->setup();
+        Instrumentation::active() = instrumentation;
 
         // Run benchmark
         function(*instance, configuration, data);
 
         // stop and destroy instrumentation
+        Instrumentation::active() = nullptr;
         instrumentation->finish();
         auto result = instrumentation->result();
 
@@ -273,3 +432,5 @@ void register_benchmark(std::string &&description, std::string &&key,
 }
 
 }
+
+BOOST_CLASS_VERSION(common::benchmark_result_aggregate, 1)
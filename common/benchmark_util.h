@@ -1,9 +1,244 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <ostream>
 #include <random>
+#include <sstream>
+#include <string>
+#include <vector>
 
 namespace common {
+
+/// How the keys 1..n that the operations of a benchmark use are chosen
+struct key_distribution {
+    enum class kind { uniform, sequential, shuffled, zipf, hotspot, sliding_window };
+    kind type;
+    double a, b; // parameters, see the functions below
+
+    key_distribution(kind type = kind::uniform, double a = 0, double b = 0)
+        : type(type), a(a), b(b) {}
+
+    static key_distribution uniform() {
+        return key_distribution(kind::uniform);
+    }
+    /// Every key once, in order
+    static key_distribution sequential() {
+        return key_distribution(kind::sequential);
+    }
+    /// Every key once, in random order
+    static key_distribution shuffled() {
+        return key_distribution(kind::shuffled);
+    }
+    /// The keys are ranked in random order, the key of rank r is chosen
+    /// with probability proportional to 1/r^s
+    static key_distribution zipf(double s) {
+        return key_distribution(kind::zipf, s);
+    }
+    /// A fraction of the keys (random ones) get a fraction of the accesses,
+    /// e.g. 20% of the keys get 80% of the accesses
+    static key_distribution hotspot(double hot_keys, double hot_accesses) {
+        return key_distribution(kind::hotspot, hot_keys, hot_accesses);
+    }
+    /// Uniformly from a window of a fraction of the keys, which slides from
+    /// the first to the last keys over the operations
+    static key_distribution sliding_window(double width) {
+        return key_distribution(kind::sliding_window, width);
+    }
+
+    /// Short name without spaces, e.g. zipf-0.99
+    std::string description() const {
+        std::ostringstream s;
+        switch (type) {
+        case kind::uniform: s << "uniform"; break;
+        case kind::sequential: s << "sequential"; break;
+        case kind::shuffled: s << "shuffled"; break;
+        case kind::zipf: s << "zipf-" << a; break;
+        case kind::hotspot: s << "hotspot-" << a << "-" << b; break;
+        case kind::sliding_window: s << "window-" << a; break;
+        }
+        return s.str();
+    }
+};
+
+/// Configuration of benchmarks on keys 1..n: their number, a seed, and the
+/// distribution of the keys for the benchmarks that use one. The default
+/// distribution is left out of the description, so that the results of the
+/// benchmarks that don't use it keep their names.
+struct key_configuration {
+    size_t size, seed;
+    key_distribution keys;
+
+    key_configuration(size_t size, size_t seed, key_distribution keys = key_distribution())
+        : size(size), seed(seed), keys(keys) {}
+
+    friend std::ostream& operator<<(std::ostream &os, const key_configuration &c) {
+        os << "(" << c.size << ", " << c.seed;
+        if (c.keys.type != key_distribution::kind::uniform)
+            os << ", " << c.keys.description();
+        return os << ")";
+    }
+
+    /// RESULT columns for sqlplot-tools
+    std::ostream& result(std::ostream &os) const {
+        return os << " config_1=" << size << " config_2=" << seed
+                  << " keys=" << keys.description();
+    }
+};
+
+/// Configuration of the relational benchmarks on columns of keys and
+/// values. A group-by aggregates `rows` rows with `keys` distinct keys. A
+/// hash join builds a table on `keys` rows and probes it with `rows` rows,
+/// a fraction `match_rate` of which have a partner.
+struct relational_configuration {
+    size_t rows, keys;
+    double match_rate;
+    size_t seed;
+    bool join;
+
+    static relational_configuration group_by(size_t rows, size_t groups, size_t seed) {
+        return relational_configuration(rows, groups, 1, seed, false);
+    }
+
+    static relational_configuration hash_join(size_t build, size_t probe, double match_rate,
+                                              size_t seed) {
+        return relational_configuration(probe, build, match_rate, seed, true);
+    }
+
+    friend std::ostream& operator<<(std::ostream &os, const relational_configuration &c) {
+        if (!c.join)
+            return os << "(" << c.rows << " rows, " << c.keys << " groups, " << c.seed << ")";
+        return os << "(" << c.keys << " build, " << c.rows << " probe, "
+                  << c.match_rate << " matching, " << c.seed << ")";
+    }
+
+    /// RESULT columns for sqlplot-tools
+    std::ostream& result(std::ostream &os) const {
+        return os << " rows=" << rows << " keys=" << keys
+                  << " match_rate=" << match_rate << " seed=" << seed;
+    }
+
+protected:
+    relational_configuration(size_t rows, size_t keys, double match_rate, size_t seed, bool join)
+        : rows(rows), keys(keys), match_rate(match_rate), seed(seed), join(join) {}
+};
+
 namespace util {
+    /// Draws keys from 1..n by a key_distribution, for a given number of
+    /// operations (which the sliding window needs to know)
+    class key_generator {
+    public:
+        key_generator(const key_distribution &dist, size_t n, size_t count, size_t seed)
+            : dist(dist), n(n), count(count), i(0), gen(seed)
+        {
+            using kind = key_distribution::kind;
+            if (dist.type == kind::shuffled || dist.type == kind::zipf || dist.type == kind::hotspot) {
+                order.resize(n);
+                for (size_t k = 0; k < n; ++k) order[k] = k + 1;
+                std::shuffle(order.begin(), order.end(), gen);
+            }
+            if (dist.type == kind::zipf) {
+                // cumulative weights of the ranks, sampled by binary search
+                cdf.resize(n);
+                double sum = 0;
+                for (size_t r = 0; r < n; ++r) {
+                    sum += std::pow(static_cast<double>(r + 1), -dist.a);
+                    cdf[r] = sum;
+                }
+            }
+            hot = std::min(n, std::max<size_t>(1, std::llround(dist.a * n)));
+        }
+
+        size_t operator()() {
+            using kind = key_distribution::kind;
+            const size_t op = i++;
+            switch (dist.type) {
+            case kind::sequential:
+                return op % n + 1;
+            case kind::shuffled:
+                return order[op % n];
+            case kind::zipf: {
+                std::uniform_real_distribution<double> u(0, cdf.back());
+                const size_t rank = std::upper_bound(cdf.begin(), cdf.end(), u(gen)) - cdf.begin();
+                return order[std::min(rank, n - 1)];
+            }
+            case kind::hotspot: {
+                // hot keys are the first ones in order
+                std::bernoulli_distribution is_hot(dist.b);
+                if (hot == n || is_hot(gen))
+                    return order[std::uniform_int_distribution<size_t>(0, hot - 1)(gen)];
+                return order[std::uniform_int_distribution<size_t>(hot, n - 1)(gen)];
+            }
+            case kind::sliding_window: {
+                const size_t start = count > 1 ? op * (n - hot) / (count - 1) : 0;
+                return start + std::uniform_int_distribution<size_t>(1, hot)(gen);
+            }
+            case kind::uniform:
+            default:
+                return std::uniform_int_distribution<size_t>(1, n)(gen);
+            }
+        }
+
+    protected:
+        key_distribution dist;
+        size_t n, count, i;
+        size_t hot; // hot keys or window width, from the first parameter
+        std::mt19937 gen;
+        std::vector<size_t> order; // keys in random order
+        std::vector<double> cdf;
+    };
+
+    /// Draws ranks from 1..n with probability proportional to 1/r^s in
+    /// constant time and without tables, by rejection-inversion (Hörmann
+    /// and Derflinger 1996). For huge n, where key_generator's cumulative
+    /// weights and binary search would be too slow.
+    class zipf_sampler {
+    public:
+        zipf_sampler(size_t n, double s)
+            : n(n), s(s)
+            , h_integral_x1(h_integral(1.5) - 1)
+            , h_integral_n(h_integral(n + 0.5))
+            , threshold(2 - h_integral_inverse(h_integral(2.5) - h(2))) {}
+
+        template <typename Generator>
+        size_t operator()(Generator &gen) const {
+            std::uniform_real_distribution<double> uniform(0, 1);
+            while (true) {
+                const double u = h_integral_n + uniform(gen) * (h_integral_x1 - h_integral_n);
+                const double x = h_integral_inverse(u);
+                const size_t k = static_cast<size_t>(std::min<double>(std::max(x + 0.5, 1.0), n));
+                if (k - x <= threshold || u >= h_integral(k + 0.5) - h(k))
+                    return k;
+            }
+        }
+
+    protected:
+        // h(x) = 1/x^s, h_integral is its antiderivative, normalized so that
+        // it is continuous in s = 1
+        double h(double x) const {
+            return std::exp(-s * std::log(x));
+        }
+        double h_integral(double x) const {
+            const double log_x = std::log(x);
+            return expm1_div((1 - s) * log_x) * log_x;
+        }
+        double h_integral_inverse(double x) const {
+            double t = x * (1 - s);
+            if (t < -1) t = -1; // rounding errors
+            return std::exp(log1p_div(t) * x);
+        }
+        // log(1+x)/x and (exp(x)-1)/x, with their Taylor series close to 0
+        static double log1p_div(double x) {
+            return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+        }
+        static double expm1_div(double x) {
+            return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1 + x * 0.5 * (1 + x / 3 * (1 + 0.25 * x));
+        }
+
+        size_t n;
+        double s, h_integral_x1, h_integral_n, threshold;
+    };
+
     template <typename T, typename F>
     static T* fill_data(size_t size, F&& cb) {
         auto data = new T[size];
@@ -25,25 +260,44 @@ namespace util {
         return fill_data<T>(size, [&gen](size_t) {return gen();});
     }
 
+    /// count keys from 1..n, drawn by the distribution
+    template <typename T>
+    static void* fill_keys(size_t count, size_t n, const key_distribution &dist, size_t seed) {
+        key_generator next(dist, n, count, seed);
+        return fill_data<T>(count, [&next](size_t) {return static_cast<T>(next());});
+    }
+
+    /// size values drawn uniformly from 0..max
+    template <typename T>
+    static void* fill_data_uniform(size_t size, T max, size_t seed) {
+        std::mt19937 gen{seed};
+        std::uniform_int_distribution<T> dist(0, max);
+        return fill_data<T>(size, [&gen, &dist](size_t) {return dist(gen);});
+    }
+
+    /// count keys to probe a table on the keys 1..n with: with probability
+    /// match_rate one of them, chosen uniformly, else one from n+1..2n
+    template <typename T>
+    static void* fill_probe_keys(size_t count, size_t n, double match_rate, size_t seed) {
+        std::mt19937 gen{seed};
+        std::bernoulli_distribution match(match_rate);
+        std::uniform_int_distribution<size_t> key(1, n);
+        return fill_data<T>(count, [&](size_t) {
+            const size_t k = key(gen);
+            return static_cast<T>(match(gen) ? k : n + k);
+        });
+    }
+
     template <typename T>
     static void delete_data(void* data) {
         delete[] static_cast<T*>(data);
     }
 
-    // awful hack!
-    __attribute__((unused))
-    static std::string hex_to_ascii(size_t hex) {
-        union {
-            size_t hex;
-            char letters[sizeof(size_t)];
-        } u = {hex};
-
-        std::stringstream s;
-        for (int i = sizeof(size_t) - 1; i >= 0; --i) {
-            if (u.letters[i] > 0)
-                s << u.letters[i];
-        }
-        return s.str();
+    /// Keep the compiler from optimizing away a computation whose result is
+    /// unused, like lookups in a benchmark once they can be inlined
+    template <typename T>
+    inline void do_not_optimize(const T &value) {
+        asm volatile("" : : "m"(value) : "memory");
     }
 }
 }
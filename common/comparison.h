@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <iostream>
 #include <limits>
 #include <tuple>
 #include <vector>
@@ -12,29 +13,45 @@
 
 namespace common {
 
+/// Compares the results of the contenders in one run against those of a
+/// base contender, largest differences first. Where both have several runs,
+/// differences that aren't significant at level alpha by the Mann-Whitney U
+/// test are left out, so that a single spike doesn't show up. Results are
+/// matched by position, so contenders with a different number of results
+/// than the base contender can't be compared and are skipped.
 class comparison {
 public:
     using result = benchmark_result_aggregate;
-    comparison(std::vector<std::vector<result>> &results, size_t base_index)
-        : results(results), similarity(), base_index(base_index)
+    comparison(std::vector<std::vector<result>> &results, size_t base_index, double alpha = 0.05)
+        : results(results), similarity(), base_index(base_index), alpha(alpha)
     {
         assert(base_index < results.size());
-        __attribute__((unused))
-        size_t base_size = results[base_index].size();
-        for (auto &res : results) {
-            assert(res.size() == base_size);
-            (void)res;
-        }
+    }
+
+    /// Whether the results of contender i line up with the base contender's
+    bool comparable(size_t i) const {
+        return results[i].size() == results[base_index].size() && !results[i].empty();
     }
 
     void compare() {
-        size_t size = results[0].size();
+        const size_t size = results[base_index].size();
         for (size_t i = 0; i < results.size(); ++i) {
             if (i == base_index) continue;
+            if (!comparable(i)) {
+                std::cerr << "Not comparing contender " << i << ": it has " << results[i].size()
+                          << " results, the base contender has " << size << std::endl;
+                continue;
+            }
             for (size_t j = 0; j < size; ++j) {
                 auto similarities = results[base_index][j].compare_to(results[i][j]);
+                // NaN if there are too few runs to tell, keep those
+                const auto p = results[base_index][j].significance(results[i][j], alpha);
                 int index = 0;
                 for (double sim : similarities) {
+                    if (p[index] >= alpha) {
+                        ++index;
+                        continue;
+                    }
                     // if 0, nan, inf
                     if (std::fpclassify(sim) != FP_NORMAL)
                         sim = std::numeric_limits<double>::infinity();
@@ -52,10 +69,14 @@ public:
     }
 
     std::ostream& print(std::ostream &os, double cutoff = 1.01, size_t max_results = 20) const {
+        if (results[base_index].empty()) {
+            std::cout << "Nothing to compare: the base contender has no results" << std::endl;
+            return os;
+        }
         std::cout << "Comparison of " << term::bold << results[base_index][0].instance_desc() << term::reset
                   << " versus ";
         for (size_t i = 0; i < results.size(); ++i) {
-            if (i == base_index) continue;
+            if (i == base_index || !comparable(i)) continue;
             std::cout << term::bold << results[i][0].instance_desc() << term::reset << "; ";
         }
         std::cout << "largest differences:" << std::endl;
@@ -113,5 +134,6 @@ protected:
     std::vector<std::vector<result>> &results;
     std::vector<std::tuple<size_t, size_t, double, int>> similarity;
     size_t base_index;
+    double alpha;
 };
 }
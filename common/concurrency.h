@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace common {
+
+/// Configuration of multi-threaded benchmarks: the total number of elements
+/// or operations, which is split among the threads, a random seed, and the
+/// number of threads
+struct concurrent_configuration {
+    size_t size, seed, threads;
+
+    /// The range of elements or operations that belongs to a thread
+    size_t begin(size_t thread) const { return size * thread / threads; }
+    size_t end(size_t thread) const { return size * (thread + 1) / threads; }
+
+    friend std::ostream& operator<<(std::ostream &os, const concurrent_configuration &c) {
+        return os << "(" << c.size << ", " << c.seed << ", " << c.threads << " threads)";
+    }
+
+    /// RESULT columns for sqlplot-tools
+    std::ostream& result(std::ostream &os) const {
+        return os << " size=" << size << " seed=" << seed << " threads=" << threads;
+    }
+};
+
+namespace util {
+    /// A set of threads that are started once and then run functions on
+    /// demand, so that benchmarks don't time starting and joining threads.
+    /// Idle workers sleep on a condition variable.
+    class thread_pool {
+    public:
+        explicit thread_pool(size_t threads)
+            : invoke(nullptr), job(nullptr), generation(0), pending(0), stop(false)
+        {
+            workers.reserve(threads - 1);
+            for (size_t t = 1; t < threads; ++t)
+                workers.emplace_back([this, t]() { work(t); });
+        }
+
+        thread_pool(const thread_pool &other) = delete;
+        thread_pool& operator=(const thread_pool &other) = delete;
+
+        ~thread_pool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            wake.notify_all();
+            for (auto &worker : workers)
+                worker.join();
+        }
+
+        /// Number of threads, including the calling thread
+        size_t size() const { return workers.size() + 1; }
+
+        /// Run f(thread_id) on all threads, with the calling thread as
+        /// thread 0, and wait for all of them
+        template <typename F>
+        void run(F &&f) {
+            using Fn = typename std::remove_reference<F>::type;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                invoke = [](void *fn, size_t t) { (*static_cast<Fn*>(fn))(t); };
+                job = const_cast<void*>(static_cast<const void*>(&f));
+                pending = workers.size();
+                ++generation;
+            }
+            wake.notify_all();
+            f(0);
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this]() { return pending == 0; });
+        }
+
+    private:
+        void work(size_t t) {
+            size_t seen = 0;
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                wake.wait(lock, [&]() { return stop || generation != seen; });
+                if (stop) return;
+                seen = generation;
+                lock.unlock();
+                invoke(job, t);
+                lock.lock();
+                if (--pending == 0)
+                    done.notify_one();
+            }
+        }
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake, done;
+        void (*invoke)(void*, size_t);
+        void *job;
+        size_t generation, pending;
+        bool stop;
+    };
+
+    /// Make sure the pool that run_parallel uses has the given number of
+    /// threads, and return it. Benchmarks call this in their setup (see
+    /// with_threads), so that their timed run doesn't start any threads.
+    __attribute__((unused))
+    static thread_pool& start_threads(size_t threads) {
+        static std::unique_ptr<thread_pool> pool;
+        if (!pool || pool->size() != threads) {
+            pool.reset();
+            pool.reset(new thread_pool(threads));
+        }
+        return *pool;
+    }
+
+    /// Run f(thread_id) on the given number of threads, including the
+    /// calling thread, and wait for all of them. The threads are those of
+    /// start_threads, which are started here if the setup didn't.
+    template <typename F>
+    void run_parallel(size_t threads, F &&f) {
+        start_threads(threads).run(f);
+    }
+
+    /// Wrap a benchmark setup function so that it also starts the threads
+    /// that run_parallel uses for the configuration
+    template <typename Setup>
+    auto with_threads(Setup setup) {
+        return [setup](auto &instance, auto &config, void *data) -> void* {
+            start_threads(config.threads);
+            return setup(instance, config, data);
+        };
+    }
+
+    /// Powers of two up to the number of hardware threads, plus that number
+    __attribute__((unused))
+    static std::vector<size_t> thread_sweep() {
+        const size_t max = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<size_t> threads;
+        for (size_t t = 1; t < max; t *= 2)
+            threads.push_back(t);
+        threads.push_back(max);
+        return threads;
+    }
+
+    /// Parse a comma-separated list of thread counts, e.g. "1,2,4,8"
+    __attribute__((unused))
+    static std::vector<size_t> parse_thread_list(const std::string &list) {
+        std::vector<size_t> threads;
+        std::istringstream s(list);
+        std::string item;
+        while (std::getline(s, item, ',')) {
+            size_t t = std::stoul(item);
+            if (t > 0) threads.push_back(t);
+        }
+        return threads;
+    }
+}
+}
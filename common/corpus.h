@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+
+#include "benchmark_util.h"
+#include "tokenizer.h"
+
+namespace common {
+
+/// The text of the wordcount benchmarks: either the file
+/// data/wordcount_<name>.txt, or a synthetic text of `tokens` words out of
+/// `vocabulary` distinct ones, whose frequencies follow Zipf's law with
+/// exponent `zipf` (see util::generate_corpus)
+struct corpus_configuration {
+    std::string name; // of the file, empty for synthetic texts
+    size_t vocabulary, tokens;
+    double zipf;
+    size_t seed;
+
+    static corpus_configuration file(const std::string &name) {
+        return corpus_configuration(name, 0, 0, 0, 0);
+    }
+
+    static corpus_configuration synthetic(size_t vocabulary, double zipf, size_t tokens,
+                                          size_t seed = 42) {
+        return corpus_configuration("", vocabulary, tokens, zipf, seed);
+    }
+
+    /// A configuration for each file data/wordcount_<name>.txt, by name
+    static std::vector<corpus_configuration> files(const std::string &dir = "data") {
+        const std::string prefix = "wordcount_", suffix = ".txt";
+        std::vector<std::string> names;
+        if (DIR *d = opendir(dir.c_str())) {
+            while (dirent *entry = readdir(d)) {
+                const std::string fn = entry->d_name;
+                if (fn.size() > prefix.size() + suffix.size() &&
+                    fn.compare(0, prefix.size(), prefix) == 0 &&
+                    fn.compare(fn.size() - suffix.size(), suffix.size(), suffix) == 0)
+                    names.push_back(fn.substr(prefix.size(), fn.size() - prefix.size() - suffix.size()));
+            }
+            closedir(d);
+        }
+        std::sort(names.begin(), names.end());
+        std::vector<corpus_configuration> configs;
+        for (const std::string &name : names)
+            configs.push_back(file(name));
+        return configs;
+    }
+
+    bool is_synthetic() const {
+        return name.empty();
+    }
+
+    std::string filename() const {
+        return "data/wordcount_" + name + ".txt";
+    }
+
+    /// Identifies the text, used to cache it
+    std::string description() const {
+        std::ostringstream s;
+        s << *this;
+        return s.str();
+    }
+
+    friend std::ostream& operator<<(std::ostream &os, const corpus_configuration &c) {
+        if (!c.is_synthetic())
+            return os << "(" << c.name << ")";
+        return os << "(synthetic, " << c.vocabulary << " words, zipf-" << c.zipf
+                  << ", " << c.tokens << " tokens, " << c.seed << ")";
+    }
+
+    /// RESULT columns for sqlplot-tools
+    std::ostream& result(std::ostream &os) const {
+        return os << " corpus=" << (is_synthetic() ? "synthetic" : name)
+                  << " vocabulary=" << vocabulary << " zipf=" << zipf
+                  << " tokens=" << tokens << " seed=" << seed;
+    }
+
+protected:
+    corpus_configuration(const std::string &name, size_t vocabulary, size_t tokens,
+                         double zipf, size_t seed)
+        : name(name), vocabulary(vocabulary), tokens(tokens), zipf(zipf), seed(seed) {}
+};
+
+namespace util {
+    /// Append the k-th word (k >= 1) of a synthetic vocabulary to text:
+    /// a, ..., z, aa, ab, ..., i.e. k in bijective base 26
+    inline void append_corpus_word(std::string &text, size_t k) {
+        char letters[16]; // enough for 64-bit k
+        size_t length = 0;
+        for (; k > 0; k = (k - 1) / 26)
+            letters[length++] = static_cast<char>('a' + (k - 1) % 26);
+        while (length > 0)
+            text.push_back(letters[--length]);
+    }
+
+    inline std::string corpus_word(size_t k) {
+        std::string word;
+        append_corpus_word(word, k);
+        return word;
+    }
+
+    /// The k of a word of a synthetic vocabulary, 0 if it isn't one
+    inline size_t corpus_word_rank(string_view word) {
+        size_t k = 0;
+        for (char c : word) {
+            if (c < 'a' || c > 'z') return 0;
+            k = 26 * k + (c - 'a' + 1);
+        }
+        return k;
+    }
+
+    /// A synthetic text of `tokens` words separated by spaces. The word of
+    /// rank r is corpus_word(r) and occurs with probability proportional to
+    /// 1/r^zipf, so frequent words are short, like in natural language. The
+    /// same parameters always give the same text.
+    inline std::string generate_corpus(size_t vocabulary, double zipf, size_t tokens, size_t seed) {
+        zipf_sampler sample(vocabulary, zipf);
+        std::mt19937_64 gen(seed);
+        std::string text;
+        // Rough guess, the string grows if it's too small
+        text.reserve(tokens * (corpus_word(std::max<size_t>(vocabulary / 100, 1)).size() + 1));
+        for (size_t i = 0; i < tokens; ++i) {
+            // Spelling out the word is faster than looking it up in a table
+            // that doesn't fit into the cache
+            append_corpus_word(text, sample(gen));
+            text.push_back(' ');
+        }
+        return text;
+    }
+}
+
+/// The text of a corpus: its file mapped into memory, or the generated
+/// synthetic text. Every text is loaded once and then kept for the rest of
+/// the process, as all contenders, instrumentations and repetitions use it.
+class corpus_text {
+public:
+    /// Load or generate the text, throws std::invalid_argument if the file
+    /// can't be opened
+    static const corpus_text& get(const corpus_configuration &config) {
+        static std::map<std::string, std::unique_ptr<corpus_text>> cache;
+        const std::string key = config.description();
+        auto it = cache.find(key);
+        if (it == cache.end())
+            it = cache.emplace(key, std::unique_ptr<corpus_text>(new corpus_text(config))).first;
+        return *it->second;
+    }
+
+    const char* begin() const {
+        return file ? file->begin() : text.data();
+    }
+
+    const char* end() const {
+        return file ? file->end() : text.data() + text.size();
+    }
+
+    /// Call f with a string_view of every word, in order
+    template <typename F>
+    void for_each_token(F &&f) const {
+        util::for_each_token(begin(), end(), std::forward<F>(f));
+    }
+
+protected:
+    explicit corpus_text(const corpus_configuration &config) {
+        if (config.is_synthetic())
+            text = util::generate_corpus(config.vocabulary, config.zipf, config.tokens, config.seed);
+        else
+            file.reset(new mapped_file(config.filename()));
+    }
+
+    std::unique_ptr<mapped_file> file;
+    std::string text;
+};
+
+}
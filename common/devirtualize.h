@@ -0,0 +1,93 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "contenders.h"
+#include "experiments.h"
+#include "instrumentation.h"
+#include "scheduler.h"
+#include "statistics.h"
+
+namespace common {
+
+/// Final subclass of a contender. Calls through references to it can be
+/// resolved at compile time, so benchmarks instantiated for it can inline
+/// the data structure's operations instead of going through the vtable.
+template <typename Contender>
+class devirtualized final : public Contender {
+public:
+    using Contender::Contender;
+};
+
+/// Register the benchmarks of a suite, plus its large ones if large is set
+/// and the suite has any. Comparisons match results by position, so the
+/// virtual runs must register theirs the same way as the devirtualized ones.
+template <typename Suite, typename Benchmark>
+auto register_suite(contender_list<Benchmark> &benchmarks, bool large)
+    -> decltype(Suite::register_large_benchmarks(benchmarks))
+{
+    Suite::register_benchmarks(benchmarks);
+    if (large)
+        Suite::register_large_benchmarks(benchmarks);
+}
+
+template <typename Suite, typename Benchmark, typename... Ignored>
+void register_suite(contender_list<Benchmark> &benchmarks, bool, Ignored...) {
+    Suite::register_benchmarks(benchmarks);
+}
+
+/// Runs benchmark suites instantiated separately for each concrete contender
+/// type. The results are appended to those of the virtual runs, so that both
+/// modes are reported and compared side by side. The suites are registered
+/// with register_suite, including their large benchmarks if large is set.
+template <typename Configuration, template <typename> class... Suites>
+class devirtualized_runner {
+public:
+    using Results = std::vector<std::vector<benchmark_result_aggregate>>;
+
+    devirtualized_runner(contender_list<instrumentation> &instrumentations, Results &results,
+                         bool large = false)
+        : instrumentations(instrumentations), results(results), large(large) {}
+
+    /// Add a contender type with the description and key of its virtual
+    /// counterpart. They get a suffix to tell the two apart.
+    template <typename Contender>
+    void add(const std::string &description, const std::string &key) {
+        runs.emplace_back([this, description, key](const repetition_policy &repetitions,
+                                                   const std::string &prefix,
+                                                   const schedule &sched) {
+            using DataStructure = devirtualized<Contender>;
+            using Benchmark = common::benchmark<DataStructure, Configuration>;
+
+            contender_list<DataStructure> contenders;
+            contenders.register_contender(description + " (devirtualized)", key + "-devirt",
+                [](){ return new DataStructure(); });
+
+            contender_list<Benchmark> benchmarks;
+            // Register all suites for this type
+            int expand[] = {0, (register_suite<Suites<DataStructure>>(benchmarks, large), 0)...};
+            (void)expand;
+
+            experiment_runner<DataStructure, Configuration> runner(
+                contenders, instrumentations, benchmarks, results);
+            runner.run(repetitions, prefix, true, sched);
+        });
+    }
+
+    void run(const repetition_policy &repetitions, const std::string &resultfn_prefix,
+             const schedule &sched = schedule()) {
+        for (auto &run : runs)
+            run(repetitions, resultfn_prefix, sched);
+    }
+
+protected:
+    contender_list<instrumentation> &instrumentations;
+    Results &results;
+    bool large;
+    std::vector<std::function<void(const repetition_policy&, const std::string&, const schedule&)>> runs;
+};
+
+}
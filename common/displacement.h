@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/export.hpp>
+
+#include "benchmark.h"
+#include "instrumentation.h"
+
+namespace common {
+
+/// How far the elements of an open addressing hash table are from their home
+/// slots, as a benchmark reported it for the table it ran on
+struct displacement_report {
+    double max, mean;
+    bool reported;
+
+    void clear() {
+        max = mean = 0;
+        reported = false;
+    }
+};
+
+class displacement_result : public benchmark_result {
+    friend class boost::serialization::access;
+public:
+    static constexpr int num_components = 2;
+private:
+    double values[num_components];
+    double reports; // number of runs that reported their displacement
+
+    static const char* name(int component) {
+        static const char* names[num_components] = {"max displacement", "mean displacement"};
+        return names[component];
+    }
+    // for RESULT lines
+    static const char* column(int component) {
+        static const char* columns[num_components] = {"disp_max", "disp_mean"};
+        return columns[component];
+    }
+public:
+    displacement_result(bool set_to_max = false) : reports(set_to_max ? 1e100 : 0) {
+        std::fill(values, values + num_components, set_to_max ? 1e100 : 0);
+    }
+    displacement_result(const displacement_report &report)
+        : values{report.max, report.mean}, reports(report.reported ? 1 : 0) {}
+    virtual ~displacement_result() {}
+
+    bool is_same_type(benchmark_result *other) const override {
+        return dynamic_cast<displacement_result*>(other) != nullptr;
+    }
+
+    std::ostream& print(std::ostream& os) const override {
+        if (reports == 0)
+            return os << "no displacement reported";
+        for (int i = 0; i < num_components; ++i)
+            os << (i > 0 ? "; " : "") << name(i) << ": " << values[i];
+        return os;
+    }
+    std::ostream& result(std::ostream& os) const override {
+        for (int i = 0; i < num_components; ++i)
+            os << " " << column(i) << "=" << values[i];
+        return os;
+    }
+
+    void add(const benchmark_result *const other) override {
+        const displacement_result* o = dynamic_cast<const displacement_result*>(other);
+        for (int i = 0; i < num_components; ++i)
+            values[i] += o->values[i];
+        reports += o->reports;
+    };
+    void min(const benchmark_result *const other) override {
+        const displacement_result* o = dynamic_cast<const displacement_result*>(other);
+        for (int i = 0; i < num_components; ++i)
+            values[i] = std::min(values[i], o->values[i]);
+        reports = std::min(reports, o->reports);
+    };
+    void max(const benchmark_result *const other) override {
+        const displacement_result* o = dynamic_cast<const displacement_result*>(other);
+        for (int i = 0; i < num_components; ++i)
+            values[i] = std::max(values[i], o->values[i]);
+        reports = std::max(reports, o->reports);
+    };
+    void div(const int divisor) override {
+        for (int i = 0; i < num_components; ++i)
+            values[i] /= divisor;
+        reports /= divisor;
+    };
+
+    // Tables that don't report their displacement have nothing to compare
+    std::vector<double> compare_to(const benchmark_result *other) override {
+        const displacement_result *o = dynamic_cast<const displacement_result*>(other);
+        std::vector<double> ratios;
+        for (int i = 0; i < num_components; ++i) {
+            if (reports == 0 || o->reports == 0 || (values[i] == 0 && o->values[i] == 0))
+                ratios.push_back(1.0);
+            else ratios.push_back(values[i] / o->values[i]);
+        }
+        return ratios;
+    }
+
+    std::ostream& print_component(int component, std::ostream &os) override {
+        assert(component >= 0 && component < num_components);
+        return os << name(component) << ": " << values[component];
+    }
+
+    std::vector<double> components() const override {
+        return std::vector<double>(values, values + num_components);
+    }
+    void set_components(const std::vector<double> &v) override {
+        std::copy(v.begin(), v.begin() + num_components, values);
+    }
+
+    template <typename Archive>
+    void serialize(Archive & ar, const unsigned int) {
+        ar & boost::serialization::base_object<benchmark_result>(*this);
+        ar & values & reports;
+    }
+};
+
+/// Records the displacement that benchmarks report with report_displacement
+/// at the end of a run. Computing it takes a scan of the table, which only
+/// happens while this instrumentation is active, so it doesn't affect the
+/// other measurements.
+class displacement_instrumentation : public instrumentation {
+public:
+    virtual ~displacement_instrumentation() = default;
+
+    void setup() { report.clear(); }
+    void finish() {}
+    displacement_report* displacement() override { return &report; }
+
+    virtual displacement_result* result() const {
+        return new displacement_result(report);
+    }
+    virtual benchmark_result* new_result(bool set_to_max = false) const {
+        return new displacement_result(set_to_max);
+    };
+
+private:
+    displacement_report report;
+};
+
+/// Report the displacement of a table that provides max_displacement() and
+/// mean_displacement(). Unless a displacement instrumentation is active, it
+/// does nothing.
+template <typename Table>
+void report_displacement(const Table &table) {
+    if (instrumentation::active() == nullptr) return;
+    displacement_report *report = instrumentation::active()->displacement();
+    if (report == nullptr) return;
+    report->max = static_cast<double>(table.max_displacement());
+    report->mean = table.mean_displacement();
+    report->reported = true;
+}
+
+}
+
+BOOST_CLASS_EXPORT_KEY(common::displacement_result)
+BOOST_CLASS_EXPORT_IMPLEMENT(common::displacement_result)
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
 #include <boost/archive/text_iarchive.hpp>
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/serialization/string.hpp>
@@ -8,7 +13,11 @@
 #include "benchmark.h"
 #include "contenders.h"
 #include "instrumentation.h"
+#include "result_store.h"
+#include "scheduler.h"
+#include "statistics.h"
 #include "terminal.h"
+#include "timer.h"
 
 namespace common {
 
@@ -30,13 +39,22 @@ public:
         results.reserve(contenders.end() - contenders.begin());
     }
 
-    void run(size_t repetitions, const std::string &resultfn_prefix) {
-        // Run all combinations!
-        bool first_iteration = true;
+    /// Run all combinations. RESULT files are overwritten unless
+    /// append_to_files is set, e.g. when another runner wrote them before.
+    /// With more than one worker in the schedule, the combinations of
+    /// contender, instrumentation and benchmark are run in parallel, see
+    /// worker_pool. The output and results are the same, in the same order.
+    void run(const common::repetition_policy &repetitions, const std::string &resultfn_prefix,
+             bool append_to_files = false,
+             const common::schedule &schedule = common::schedule())
+    {
+        if (schedule.workers > 1 && instrumentations.size() > 0 && benchmarks.size() > 0) {
+            run_parallel(repetitions, resultfn_prefix, append_to_files, schedule);
+            return;
+        }
+        bool first_iteration = !append_to_files;
         for (auto datastructure_factory : contenders) {
-            std::cout << term::bold << term::underline << common::term::set_colour(common::term::colour::fg_green)
-                      << "Benchmarking " << datastructure_factory.description()
-                      << term::reset << std::endl;
+            print_contender_header(datastructure_factory);
 
             std::fstream::openmode res_flags = std::fstream::out;
             // overwrite on first iteration, append afterwards
@@ -46,56 +64,15 @@ public:
             std::vector<common::benchmark_result_aggregate> ds_results;
 
             for (auto instrumentation_factory : instrumentations) {
-                std::cout << term::bold << common::term::set_colour(common::term::colour::fg_yellow)
-                          << "Benchmarking " << datastructure_factory.description()
-                          << " with " << instrumentation_factory.description() << " instrumentation"
-                          << term::reset << std::endl;
+                print_instrumentation_header(datastructure_factory, instrumentation_factory);
 
                 std::fstream res(resultfn_prefix + instrumentation_factory.key() + ".txt", res_flags);
 
                 auto instrumentation = instrumentation_factory();
 
                 for (auto benchmark_factory : benchmarks) {
-                    auto benchmark = benchmark_factory();
-                    // dry run with first configuration to prevent skews
-                    auto initial_configuration = *(benchmark->begin());
-                    delete benchmark->run(datastructure_factory, instrumentation,
-                        initial_configuration);
-
-                    // Run benchmark on all configurations
-                    for (auto configuration : *benchmark) {
-                        common::benchmark_result_aggregate aggregate(instrumentation->new_result(true),
-                            instrumentation->new_result(), instrumentation->new_result());
-
-                        for (size_t rep = 0; rep < repetitions; ++rep) {
-                            // We need to pass in the benchmark factory here so that the
-                            // result object can know its name...
-                            auto t = benchmark->run(datastructure_factory, instrumentation, configuration);
-                            aggregate.add_result(t);
-
-                            // Print RESULT lines for sqlplot-tools
-                            // TODO generalize from tuple config
-                            res << "RESULT"
-                                << " config_1=" << configuration.first
-                                << " config_2=" << configuration.second
-                                << " ds=" << datastructure_factory.key()
-                                << " bench=" << benchmark_factory.key();
-                            t->result(res);
-                            res << std::endl;
-                            delete t;
-                        }
-
-                        aggregate.finish();
-                        aggregate.set_properties(benchmark_factory.description(),
-                            datastructure_factory.description(), configuration,
-                            instrumentation_factory.description());
-
-                        // Aggregate results of multiple runs
-                        std::cout << aggregate << std::endl;
-                        ds_results.emplace_back(std::move(aggregate));
-                    }
-                    delete benchmark;
-                    std::cout << std::endl;
+                    run_benchmark(datastructure_factory, instrumentation_factory, instrumentation,
+                                  benchmark_factory, repetitions, res, std::cout, ds_results);
                 }
                 res.close();
                 delete instrumentation;
@@ -127,27 +104,26 @@ public:
         }
     }
 
+    /// Add the results of a file (result store or text archive) in front
+    /// of those of this run
     void append(const std::string &fn) {
-        // Un-serialize results
-        std::ifstream ifs(fn);
-        if (!ifs.good() || !ifs.is_open()) {
-            std::cerr << "Can't open file for reading: " << fn << std::endl;
-            return;
-        }
-        boost::archive::text_iarchive ia(ifs);
-
         std::vector<std::vector<common::benchmark_result_aggregate>> other_results;
-        ia >> other_results;
-        merge(other_results);
+        if (common::read_results(fn, other_results))
+            merge(other_results);
     }
 
+    /// Write the results to a result store. With append_results, they are
+    /// added to the end of an existing store as a new block, without reading
+    /// it. Text archives of older versions are read and converted.
     void serialize(const std::string &fn, const bool append_results = false) {
+        if (append_results && common::result_store::is_store(fn)) {
+            common::result_store::append(fn, results);
+            return;
+        }
         if (append_results) {
             append(fn);
         }
-        std::ofstream ofs(fn);
-        boost::archive::text_oarchive oa(ofs);
-        oa << results;
+        common::result_store::write(fn, results);
     }
 
     void shutdown() {
@@ -157,11 +133,164 @@ public:
                 result.destroy();
 
 
+#ifdef WITH_PAPI
         // Shut down PAPI if it was used
         if (PAPI_is_initialized() != PAPI_NOT_INITED)
             PAPI_shutdown();
+#endif
     }
 protected:
+    using DataStructureFactory = common::contender_factory<DataStructure>;
+    using InstrumentationFactory = common::contender_factory<common::instrumentation>;
+    using BenchmarkFactory = common::contender_factory<Benchmark>;
+
+    void print_contender_header(DataStructureFactory &datastructure_factory) {
+        std::cout << term::bold << term::underline << common::term::set_colour(common::term::colour::fg_green)
+                  << "Benchmarking " << datastructure_factory.description()
+                  << term::reset << std::endl;
+    }
+
+    void print_instrumentation_header(DataStructureFactory &datastructure_factory,
+                                      InstrumentationFactory &instrumentation_factory)
+    {
+        std::cout << term::bold << common::term::set_colour(common::term::colour::fg_yellow)
+                  << "Benchmarking " << datastructure_factory.description()
+                  << " with " << instrumentation_factory.description() << " instrumentation"
+                  << term::reset << std::endl;
+    }
+
+    /// Run a benchmark on all of its configurations. RESULT lines go to res,
+    /// the aggregated results to ds_results and a description of them to out.
+    void run_benchmark(DataStructureFactory &datastructure_factory,
+                       InstrumentationFactory &instrumentation_factory,
+                       common::instrumentation *instrumentation,
+                       BenchmarkFactory &benchmark_factory,
+                       const common::repetition_policy &repetitions,
+                       std::ostream &res, std::ostream &out,
+                       std::vector<common::benchmark_result_aggregate> &ds_results)
+    {
+        auto benchmark = benchmark_factory();
+        // dry run with first configuration to prevent skews
+        auto initial_configuration = *(benchmark->begin());
+        delete benchmark->run(datastructure_factory, instrumentation,
+            initial_configuration);
+
+        // Run benchmark on all configurations
+        for (auto configuration : *benchmark) {
+            common::benchmark_result_aggregate aggregate(instrumentation->new_result(true),
+                instrumentation->new_result(), instrumentation->new_result(),
+                instrumentation->new_result(), instrumentation->new_result(),
+                instrumentation->new_result());
+
+            // Repeat until the repetition policy is satisfied
+            common::timer elapsed;
+            while (!repetitions.done(aggregate.first_components(), elapsed.get())) {
+                // We need to pass in the benchmark factory here so that the
+                // result object can know its name...
+                auto t = benchmark->run(datastructure_factory, instrumentation, configuration);
+
+                // Print RESULT lines for sqlplot-tools
+                res << "RESULT";
+                common::print_configuration(res, configuration)
+                    << " ds=" << datastructure_factory.key()
+                    << " bench=" << benchmark_factory.key();
+                t->result(res);
+                res << std::endl;
+                aggregate.add_result(t);
+            }
+
+            aggregate.finish();
+            aggregate.set_properties(benchmark_factory.description(),
+                datastructure_factory.description(), configuration,
+                instrumentation_factory.description());
+
+            // Aggregate results of multiple runs
+            out << aggregate << std::endl;
+            ds_results.emplace_back(std::move(aggregate));
+        }
+        delete benchmark;
+        out << std::endl;
+    }
+
+    /// What a worker sends back for one benchmark run by run_benchmark
+    struct unit_output {
+        std::string log, result_lines;
+        std::vector<common::benchmark_result_aggregate> aggregates;
+
+        template <typename Archive>
+        void serialize(Archive & ar, const unsigned int) {
+            ar & log & result_lines & aggregates;
+        }
+    };
+
+    void run_parallel(const common::repetition_policy &repetitions, const std::string &resultfn_prefix,
+                      bool append_to_files, const common::schedule &schedule)
+    {
+        // A unit of work is a benchmark on a contender with an
+        // instrumentation, numbered in the order of the serial run
+        const size_t num_instrumentations = instrumentations.size(),
+                     num_benchmarks = benchmarks.size(),
+                     units_per_contender = num_instrumentations * num_benchmarks;
+        auto contender_of = [=](size_t unit) { return unit / units_per_contender; };
+        auto instrumentation_of = [=](size_t unit) { return unit / num_benchmarks % num_instrumentations; };
+        auto benchmark_of = [=](size_t unit) { return unit % num_benchmarks; };
+
+        common::worker_pool pool(schedule.workers, [&](size_t unit) {
+            auto &instrumentation_factory = instrumentations[instrumentation_of(unit)];
+            auto instrumentation = instrumentation_factory();
+            unit_output output;
+            std::ostringstream res, out;
+            run_benchmark(contenders[contender_of(unit)], instrumentation_factory, instrumentation,
+                          benchmarks[benchmark_of(unit)], repetitions, res, out, output.aggregates);
+            delete instrumentation;
+            output.log = out.str();
+            output.result_lines = res.str();
+
+            std::ostringstream serialized;
+            {
+                boost::archive::text_oarchive oa(serialized);
+                oa << output;
+            }
+            for (auto &aggregate : output.aggregates)
+                aggregate.destroy();
+            return serialized.str();
+        });
+        std::cout << "Running on " << pool.size() << " worker processes" << std::endl;
+
+        std::fstream::openmode res_flags = std::fstream::out;
+        if (append_to_files) res_flags |= std::fstream::app;
+        std::vector<std::fstream> res_files;
+        for (auto &instrumentation_factory : instrumentations)
+            res_files.emplace_back(resultfn_prefix + instrumentation_factory.key() + ".txt", res_flags);
+
+        std::vector<common::benchmark_result_aggregate> ds_results;
+        pool.run(contenders.size() * units_per_contender,
+            [&](size_t unit) { return schedule.runs_alone(benchmarks[benchmark_of(unit)].key()); },
+            [&](size_t unit, const std::string &serialized) {
+                auto &datastructure_factory = contenders[contender_of(unit)];
+                auto &instrumentation_factory = instrumentations[instrumentation_of(unit)];
+                if (unit % units_per_contender == 0)
+                    print_contender_header(datastructure_factory);
+                if (benchmark_of(unit) == 0)
+                    print_instrumentation_header(datastructure_factory, instrumentation_factory);
+
+                unit_output output;
+                std::istringstream in(serialized);
+                boost::archive::text_iarchive ia(in);
+                ia >> output;
+                std::cout << output.log;
+                res_files[instrumentation_of(unit)] << output.result_lines << std::flush;
+                ds_results.insert(ds_results.end(), output.aggregates.begin(), output.aggregates.end());
+
+                if (benchmark_of(unit) == num_benchmarks - 1)
+                    std::cout << std::endl;
+                if (unit % units_per_contender == units_per_contender - 1) {
+                    results.emplace_back(std::move(ds_results));
+                    ds_results.clear();
+                }
+            });
+    }
+
     common::contender_list<DataStructure> &contenders;
     common::contender_list<common::instrumentation> &instrumentations;
     common::contender_list<Benchmark> &benchmarks;
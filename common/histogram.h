@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace common {
+
+/// Histogram of non-negative integers with log-linear buckets, like
+/// HdrHistogram: every power of two is split into the same number of
+/// linear sub-buckets, so that the relative error of every recorded value
+/// is bounded by 2^-SubBucketBits. Values below 2^SubBucketBits are exact.
+template <int SubBucketBits = 7>
+class log_linear_histogram {
+    static_assert(SubBucketBits > 0 && SubBucketBits < 32,
+                  "Number of sub-bucket bits out of range");
+public:
+    log_linear_histogram()
+        : counts(num_buckets, 0), total(0), min_value(UINT64_MAX), max_value(0) {}
+
+    void record(uint64_t value) {
+        ++counts[index_of(value)];
+        ++total;
+        if (value < min_value) min_value = value;
+        if (value > max_value) max_value = value;
+    }
+
+    void merge(const log_linear_histogram &other) {
+        for (size_t i = 0; i < num_buckets; ++i)
+            counts[i] += other.counts[i];
+        total += other.total;
+        if (other.min_value < min_value) min_value = other.min_value;
+        if (other.max_value > max_value) max_value = other.max_value;
+    }
+
+    void clear() {
+        std::fill(counts.begin(), counts.end(), 0);
+        total = 0;
+        min_value = UINT64_MAX;
+        max_value = 0;
+    }
+
+    /// The value below which the given fraction (in [0, 1]) of the recorded
+    /// values lie, up to the resolution of the buckets. 0 if empty.
+    uint64_t percentile(double fraction) const {
+        if (total == 0) return 0;
+        if (fraction >= 1) return max_value;
+        // rank of the requested value, starting at 1
+        uint64_t rank = static_cast<uint64_t>(fraction * total);
+        if (rank < fraction * total || rank == 0) ++rank;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < num_buckets; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                const uint64_t value = value_of(i);
+                // don't report more than what was actually seen
+                return value < min_value ? min_value : value > max_value ? max_value : value;
+            }
+        }
+        return max_value;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total == 0 ? 0 : min_value; }
+    uint64_t max() const { return max_value; }
+
+protected:
+    static constexpr uint64_t sub_buckets = uint64_t{1} << SubBucketBits;
+    static constexpr uint64_t half = sub_buckets / 2;
+    // Exact values below sub_buckets, then half as many buckets for every
+    // bit above SubBucketBits
+    static constexpr size_t num_buckets = sub_buckets + (64 - SubBucketBits) * half;
+
+    static int highest_bit(uint64_t value) {
+        return 63 - __builtin_clzll(value);
+    }
+
+    static size_t index_of(uint64_t value) {
+        if (value < sub_buckets)
+            return value;
+        // value >> shift is in [half, sub_buckets)
+        const int shift = highest_bit(value) - SubBucketBits + 1;
+        return sub_buckets + (shift - 1) * half + ((value >> shift) - half);
+    }
+
+    // The middle of the range of values that map to an index
+    static uint64_t value_of(size_t index) {
+        if (index < sub_buckets)
+            return index;
+        const int shift = static_cast<int>((index - sub_buckets) / half) + 1;
+        const uint64_t lowest = ((index - sub_buckets) % half + half) << shift;
+        return lowest + ((uint64_t{1} << shift) >> 1);
+    }
+
+    std::vector<uint64_t> counts;
+    uint64_t total, min_value, max_value;
+};
+
+}
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <algorithm>
+#include <cmath>
 #include <ostream>
+#ifdef WITH_PAPI
 #include <papi.h>
+#endif
 
 #include "../malloc_count/malloc_count.h"
 
@@ -14,6 +17,10 @@
 
 namespace common {
 
+class latency_histogram;
+class rank_error_log;
+struct displacement_report;
+
 class instrumentation {
 public:
     virtual void setup() = 0;
@@ -21,6 +28,33 @@ public:
     virtual benchmark_result* result() const = 0;
     virtual benchmark_result* new_result(bool set_to_max = false) const = 0;
     virtual ~instrumentation() {}
+
+    /// Called with the number of operations a benchmark reported
+    virtual void add_operations(size_t) {}
+
+    /// Where latencies of single operations go, if they are recorded
+    virtual latency_histogram* latency() { return nullptr; }
+
+    /// Where pushes and pops on relaxed priority queues are logged, if
+    /// their rank errors are measured
+    virtual rank_error_log* rank_errors() { return nullptr; }
+
+    /// Where hash tables report how far their elements are from their home
+    /// slots, if that is measured
+    virtual displacement_report* displacement() { return nullptr; }
+
+    /// The instrumentation of the currently running benchmark, if any
+    static instrumentation*& active() {
+        static instrumentation *current = nullptr;
+        return current;
+    }
+
+    /// Benchmarks that know how many operations they performed report them
+    /// here, e.g. for throughput measurements
+    static void report_operations(size_t operations) {
+        if (active() != nullptr)
+            active()->add_operations(operations);
+    }
 };
 
 class timer_result : public benchmark_result {
@@ -63,6 +97,13 @@ public:
         return os << duration << "ms";
     }
 
+    std::vector<double> components() const override {
+        return std::vector<double>{duration};
+    }
+    void set_components(const std::vector<double> &values) override {
+        duration = values[0];
+    }
+
     template <typename Archive>
     void serialize(Archive & ar, const unsigned int) {
         ar & boost::serialization::base_object<benchmark_result>(*this);
@@ -84,6 +125,85 @@ private:
     double value;
 };
 
+class throughput_result : public benchmark_result {
+    friend class boost::serialization::access;
+    double mops; // million operations per second
+public:
+    throughput_result(double mops) : mops(mops) {}
+    throughput_result() : mops(0) {}
+    virtual ~throughput_result() {}
+
+    bool is_same_type(benchmark_result *other) const override {
+        return dynamic_cast<throughput_result*>(other) != nullptr;
+    }
+
+    std::ostream& print(std::ostream& os) const override {
+        return os << mops << " Mops/s";
+    }
+    std::ostream& result(std::ostream& os) const override {
+        return os << " mops=" << mops;
+    }
+
+    void add(const benchmark_result *const other) override {
+        mops += dynamic_cast<const throughput_result*>(other)->mops;
+    };
+    void min(const benchmark_result *const other) override {
+        mops = std::min(mops, dynamic_cast<const throughput_result*>(other)->mops);
+    };
+    void max(const benchmark_result *const other) override {
+        mops = std::max(mops, dynamic_cast<const throughput_result*>(other)->mops);
+    };
+    void div(const int divisor) override { mops /= divisor; };
+
+    std::vector<double> compare_to(const benchmark_result *other) override {
+        const throughput_result *o = dynamic_cast<const throughput_result*>(other);
+        return std::vector<double>{mops / o->mops};
+    }
+
+    std::ostream& print_component(int component, std::ostream &os) override {
+        assert(component == 0); (void)component;
+        return os << mops << " Mops/s";
+    }
+
+    std::vector<double> components() const override {
+        return std::vector<double>{mops};
+    }
+    void set_components(const std::vector<double> &values) override {
+        mops = values[0];
+    }
+    bool larger_is_better(int) const override { return true; }
+
+    template <typename Archive>
+    void serialize(Archive & ar, const unsigned int) {
+        ar & boost::serialization::base_object<benchmark_result>(*this);
+        ar & mops;
+    }
+};
+
+/// Measures the throughput of benchmarks that report their number of
+/// operations through instrumentation::report_operations
+class throughput_instrumentation : public instrumentation {
+public:
+    void setup() { operations = 0; t.reset(); }
+    void finish() { duration = t.get(); }
+    void add_operations(size_t ops) override { operations += ops; }
+    virtual throughput_result* result() const {
+        // duration is in milliseconds
+        return new throughput_result(duration > 0 ? operations / (duration * 1000) : 0);
+    }
+    virtual benchmark_result* new_result(bool set_to_max = false) const {
+        return new throughput_result(set_to_max ? 1e100 : 0);
+    };
+    virtual ~throughput_instrumentation() = default;
+private:
+    timer t;
+    double duration;
+    size_t operations;
+};
+
+#ifdef WITH_PAPI
+/// Only available when building with PAPI, see perf_instrumentation.h for
+/// hardware counters without it
 class papi_result : public benchmark_result {
     friend class boost::serialization::access;
     long long counters[3];
@@ -170,6 +290,19 @@ public:
         };
     }
 
+    std::vector<double> components() const override {
+        return std::vector<double>{
+            static_cast<double>(counters[0]),
+            static_cast<double>(counters[1]),
+            static_cast<double>(counters[2])
+        };
+    }
+    void set_components(const std::vector<double> &values) override {
+        counters[0] = std::llround(values[0]);
+        counters[1] = std::llround(values[1]);
+        counters[2] = std::llround(values[2]);
+    }
+
     template <typename Archive>
     void serialize(Archive & ar, const unsigned int) {
         ar & boost::serialization::base_object<benchmark_result>(*this);
@@ -216,6 +349,7 @@ public:
 
 using papi_instrumentation_cache = papi_instrumentation<>;
 using papi_instrumentation_instr = papi_instrumentation<PAPI_BR_MSP, PAPI_TOT_INS, PAPI_TOT_CYC>;
+#endif
 
 
 class memory_result : public benchmark_result {
@@ -286,6 +420,19 @@ public:
         }
     }
 
+    std::vector<double> components() const override {
+        return std::vector<double>{
+            static_cast<double>(total),
+            static_cast<double>(peak),
+            static_cast<double>(count)
+        };
+    }
+    void set_components(const std::vector<double> &values) override {
+        total = std::llround(values[0]);
+        peak  = std::llround(values[1]);
+        count = std::llround(values[2]);
+    }
+
     template <typename Archive>
     void serialize(Archive & ar, const unsigned int) {
         ar & boost::serialization::base_object<benchmark_result>(*this);
@@ -337,8 +484,13 @@ BOOST_CLASS_EXPORT_KEY(common::benchmark_result)
 BOOST_CLASS_EXPORT_KEY(common::timer_result)
 BOOST_CLASS_EXPORT_IMPLEMENT(common::timer_result)
 
+BOOST_CLASS_EXPORT_KEY(common::throughput_result)
+BOOST_CLASS_EXPORT_IMPLEMENT(common::throughput_result)
+
+#ifdef WITH_PAPI
 BOOST_CLASS_EXPORT_KEY(common::papi_result)
 BOOST_CLASS_EXPORT_IMPLEMENT(common::papi_result)
+#endif
 
 BOOST_CLASS_EXPORT_KEY(common::memory_result)
 BOOST_CLASS_EXPORT_IMPLEMENT(common::memory_result)
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/export.hpp>
+
+#include "benchmark.h"
+#include "histogram.h"
+#include "instrumentation.h"
+
+namespace common {
+
+namespace util {
+    /// Read the time stamp counter after all previous instructions have
+    /// finished, and before any later ones start. Falls back to a clock
+    /// with nanosecond ticks where there is no time stamp counter.
+    inline uint64_t rdtscp() {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned int aux;
+        const uint64_t ticks = __rdtscp(&aux);
+        _mm_lfence();
+        return ticks;
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+}
+
+/// Histogram of operation latencies in time stamp counter ticks
+class latency_histogram : public log_linear_histogram<> {};
+
+class latency_result : public benchmark_result {
+    friend class boost::serialization::access;
+public:
+    static constexpr int num_components = 6;
+private:
+    double values[num_components]; // nanoseconds
+    double operations; // number of timed operations
+
+    static const char* name(int component) {
+        static const char* names[num_components] = {"p50", "p90", "p99", "p99.9", "p99.99", "max"};
+        return names[component];
+    }
+    // for RESULT lines
+    static const char* column(int component) {
+        static const char* columns[num_components] = {"lat_p50", "lat_p90", "lat_p99",
+                                                      "lat_p999", "lat_p9999", "lat_max"};
+        return columns[component];
+    }
+public:
+    latency_result(bool set_to_max = false) : operations(set_to_max ? 1e100 : 0) {
+        std::fill(values, values + num_components, set_to_max ? 1e100 : 0);
+    }
+    /// Percentiles of the histogram, which counts ticks_per_ns ticks per
+    /// nanosecond and overhead ticks for measuring an empty operation
+    latency_result(const latency_histogram &histogram, double ticks_per_ns, uint64_t overhead)
+        : operations(histogram.count())
+    {
+        const double fractions[num_components] = {0.5, 0.9, 0.99, 0.999, 0.9999, 1};
+        for (int i = 0; i < num_components; ++i) {
+            const uint64_t ticks = histogram.percentile(fractions[i]);
+            values[i] = (ticks > overhead ? ticks - overhead : 0) / ticks_per_ns;
+        }
+    }
+    virtual ~latency_result() {}
+
+    bool is_same_type(benchmark_result *other) const override {
+        return dynamic_cast<latency_result*>(other) != nullptr;
+    }
+
+    std::ostream& print(std::ostream& os) const override {
+        if (operations == 0)
+            return os << "no operations timed";
+        for (int i = 0; i < num_components; ++i)
+            os << (i > 0 ? "; " : "") << name(i) << ": " << values[i] << "ns";
+        return os;
+    }
+    std::ostream& result(std::ostream& os) const override {
+        for (int i = 0; i < num_components; ++i)
+            os << " " << column(i) << "=" << values[i];
+        return os;
+    }
+
+    void add(const benchmark_result *const other) override {
+        const latency_result* o = dynamic_cast<const latency_result*>(other);
+        for (int i = 0; i < num_components; ++i)
+            values[i] += o->values[i];
+        operations += o->operations;
+    };
+    void min(const benchmark_result *const other) override {
+        const latency_result* o = dynamic_cast<const latency_result*>(other);
+        for (int i = 0; i < num_components; ++i)
+            values[i] = std::min(values[i], o->values[i]);
+        operations = std::min(operations, o->operations);
+    };
+    void max(const benchmark_result *const other) override {
+        const latency_result* o = dynamic_cast<const latency_result*>(other);
+        for (int i = 0; i < num_components; ++i)
+            values[i] = std::max(values[i], o->values[i]);
+        operations = std::max(operations, o->operations);
+    };
+    void div(const int divisor) override {
+        for (int i = 0; i < num_components; ++i)
+            values[i] /= divisor;
+        operations /= divisor;
+    };
+
+    std::vector<double> compare_to(const benchmark_result *other) override {
+        const latency_result *o = dynamic_cast<const latency_result*>(other);
+        std::vector<double> ratios;
+        for (int i = 0; i < num_components; ++i) {
+            if (values[i] == 0 && o->values[i] == 0) ratios.push_back(1.0);
+            else ratios.push_back(values[i] / o->values[i]);
+        }
+        return ratios;
+    }
+
+    std::ostream& print_component(int component, std::ostream &os) override {
+        assert(component >= 0 && component < num_components);
+        return os << name(component) << ": " << values[component] << "ns";
+    }
+
+    std::vector<double> components() const override {
+        return std::vector<double>(values, values + num_components);
+    }
+    void set_components(const std::vector<double> &v) override {
+        std::copy(v.begin(), v.begin() + num_components, values);
+    }
+
+    template <typename Archive>
+    void serialize(Archive & ar, const unsigned int) {
+        ar & boost::serialization::base_object<benchmark_result>(*this);
+        ar & values & operations;
+    }
+};
+
+/// Records the latency of every operation that benchmarks time with a
+/// latency_probe and reports percentiles of their distribution
+class latency_instrumentation : public instrumentation {
+public:
+    latency_instrumentation() {
+        calibrate();
+    }
+    virtual ~latency_instrumentation() = default;
+
+    void setup() { histogram.clear(); }
+    void finish() {}
+    latency_histogram* latency() override { return &histogram; }
+
+    virtual latency_result* result() const {
+        return new latency_result(histogram, ticks_per_ns, overhead);
+    }
+    virtual benchmark_result* new_result(bool set_to_max = false) const {
+        return new latency_result(set_to_max);
+    };
+
+private:
+    // Determine the tick rate against the system clock, and the cost of
+    // timing an empty operation
+    void calibrate() {
+        const auto start_time = std::chrono::steady_clock::now();
+        const uint64_t start = util::rdtscp();
+        while (std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(10)) {}
+        const uint64_t ticks = util::rdtscp() - start;
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_time).count();
+        ticks_per_ns = ns > 0 ? static_cast<double>(ticks) / ns : 1;
+
+        overhead = UINT64_MAX;
+        for (int i = 0; i < 1000; ++i) {
+            const uint64_t begin = util::rdtscp();
+            overhead = std::min(overhead, util::rdtscp() - begin);
+        }
+    }
+
+    latency_histogram histogram;
+    double ticks_per_ns;
+    uint64_t overhead;
+};
+
+/// Benchmarks run single operations through a probe to have their latency
+/// recorded. Unless a latency instrumentation is active, it only runs them.
+class latency_probe {
+public:
+    latency_probe()
+        : histogram(instrumentation::active() == nullptr ? nullptr
+                    : instrumentation::active()->latency()) {}
+
+    template <typename F>
+    void operator()(F &&operation) {
+        if (histogram == nullptr) {
+            operation();
+            return;
+        }
+        const uint64_t start = util::rdtscp();
+        operation();
+        histogram->record(util::rdtscp() - start);
+    }
+
+private:
+    latency_histogram *histogram;
+};
+
+}
+
+BOOST_CLASS_EXPORT_KEY(common::latency_result)
+BOOST_CLASS_EXPORT_IMPLEMENT(common::latency_result)
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/export.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include "benchmark.h"
+#include "instrumentation.h"
+
+namespace common {
+
+/// A hardware or software event that can be counted with perf_event_open
+struct perf_event {
+    std::string name;
+    uint32_t type;
+    uint64_t config;
+
+    /// All events that can be selected by name, using perf's names for them.
+    /// Raw events can be selected as "r<hex>", as in perf.
+    static const std::vector<perf_event>& known_events() {
+        static const std::vector<perf_event> events{
+            {"cycles",                  PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"instructions",            PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"cache-references",        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+            {"cache-misses",            PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {"branches",                PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+            {"branch-misses",           PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {"bus-cycles",              PERF_TYPE_HARDWARE, PERF_COUNT_HW_BUS_CYCLES},
+            {"ref-cycles",              PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES},
+            {"stalled-cycles-frontend", PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+            {"stalled-cycles-backend",  PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+            {"L1-dcache-loads",         PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_ACCESS)},
+            {"L1-dcache-load-misses",   PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {"L1-icache-load-misses",   PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_L1I, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {"LLC-loads",               PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_RESULT_ACCESS)},
+            {"LLC-load-misses",         PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {"dTLB-loads",              PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_RESULT_ACCESS)},
+            {"dTLB-load-misses",        PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {"iTLB-load-misses",        PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_ITLB, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {"task-clock",              PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+            {"page-faults",             PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+            {"minor-faults",            PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN},
+            {"major-faults",            PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ},
+            {"context-switches",        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+            {"cpu-migrations",          PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+        };
+        return events;
+    }
+
+    /// Look up an event by name, throws std::invalid_argument if unknown
+    static perf_event parse(const std::string &name) {
+        for (const perf_event &event : known_events()) {
+            if (event.name == name)
+                return event;
+        }
+        if (name.size() > 1 && name[0] == 'r' &&
+            name.find_first_not_of("0123456789abcdefABCDEF", 1) == std::string::npos) {
+            return perf_event{name, PERF_TYPE_RAW, std::stoull(name.substr(1), nullptr, 16)};
+        }
+        throw std::invalid_argument("unknown perf event: " + name);
+    }
+
+    /// Parse a list of event groups. Events are separated by commas, groups
+    /// by slashes, e.g. "cycles,instructions/LLC-loads,LLC-load-misses".
+    static std::vector<std::vector<perf_event>> parse_groups(const std::string &list) {
+        std::vector<std::vector<perf_event>> groups(1);
+        std::string name;
+        for (size_t i = 0; i <= list.size(); ++i) {
+            if (i < list.size() && list[i] != ',' && list[i] != '/') {
+                name += list[i];
+                continue;
+            }
+            if (!name.empty())
+                groups.back().push_back(parse(name));
+            name.clear();
+            if (i < list.size() && list[i] == '/' && !groups.back().empty())
+                groups.emplace_back();
+        }
+        if (groups.back().empty())
+            groups.pop_back();
+        if (groups.empty())
+            throw std::invalid_argument("empty perf event list");
+        return groups;
+    }
+
+private:
+    static constexpr uint64_t cache(uint64_t id, uint64_t result) {
+        return id | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+    }
+};
+
+/// Counter values for any number of named events
+class perf_result : public benchmark_result {
+    friend class boost::serialization::access;
+    std::vector<std::string> events;
+    std::vector<long long> counters;
+public:
+    perf_result() {}
+    perf_result(const std::vector<std::string> &events, bool set_to_max = false)
+        : events(events), counters(events.size(), set_to_max ? ((long long)1)<<62 : 0) {}
+    perf_result(const std::vector<std::string> &events, const std::vector<long long> &counters)
+        : events(events), counters(counters) { assert(events.size() == counters.size()); }
+    virtual ~perf_result() {}
+
+    bool is_same_type(benchmark_result *other) const override {
+        perf_result* ptr = dynamic_cast<perf_result*>(other);
+        // Even if type matches, check that they describe the same events
+        return ptr != nullptr && events == ptr->events;
+    }
+
+    std::ostream& print(std::ostream& os) const override {
+        for (size_t i = 0; i < events.size(); ++i) {
+            os << (i > 0 ? "; " : "") << events[i] << ": " << counters[i];
+        }
+        return os << ".";
+    }
+
+    std::ostream& print_component(int component, std::ostream &os) override {
+        assert(component >= 0 && static_cast<size_t>(component) < events.size());
+        return os << events[component] << ": " << counters[component];
+    }
+
+    std::ostream& result(std::ostream& os) const override {
+        for (size_t i = 0; i < events.size(); ++i) {
+            os << " " << format_result_column(std::string{events[i]}) << "=" << counters[i];
+        }
+        return os;
+    }
+
+    void add(const benchmark_result *const other) override {
+        const perf_result* o = dynamic_cast<const perf_result*>(other);
+        for (size_t i = 0; i < counters.size(); ++i)
+            counters[i] += o->counters[i];
+    };
+    void min(const benchmark_result *const other) override {
+        const perf_result* o = dynamic_cast<const perf_result*>(other);
+        for (size_t i = 0; i < counters.size(); ++i)
+            counters[i] = std::min(counters[i], o->counters[i]);
+    };
+    void max(const benchmark_result *const other) override {
+        const perf_result* o = dynamic_cast<const perf_result*>(other);
+        for (size_t i = 0; i < counters.size(); ++i)
+            counters[i] = std::max(counters[i], o->counters[i]);
+    };
+    void div(const int divisor) override {
+        for (long long &counter : counters)
+            counter /= divisor;
+    };
+
+    std::vector<double> compare_to(const benchmark_result *other) override {
+        const perf_result *o = dynamic_cast<const perf_result*>(other);
+        std::vector<double> ratios;
+        for (size_t i = 0; i < counters.size(); ++i) {
+            if (counters[i] == 0 && o->counters[i] == 0) ratios.push_back(1.0);
+            else ratios.push_back((counters[i] * 1.0) / o->counters[i]);
+        }
+        return ratios;
+    }
+
+    std::vector<double> components() const override {
+        return std::vector<double>(counters.begin(), counters.end());
+    }
+    void set_components(const std::vector<double> &values) override {
+        for (size_t i = 0; i < counters.size(); ++i)
+            counters[i] = std::llround(values[i]);
+    }
+
+    template <typename Archive>
+    void serialize(Archive & ar, const unsigned int) {
+        ar & boost::serialization::base_object<benchmark_result>(*this);
+        ar & events & counters;
+    }
+};
+
+/// Counts hardware events with the Linux perf_event interface. Each group
+/// of events is scheduled onto the PMU as a whole. If there are more events
+/// than counters, the kernel multiplexes the groups, and every counter is
+/// extrapolated with its group's ratio of enabled to running time.
+/// Only user-space events of the calling thread are counted.
+class perf_instrumentation : public instrumentation {
+    struct group {
+        std::vector<int> fds; // first one is the group leader
+        size_t first;         // index of its first event in the result
+    };
+    std::vector<group> groups;
+    std::vector<std::string> names;
+    std::vector<long long> counters;
+    perf_instrumentation(const perf_instrumentation &) = delete;
+public:
+    perf_instrumentation(const std::vector<std::vector<perf_event>> &event_groups) {
+        for (const auto &events : event_groups) {
+            group g{{}, names.size()};
+            for (const perf_event &event : events) {
+                names.push_back(event.name);
+                const int leader = g.fds.empty() ? -1 : g.fds[0];
+                if (!g.fds.empty() && leader < 0) {
+                    // no group to add it to
+                    g.fds.push_back(-1);
+                    continue;
+                }
+                const int fd = open_event(event, leader);
+                if (fd < 0) {
+                    std::cerr << "perf_event_open failed for " << event.name << ": "
+                              << std::strerror(errno) << std::endl;
+                }
+                g.fds.push_back(fd);
+            }
+            groups.push_back(g);
+        }
+        counters.assign(names.size(), 0);
+    }
+
+    perf_instrumentation(const std::string &event_list)
+        : perf_instrumentation(perf_event::parse_groups(event_list)) {}
+
+    virtual ~perf_instrumentation() {
+        for (const group &g : groups) {
+            for (const int fd : g.fds) {
+                if (fd >= 0) close(fd);
+            }
+        }
+    }
+
+    void setup() {
+        for (const group &g : groups) {
+            if (g.fds[0] < 0) continue;
+            ioctl(g.fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(g.fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    void finish() {
+        for (const group &g : groups) {
+            if (g.fds[0] >= 0)
+                ioctl(g.fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        }
+        for (const group &g : groups) {
+            read_group(g);
+        }
+    }
+
+    perf_result* result() const {
+        return new perf_result(names, counters);
+    }
+
+    virtual benchmark_result* new_result(bool set_to_max = false) const {
+        return new perf_result(names, set_to_max);
+    };
+
+protected:
+    static int open_event(const perf_event &event, int leader) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = event.type;
+        attr.config = event.config;
+        attr.disabled = (leader == -1);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED
+            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0));
+    }
+
+    // Read all counters of a group at once and correct them for the time
+    // the group wasn't scheduled on the PMU
+    void read_group(const group &g) {
+        const size_t n = g.fds.size();
+        std::fill(counters.begin() + g.first, counters.begin() + g.first + n, 0);
+        if (g.fds[0] < 0) return;
+
+        // nr, time_enabled, time_running, value[nr]
+        std::vector<uint64_t> buf(3 + n);
+        const ssize_t bytes = ::read(g.fds[0], buf.data(), buf.size() * sizeof(uint64_t));
+        if (bytes < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+            std::cerr << "Reading perf counters failed: " << std::strerror(errno) << std::endl;
+            return;
+        }
+        const uint64_t enabled = buf[1], running = buf[2];
+        if (running == 0) {
+            std::cerr << "perf event group starting with " << names[g.first]
+                      << " was never scheduled" << std::endl;
+            return;
+        }
+        const double scale = static_cast<double>(enabled) / running;
+        // Members that couldn't be opened aren't part of the group
+        for (size_t i = 0, value = 0; i < n && value < buf[0]; ++i) {
+            if (g.fds[i] < 0) continue;
+            counters[g.first + i] = static_cast<long long>(buf[3 + value++] * scale + 0.5);
+        }
+    }
+};
+
+/// Cache misses, like the cache PAPI instrumentation
+inline perf_instrumentation* perf_instrumentation_cache() {
+    return new perf_instrumentation("L1-dcache-load-misses,LLC-load-misses,dTLB-load-misses");
+}
+
+/// Branch mispredictions, instructions and cycles, like the instruction PAPI
+/// instrumentation
+inline perf_instrumentation* perf_instrumentation_instr() {
+    return new perf_instrumentation("branch-misses,instructions,cycles");
+}
+
+}
+
+BOOST_CLASS_EXPORT_KEY(common::perf_result)
+BOOST_CLASS_EXPORT_IMPLEMENT(common::perf_result)
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/export.hpp>
+
+#include "benchmark.h"
+#include "histogram.h"
+#include "instrumentation.h"
+
+namespace common {
+
+/// Log of the pushes and pops on a relaxed concurrent priority queue, from
+/// which the rank error of every pop can be computed afterwards: the number
+/// of elements in the queue that should have been popped before it. Every
+/// operation gets a stamp from a global counter, pushes before and pops
+/// after they happen. Replaying the log in stamp order approximates the
+/// order in which the operations took effect.
+class rank_error_log {
+public:
+    struct event {
+        uint64_t stamp;
+        int64_t value;
+        bool push;
+    };
+
+    void clear() {
+        initial.clear();
+        events.clear();
+        clock.store(0);
+    }
+
+    /// Start logging from the given number of threads, on a queue that
+    /// already holds the values [begin, end)
+    template <typename It>
+    void start(size_t threads, It begin, It end) {
+        clear();
+        initial.assign(begin, end);
+        events.resize(threads);
+    }
+
+    uint64_t stamp() {
+        return clock.fetch_add(1);
+    }
+
+    /// The log of one thread, only to be used by that thread
+    std::vector<event>& thread(size_t index) {
+        return events[index];
+    }
+
+    /// Replay the log and pass the rank error of every pop to
+    /// ranks.record() (for a max-queue, so larger values should be popped
+    /// first)
+    template <typename Recorder>
+    void evaluate(Recorder &ranks) const {
+        std::vector<event> all;
+        for (const auto &log : events)
+            all.insert(all.end(), log.begin(), log.end());
+        std::sort(all.begin(), all.end(),
+            [](const event &a, const event &b) { return a.stamp < b.stamp; });
+
+        // Count the values in the queue with a Fenwick tree over their ranks
+        std::vector<int64_t> values(initial);
+        for (const event &e : all)
+            values.push_back(e.value);
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        std::vector<int64_t> tree(values.size() + 1, 0);
+        auto index = [&values](int64_t value) -> size_t {
+            return std::lower_bound(values.begin(), values.end(), value) - values.begin() + 1;
+        };
+        auto update = [&tree](size_t i, int64_t delta) {
+            for (; i < tree.size(); i += i & -i) tree[i] += delta;
+        };
+        // Number of values at ranks up to i
+        auto prefix = [&tree](size_t i) {
+            int64_t sum = 0;
+            for (; i > 0; i -= i & -i) sum += tree[i];
+            return sum;
+        };
+
+        int64_t size = 0;
+        for (int64_t value : initial) {
+            update(index(value), 1);
+            ++size;
+        }
+        for (const event &e : all) {
+            const size_t i = index(e.value);
+            if (e.push) {
+                update(i, 1);
+                ++size;
+            } else {
+                // A value is stamped before it is pushed and after it is
+                // popped, so it is always there when its pop is replayed
+                assert(prefix(i) - prefix(i - 1) > 0);
+                ranks.record(size - prefix(i));
+                update(i, -1);
+                --size;
+            }
+        }
+    }
+
+private:
+    std::vector<int64_t> initial;
+    std::vector<std::vector<event>> events;
+    std::atomic<uint64_t> clock{0};
+};
+
+
+class rank_error_result : public benchmark_result {
+    friend class boost::serialization::access;
+public:
+    static constexpr int num_components = 3;
+private:
+    double values[num_components];
+    double pops; // number of logged pops
+
+    static const char* name(int component) {
+        static const char* names[num_components] = {"mean rank error", "p99 rank error", "max rank error"};
+        return names[component];
+    }
+    // for RESULT lines
+    static const char* column(int component) {
+        static const char* columns[num_components] = {"rank_mean", "rank_p99", "rank_max"};
+        return columns[component];
+    }
+public:
+    rank_error_result(bool set_to_max = false) : pops(set_to_max ? 1e100 : 0) {
+        std::fill(values, values + num_components, set_to_max ? 1e100 : 0);
+    }
+    rank_error_result(double mean, double p99, double max, double pops)
+        : values{mean, p99, max}, pops(pops) {}
+    virtual ~rank_error_result() {}
+
+    bool is_same_type(benchmark_result *other) const override {
+        return dynamic_cast<rank_error_result*>(other) != nullptr;
+    }
+
+    std::ostream& print(std::ostream& os) const override {
+        if (pops == 0)
+            return os << "no pops logged";
+        for (int i = 0; i < num_components; ++i)
+            os << (i > 0 ? "; " : "") << name(i) << ": " << values[i];
+        return os;
+    }
+    std::ostream& result(std::ostream& os) const override {
+        for (int i = 0; i < num_components; ++i)
+            os << " " << column(i) << "=" << values[i];
+        return os;
+    }
+
+    void add(const benchmark_result *const other) override {
+        const rank_error_result* o = dynamic_cast<const rank_error_result*>(other);
+        for (int i = 0; i < num_components; ++i)
+            values[i] += o->values[i];
+        pops += o->pops;
+    };
+    void min(const benchmark_result *const other) override {
+        const rank_error_result* o = dynamic_cast<const rank_error_result*>(other);
+        for (int i = 0; i < num_components; ++i)
+            values[i] = std::min(values[i], o->values[i]);
+        pops = std::min(pops, o->pops);
+    };
+    void max(const benchmark_result *const other) override {
+        const rank_error_result* o = dynamic_cast<const rank_error_result*>(other);
+        for (int i = 0; i < num_components; ++i)
+            values[i] = std::max(values[i], o->values[i]);
+        pops = std::max(pops, o->pops);
+    };
+    void div(const int divisor) override {
+        for (int i = 0; i < num_components; ++i)
+            values[i] /= divisor;
+        pops /= divisor;
+    };
+
+    std::vector<double> compare_to(const benchmark_result *other) override {
+        const rank_error_result *o = dynamic_cast<const rank_error_result*>(other);
+        std::vector<double> ratios;
+        for (int i = 0; i < num_components; ++i) {
+            if (values[i] == 0 && o->values[i] == 0) ratios.push_back(1.0);
+            else ratios.push_back(values[i] / o->values[i]);
+        }
+        return ratios;
+    }
+
+    std::ostream& print_component(int component, std::ostream &os) override {
+        assert(component >= 0 && component < num_components);
+        return os << name(component) << ": " << values[component];
+    }
+
+    std::vector<double> components() const override {
+        return std::vector<double>(values, values + num_components);
+    }
+    void set_components(const std::vector<double> &v) override {
+        std::copy(v.begin(), v.begin() + num_components, values);
+    }
+
+    template <typename Archive>
+    void serialize(Archive & ar, const unsigned int) {
+        ar & boost::serialization::base_object<benchmark_result>(*this);
+        ar & values & pops;
+    }
+};
+
+/// Measures how far the elements that benchmarks pop from a relaxed priority
+/// queue are from the top, for benchmarks that log their operations with
+/// rank_error_probes
+class rank_error_instrumentation : public instrumentation {
+public:
+    virtual ~rank_error_instrumentation() = default;
+
+    void setup() {
+        log.clear();
+        ranks.clear();
+        sum = 0;
+    }
+    void finish() {
+        log.evaluate(*this);
+    }
+    rank_error_log* rank_errors() override { return &log; }
+
+    /// Called by rank_error_log::evaluate
+    void record(uint64_t rank) {
+        ranks.record(rank);
+        sum += rank;
+    }
+
+    virtual rank_error_result* result() const {
+        const double pops = ranks.count();
+        return new rank_error_result(pops > 0 ? sum / pops : 0, ranks.percentile(0.99),
+                                     ranks.max(), pops);
+    }
+    virtual benchmark_result* new_result(bool set_to_max = false) const {
+        return new rank_error_result(set_to_max);
+    };
+
+private:
+    rank_error_log log;
+    log_linear_histogram<> ranks;
+    double sum;
+};
+
+/// Every thread logs the values it pushes and pops through its own probe.
+/// Unless a rank error instrumentation is active, it does nothing.
+class rank_error_probe {
+public:
+    rank_error_probe(size_t thread)
+        : log(instrumentation::active() == nullptr ? nullptr
+              : instrumentation::active()->rank_errors())
+        , events(log == nullptr ? nullptr : &log->thread(thread)) {}
+
+    void pushed(int64_t value) {
+        if (log != nullptr)
+            events->push_back(rank_error_log::event{log->stamp(), value, true});
+    }
+
+    void popped(int64_t value) {
+        if (log != nullptr)
+            events->push_back(rank_error_log::event{log->stamp(), value, false});
+    }
+
+private:
+    rank_error_log *log;
+    std::vector<rank_error_log::event> *events;
+};
+
+/// Start logging in a benchmark, if a rank error instrumentation is active,
+/// on a queue that holds the values [begin, end)
+template <typename It>
+void start_rank_error_log(size_t threads, It begin, It end) {
+    if (instrumentation::active() == nullptr) return;
+    rank_error_log *log = instrumentation::active()->rank_errors();
+    if (log != nullptr)
+        log->start(threads, begin, end);
+}
+
+}
+
+BOOST_CLASS_EXPORT_KEY(common::rank_error_result)
+BOOST_CLASS_EXPORT_IMPLEMENT(common::rank_error_result)
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "benchmark.h"
+#include "terminal.h"
+
+namespace common {
+
+/// Compares a candidate's results against a baseline's, e.g. a new build of
+/// a hash table against the last one, for every benchmark, configuration
+/// and instrumentation they have in common. A component counts as changed
+/// if the Mann-Whitney U test on the runs of both says that the difference
+/// is significant at level alpha, and the ratio of the medians is at least
+/// the cutoff (either way). Changes for the worse are regressions.
+///
+/// A check is only conclusive if it could test every component of the
+/// results that both have. It can't with too few runs, nor for results that
+/// occur more than once in a file (e.g. from runs appended to one store),
+/// as it can't tell which of them to compare.
+class regression_check {
+public:
+    using result = benchmark_result_aggregate;
+    using Results = std::vector<std::vector<result>>;
+
+    struct change {
+        result *baseline, *candidate;
+        int component;
+        double ratio; // candidate / baseline, of the medians
+        double p;
+        bool regression;
+    };
+
+    regression_check(Results &baseline, Results &candidate, double cutoff = 1.05, double alpha = 0.05)
+        : baseline(baseline), candidate(candidate), cutoff(cutoff), alpha(alpha)
+        , unmatched(0), untested(0), ambiguous(0) {}
+
+    void compare() {
+        std::map<key_type, std::vector<result*>> base;
+        for (auto &ds_results : baseline)
+            for (auto &res : ds_results)
+                base[key(res)].push_back(&res);
+        std::map<key_type, size_t> occurrences;
+        for (auto &ds_results : candidate)
+            for (auto &cand : ds_results)
+                ++occurrences[key(cand)];
+
+        for (auto &ds_results : candidate) {
+            for (auto &cand : ds_results) {
+                auto it = base.find(key(cand));
+                if (it == base.end() || !it->second.front()->is_same_type(cand)) {
+                    ++unmatched;
+                    continue;
+                }
+                if (it->second.size() > 1 || occurrences[key(cand)] > 1) {
+                    ++ambiguous;
+                    continue;
+                }
+                result &base_res = *it->second.front();
+                const auto p = base_res.significance(cand, alpha);
+                const auto base_medians = base_res.medians(),
+                           cand_medians = cand.medians();
+                for (size_t c = 0; c < p.size(); ++c) {
+                    if (std::isnan(p[c])) {
+                        ++untested;
+                        continue;
+                    }
+                    const double ratio = divide(cand_medians[c], base_medians[c]);
+                    const double factor = ratio < 1 ? 1 / ratio : ratio;
+                    if (p[c] >= alpha || factor < cutoff) continue;
+                    const bool worse = base_res.larger_is_better(c) ? ratio < 1 : ratio > 1;
+                    changes.push_back(change{&base_res, &cand, static_cast<int>(c), ratio, p[c], worse});
+                }
+            }
+        }
+
+        // Largest changes first
+        std::sort(changes.begin(), changes.end(), [](const change &l, const change &r) {
+            return std::max(l.ratio, 1 / l.ratio) > std::max(r.ratio, 1 / r.ratio);
+        });
+    }
+
+    size_t regressions() const {
+        return std::count_if(changes.begin(), changes.end(),
+                             [](const change &c) { return c.regression; });
+    }
+
+    /// Whether every component of the matched results could be tested
+    bool conclusive() const {
+        return untested == 0 && ambiguous == 0;
+    }
+
+    std::ostream& print(std::ostream &os, size_t max_results = 20) const {
+        os << term::bold << "Significant changes (p < " << alpha << ", at least "
+           << cutoff << "x) of the candidate against the baseline:" << term::reset << std::endl;
+
+        // Regressions first, so that they can't be cut off by improvements
+        for (bool regression : {true, false}) {
+            size_t printed = 0;
+            for (const change &c : changes) {
+                if (c.regression != regression) continue;
+                if (printed++ == max_results) {
+                    os << "..." << std::endl;
+                    break;
+                }
+                os << term::bold << term::set_colour(regression ? term::colour::fg_red : term::colour::fg_green)
+                   << (regression ? "Regression " : "Improvement ") << c.ratio << "x" << term::reset
+                   << " (p = " << c.p << ") with " << c.baseline->instrumentation_desc() << " in ";
+                c.candidate->describe(os);
+                c.candidate->print_median_component(c.component, os) << "; baseline: ";
+                c.baseline->print_median_component(c.component, os) << std::endl;
+            }
+        }
+        if (changes.empty())
+            os << "No significant changes" << std::endl;
+
+        if (unmatched > 0)
+            os << unmatched << " results of the candidate have no counterpart in the baseline" << std::endl;
+        if (ambiguous > 0)
+            os << term::bold << ambiguous << " results occur more than once in the baseline or the "
+               << "candidate and were not compared" << term::reset << std::endl;
+        if (untested > 0)
+            os << term::bold << untested << " components have too few runs to test (use -n or -ci)"
+               << term::reset << std::endl;
+        return os;
+    }
+
+protected:
+    using key_type = std::tuple<std::string, std::string, std::string, std::string>;
+
+    static key_type key(const result &res) {
+        return std::make_tuple(res.instance_desc(), res.benchmark_name(),
+                               res.configuration_desc(), res.instrumentation_desc());
+    }
+
+    static double divide(double a, double b) {
+        if (a == b) return 1;
+        if (b == 0) return std::numeric_limits<double>::infinity();
+        return a / b;
+    }
+
+    Results &baseline, &candidate;
+    std::vector<change> changes;
+    double cutoff, alpha;
+    size_t unmatched, untested, ambiguous;
+};
+
+}
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include "benchmark.h"
+
+namespace common {
+
+/// Binary file of serialized results that new runs are appended to without
+/// reading or rewriting what is already there, and that is read through a
+/// memory mapping without parsing.
+///
+/// The file starts with a 16-byte header: the magic "ALGENRES", the schema
+/// version and 4 unused bytes. Each run adds a block with all of its results,
+/// which starts with its size so that readers can skip it. A block consists
+/// of (all sections 8-byte aligned, native byte order):
+///  - the block header (see block_header)
+///  - the number of results of each contender (uint32)
+///  - a record for each result (see record)
+///  - the end offsets of the strings and prototypes (uint64)
+///  - the columns of the records (double): the components of the minimum,
+///    maximum and average, and if the record has them, the median,
+///    standard deviation and MAD, followed by the components of every run,
+///    one component after the other
+///  - the characters of the strings, followed by the prototypes
+/// Strings (benchmark, instance, configuration and instrumentation names)
+/// are stored once per block. A prototype is a result object with all
+/// components set to 0, serialized with a boost binary archive, and
+/// provides the type and everything but the components, e.g. the event
+/// names of perf_result. As the components are 0, few are needed per block.
+class result_store {
+public:
+    using Results = std::vector<std::vector<benchmark_result_aggregate>>;
+    static const uint32_t version = 1;
+
+    /// Map a result store, throws std::runtime_error if it can't be read or
+    /// is from a newer version
+    explicit result_store(const std::string &fn) : data(nullptr), size(0) {
+        const int fd = open(fn.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Can't open file for reading: " + fn);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(file_header)) {
+            close(fd);
+            throw std::runtime_error("Not a result store: " + fn);
+        }
+        size = st.st_size;
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+            throw std::runtime_error("Can't map file: " + fn);
+        data = static_cast<const char*>(mapping);
+
+        const file_header &header = *reinterpret_cast<const file_header*>(data);
+        if (std::memcmp(header.magic, magic(), sizeof(header.magic)) != 0) {
+            munmap(const_cast<char*>(data), size);
+            throw std::runtime_error("Not a result store: " + fn);
+        }
+        if (header.version > version) {
+            munmap(const_cast<char*>(data), size);
+            throw std::runtime_error(fn + " has schema version " + std::to_string(header.version) +
+                                     ", this build only reads up to " + std::to_string(version));
+        }
+
+        size_t pos = sizeof(file_header);
+        while (pos < size) {
+            const block_header &block = *reinterpret_cast<const block_header*>(data + pos);
+            if (size - pos < sizeof(block_header) || block.size < sizeof(block_header) ||
+                block.size > size - pos) {
+                // Probably a run that was interrupted while writing
+                std::cerr << "Ignoring incomplete block at the end of " << fn << std::endl;
+                break;
+            }
+            blocks.push_back(pos);
+            pos += block.size;
+        }
+    }
+
+    result_store(const result_store &other) = delete;
+    result_store& operator=(const result_store &other) = delete;
+
+    ~result_store() {
+        munmap(const_cast<char*>(data), size);
+    }
+
+    size_t num_blocks() const {
+        return blocks.size();
+    }
+
+    /// Load the results of all blocks, those of the i-th contender of each
+    /// block go to results[i], oldest first. Blocks with different
+    /// contenders than the first one are skipped.
+    void load(Results &results) const {
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            Results block_results = load_block(blocks[b]);
+            if (results.empty()) {
+                results = std::move(block_results);
+                continue;
+            }
+            bool match = results.size() == block_results.size();
+            for (size_t i = 0; match && i < results.size(); ++i) {
+                match = results[i].empty() || block_results[i].empty() ||
+                    results[i][0].instance_desc() == block_results[i][0].instance_desc();
+            }
+            if (!match) {
+                std::cerr << "Contender mismatch in block " << b << ", skipping it" << std::endl;
+                for (auto &ds_results : block_results)
+                    for (auto &res : ds_results)
+                        res.destroy();
+                continue;
+            }
+            for (size_t i = 0; i < results.size(); ++i)
+                results[i].insert(results[i].end(), block_results[i].begin(), block_results[i].end());
+        }
+    }
+
+    /// Whether the file is a result store (and not, e.g., a text archive)
+    static bool is_store(const std::string &fn) {
+        std::ifstream in(fn, std::ios::binary);
+        char buffer[sizeof(file_header::magic)];
+        return in.read(buffer, sizeof(buffer)) && std::memcmp(buffer, magic(), sizeof(buffer)) == 0;
+    }
+
+    /// Add the results as a new block to the end of the store, which is
+    /// created if it doesn't exist
+    static void append(const std::string &fn, Results &results) {
+        struct stat st;
+        const bool exists = stat(fn.c_str(), &st) == 0 && st.st_size > 0;
+        if (exists && !is_store(fn)) {
+            std::cerr << "Not a result store, not appending to it: " << fn << std::endl;
+            return;
+        }
+        write_file(fn, results, exists ? std::ios::app : std::ios::trunc);
+    }
+
+    /// Replace the file by a store containing only the results
+    static void write(const std::string &fn, Results &results) {
+        write_file(fn, results, std::ios::trunc);
+    }
+
+protected:
+    static const char* magic() {
+        return "ALGENRES";
+    }
+
+    struct file_header {
+        char magic[8];
+        uint32_t version, unused;
+    };
+
+    struct block_header {
+        uint64_t size; // in bytes, including this header
+        uint32_t num_contenders, num_records;
+        uint32_t num_strings, num_prototypes;
+        uint64_t num_values; // doubles in the columns
+    };
+
+    struct record {
+        uint32_t benchmark, instance, configuration, instrumentation; // strings
+        uint32_t prototype, num_components;
+        uint32_t num_results, num_outliers;
+        uint32_t num_samples, has_median;
+        uint64_t statistics, samples; // positions in the columns
+    };
+
+    static_assert(sizeof(file_header) == 16, "unexpected padding");
+    static_assert(sizeof(block_header) == 32, "unexpected padding");
+    static_assert(sizeof(record) == 56, "unexpected padding");
+
+    // Reads from memory without copying it, for the boost archives
+    struct memory_buffer : public std::streambuf {
+        memory_buffer(const char *begin, const char *end) {
+            char *b = const_cast<char*>(begin);
+            setg(b, b, const_cast<char*>(end));
+        }
+    };
+
+    static size_t padded(size_t bytes) {
+        return (bytes + 7) & ~size_t{7};
+    }
+
+    template <typename T>
+    static void put(std::string &buffer, const T &value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static void pad(std::string &buffer) {
+        buffer.resize(padded(buffer.size()), '\0');
+    }
+
+    // Index of a string in a table, adding it if it's new
+    static uint32_t intern(const std::string &str, std::vector<std::string> &table,
+                           std::map<std::string, uint32_t> &index)
+    {
+        auto it = index.find(str);
+        if (it != index.end()) return it->second;
+        index.emplace(str, static_cast<uint32_t>(table.size()));
+        table.push_back(str);
+        return static_cast<uint32_t>(table.size() - 1);
+    }
+
+    // The serialized prototype of a result, see the class comment
+    static std::string prototype(benchmark_result *result) {
+        const std::vector<double> components = result->components();
+        result->set_components(std::vector<double>(components.size(), 0));
+        std::ostringstream s;
+        {
+            boost::archive::binary_oarchive oa(s, boost::archive::no_header);
+            oa << result;
+        }
+        result->set_components(components);
+        return s.str();
+    }
+
+    static std::string encode_block(Results &results) {
+        std::vector<std::string> strings, prototypes;
+        std::map<std::string, uint32_t> string_index, prototype_index;
+        std::vector<uint32_t> contender_sizes;
+        std::vector<record> records;
+        std::vector<double> values;
+
+        auto add_values = [&values](const benchmark_result *result) {
+            const auto components = result->components();
+            values.insert(values.end(), components.begin(), components.end());
+        };
+
+        for (auto &ds_results : results) {
+            contender_sizes.push_back(static_cast<uint32_t>(ds_results.size()));
+            for (auto &res : ds_results) {
+                record r;
+                r.benchmark = intern(res.benchmark, strings, string_index);
+                r.instance = intern(res.instance, strings, string_index);
+                r.configuration = intern(res.configuration, strings, string_index);
+                r.instrumentation = intern(res.instrumentation, strings, string_index);
+                r.prototype = intern(prototype(res.avg), prototypes, prototype_index);
+                r.num_components = static_cast<uint32_t>(res.avg->components().size());
+                r.num_results = res.num_results;
+                r.num_outliers = res.num_outliers;
+                r.num_samples = static_cast<uint32_t>(res.samples.size());
+                r.has_median = res.median != nullptr;
+
+                r.statistics = values.size();
+                for (const benchmark_result *result : {res.min, res.max, res.avg})
+                    add_values(result);
+                if (r.has_median)
+                    for (const benchmark_result *result : {res.median, res.stddev, res.mad})
+                        add_values(result);
+                r.samples = values.size();
+                for (size_t c = 0; c < r.num_components; ++c)
+                    for (const auto &sample : res.samples)
+                        values.push_back(sample[c]);
+                records.push_back(r);
+            }
+        }
+
+        std::string block;
+        block_header header{0, static_cast<uint32_t>(contender_sizes.size()),
+            static_cast<uint32_t>(records.size()), static_cast<uint32_t>(strings.size()),
+            static_cast<uint32_t>(prototypes.size()), values.size()};
+        put(block, header);
+        for (uint32_t s : contender_sizes)
+            put(block, s);
+        pad(block);
+        for (const record &r : records)
+            put(block, r);
+        uint64_t end = 0;
+        for (const auto *table : {&strings, &prototypes}) {
+            for (const std::string &str : *table) {
+                end += str.size();
+                put(block, end);
+            }
+        }
+        block.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+        for (const auto *table : {&strings, &prototypes})
+            for (const std::string &str : *table)
+                block += str;
+        pad(block);
+
+        reinterpret_cast<block_header*>(&block[0])->size = block.size();
+        return block;
+    }
+
+    Results load_block(size_t pos) const {
+        const char *block = data + pos;
+        const block_header &header = *reinterpret_cast<const block_header*>(block);
+        const uint32_t *contender_sizes = reinterpret_cast<const uint32_t*>(block + sizeof(block_header));
+        const record *records = reinterpret_cast<const record*>(
+            block + sizeof(block_header) + padded(header.num_contenders * sizeof(uint32_t)));
+        const uint64_t *ends = reinterpret_cast<const uint64_t*>(records + header.num_records);
+        const double *values = reinterpret_cast<const double*>(ends + header.num_strings + header.num_prototypes);
+        const char *chars = reinterpret_cast<const char*>(values + header.num_values);
+
+        auto string = [&](size_t i) {
+            const uint64_t begin = i == 0 ? 0 : ends[i - 1];
+            return std::string(chars + begin, chars + ends[i]);
+        };
+        auto object = [&](size_t prototype, const double *components, size_t num_components) {
+            const size_t i = header.num_strings + prototype;
+            memory_buffer buffer(chars + ends[i - 1], chars + ends[i]);
+            boost::archive::binary_iarchive ia(buffer, boost::archive::no_header);
+            benchmark_result *result;
+            ia >> result;
+            result->set_components(std::vector<double>(components, components + num_components));
+            return result;
+        };
+
+        Results results(header.num_contenders);
+        const record *r = records;
+        for (size_t i = 0; i < header.num_contenders; ++i) {
+            results[i].reserve(contender_sizes[i]);
+            for (size_t j = 0; j < contender_sizes[i]; ++j, ++r) {
+                const size_t n = r->num_components;
+                const double *statistics = values + r->statistics;
+                benchmark_result_aggregate res(object(r->prototype, statistics, n),
+                    object(r->prototype, statistics + n, n), object(r->prototype, statistics + 2 * n, n));
+                if (r->has_median) {
+                    res.median = object(r->prototype, statistics + 3 * n, n);
+                    res.stddev = object(r->prototype, statistics + 4 * n, n);
+                    res.mad = object(r->prototype, statistics + 5 * n, n);
+                }
+                res.benchmark = string(r->benchmark);
+                res.instance = string(r->instance);
+                res.configuration = string(r->configuration);
+                res.instrumentation = string(r->instrumentation);
+                res.num_results = r->num_results;
+                res.num_outliers = r->num_outliers;
+                res.samples.assign(r->num_samples, std::vector<double>(n));
+                for (size_t c = 0; c < n; ++c)
+                    for (size_t s = 0; s < r->num_samples; ++s)
+                        res.samples[s][c] = values[r->samples + c * r->num_samples + s];
+                results[i].emplace_back(std::move(res));
+            }
+        }
+        return results;
+    }
+
+    static void write_file(const std::string &fn, Results &results, std::ios::openmode mode) {
+        const std::string block = encode_block(results);
+        std::ofstream out(fn, std::ios::binary | std::ios::out | mode);
+        if (!out.good()) {
+            std::cerr << "Can't open file for writing: " << fn << std::endl;
+            return;
+        }
+        if (mode == std::ios::trunc) {
+            file_header header{{}, version, 0};
+            std::memcpy(header.magic, magic(), sizeof(header.magic));
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+        // All at once, so that a block is either complete or the last one
+        out.write(block.data(), block.size());
+    }
+
+    const char *data;
+    size_t size;
+    std::vector<size_t> blocks; // their positions
+};
+
+/// Read results from a result store or a boost text archive (as written
+/// before there were result stores). Returns false if that didn't work.
+__attribute__((unused))
+static bool read_results(const std::string &fn, result_store::Results &results) {
+    if (!result_store::is_store(fn)) {
+        std::ifstream ifs(fn);
+        if (!ifs.good() || !ifs.is_open()) {
+            std::cerr << "Can't open file for reading: " << fn << std::endl;
+            return false;
+        }
+        boost::archive::text_iarchive ia(ifs);
+        ia >> results;
+        return true;
+    }
+    try {
+        result_store store(fn);
+        store.load(results);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
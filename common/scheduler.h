@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace common {
+
+/// How an experiment_runner distributes its runs. With more than one worker,
+/// every combination of contender, instrumentation and benchmark is run in
+/// one of that many forked processes, each pinned to a physical core of its
+/// own. Benchmarks whose keys are listed in alone are limited by memory
+/// bandwidth or the shared cache, and run while all other workers are idle.
+struct schedule {
+    size_t workers = 1;
+    std::vector<std::string> alone;
+
+    bool runs_alone(const std::string &benchmark_key) const {
+        return std::find(alone.begin(), alone.end(), benchmark_key) != alone.end();
+    }
+
+    /// Parse a comma-separated list of benchmark keys for alone
+    static std::vector<std::string> parse_keys(const std::string &list) {
+        std::vector<std::string> keys;
+        std::istringstream s(list);
+        std::string item;
+        while (std::getline(s, item, ',')) {
+            if (!item.empty()) keys.push_back(item);
+        }
+        return keys;
+    }
+};
+
+namespace util {
+    /// A logical CPU and the NUMA node it belongs to
+    struct core {
+        int cpu, node;
+    };
+
+    // Read a single integer from a sysfs file, or return -1
+    static int read_sysfs_int(const std::string &path) {
+        std::ifstream in(path);
+        int value = -1;
+        if (!(in >> value)) return -1;
+        return value;
+    }
+
+    // The NUMA node of a CPU, from the nodeN link in its sysfs directory
+    static int numa_node(int cpu) {
+        const std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        DIR *dir = opendir(path.c_str());
+        if (dir == nullptr) return 0;
+        int node = 0;
+        while (dirent *entry = readdir(dir)) {
+            int n;
+            if (sscanf(entry->d_name, "node%d", &n) == 1) {
+                node = n;
+                break;
+            }
+        }
+        closedir(dir);
+        return node;
+    }
+
+    /// One logical CPU of every physical core that this process may run on,
+    /// taking turns between the NUMA nodes, so that the first few workers
+    /// are spread over all memory controllers. If the topology can't be
+    /// read, every CPU counts as a core of its own.
+    __attribute__((unused))
+    static std::vector<core> physical_cores() {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+            return {core{0, 0}};
+
+        // (package, core id) identifies a physical core
+        std::map<std::pair<int, int>, core> cores;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (!CPU_ISSET(cpu, &allowed)) continue;
+            const std::string topology = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+            const int package = read_sysfs_int(topology + "physical_package_id"),
+                      core_id = read_sysfs_int(topology + "core_id");
+            const auto id = (core_id < 0) ? std::make_pair(-1, cpu) : std::make_pair(package, core_id);
+            if (cores.find(id) == cores.end())
+                cores.emplace(id, core{cpu, numa_node(cpu)});
+        }
+
+        std::map<int, std::vector<core>> by_node;
+        for (const auto &c : cores)
+            by_node[c.second.node].push_back(c.second);
+        std::vector<core> result;
+        for (size_t i = 0; result.size() < cores.size(); ++i) {
+            for (const auto &node : by_node) {
+                if (i < node.second.size())
+                    result.push_back(node.second[i]);
+            }
+        }
+        return result;
+    }
+}
+
+/// Forked worker processes that run numbered units of work and send back
+/// their results as strings, through a pipe in each direction. Each worker
+/// is pinned to a physical core, and thus to that core's NUMA node: Linux
+/// allocates memory on the node of the core that first touches it, so
+/// everything a benchmark allocates is local.
+///
+/// The workers are copies of the process at the time of construction, so
+/// everything that work() needs must be set up before.
+class worker_pool {
+public:
+    using Work = std::function<std::string(size_t)>;
+
+    worker_pool(size_t num_workers, Work work) {
+        const auto cores = util::physical_cores();
+        if (num_workers > cores.size()) {
+            std::cerr << "Only " << cores.size() << " physical cores available, using "
+                      << cores.size() << " workers instead of " << num_workers << std::endl;
+            num_workers = cores.size();
+        }
+        // Report dead workers through write errors instead of dying of SIGPIPE
+        signal(SIGPIPE, SIG_IGN);
+        // Anything still buffered would be written by every worker, too
+        std::cout.flush();
+        std::cerr.flush();
+        fflush(nullptr);
+
+        for (size_t i = 0; i < num_workers; ++i) {
+            int tasks[2], results[2];
+            if (pipe(tasks) != 0 || pipe(results) != 0)
+                throw std::runtime_error("worker_pool: can't create pipes");
+            const pid_t pid = fork();
+            if (pid < 0)
+                throw std::runtime_error("worker_pool: can't fork");
+            if (pid == 0) {
+                close(tasks[1]);
+                close(results[0]);
+                for (const auto &w : workers) {
+                    close(w.tasks);
+                    close(w.results);
+                }
+                serve(cores[i], tasks[0], results[1], work);
+            }
+            close(tasks[0]);
+            close(results[1]);
+            workers.push_back(worker{pid, tasks[1], results[0], cores[i], 0, false});
+        }
+    }
+
+    worker_pool(const worker_pool &other) = delete;
+    worker_pool& operator=(const worker_pool &other) = delete;
+
+    ~worker_pool() {
+        // Closing the task pipe tells an idle worker to exit. Busy ones are
+        // only left if run() failed, and there's no use in waiting for them.
+        for (const auto &w : workers) {
+            if (w.busy) kill(w.pid, SIGKILL);
+            close(w.tasks);
+            close(w.results);
+        }
+        for (const auto &w : workers)
+            waitpid(w.pid, nullptr, 0);
+    }
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    /// Run units 0 to units-1 and pass their results to done(), in that
+    /// order, as soon as all of the units before them are done. The units for
+    /// which alone() holds are run while no other unit is running.
+    void run(size_t units, std::function<bool(size_t)> alone,
+             std::function<void(size_t, const std::string&)> done)
+    {
+        std::map<size_t, std::string> finished;
+        size_t next = 0, next_done = 0, busy = 0;
+        bool exclusive = false;
+
+        while (next_done < units) {
+            // Hand out units in order, until one has to wait
+            for (auto &w : workers) {
+                if (next == units || exclusive) break;
+                if (w.busy) continue;
+                if (alone(next)) {
+                    if (busy > 0) break;
+                    exclusive = true;
+                }
+                const uint64_t unit = next;
+                if (!write_all(w.tasks, &unit, sizeof(unit)))
+                    throw std::runtime_error("worker_pool: worker on CPU " +
+                        std::to_string(w.core.cpu) + " is gone");
+                w.unit = next++;
+                w.busy = true;
+                ++busy;
+            }
+
+            std::vector<pollfd> fds;
+            std::vector<worker*> polled;
+            for (auto &w : workers) {
+                if (!w.busy) continue;
+                fds.push_back(pollfd{w.results, POLLIN, 0});
+                polled.push_back(&w);
+            }
+            if (poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("worker_pool: poll failed");
+            }
+            for (size_t j = 0; j < fds.size(); ++j) {
+                if (fds[j].revents == 0) continue;
+                worker &w = *polled[j];
+                std::string result;
+                if (!receive(w.results, result)) {
+                    w.busy = false;
+                    throw std::runtime_error("worker_pool: worker on CPU " +
+                        std::to_string(w.core.cpu) + " died running unit " +
+                        std::to_string(w.unit));
+                }
+                finished.emplace(w.unit, std::move(result));
+                w.busy = false;
+                --busy;
+                exclusive = false;
+            }
+
+            while (!finished.empty() && finished.begin()->first == next_done) {
+                done(next_done, finished.begin()->second);
+                finished.erase(finished.begin());
+                ++next_done;
+            }
+        }
+    }
+
+protected:
+    struct worker {
+        pid_t pid;
+        int tasks, results;
+        util::core core;
+        size_t unit; // the unit it is running, if busy
+        bool busy;
+    };
+
+    // The worker's main loop, never returns
+    [[noreturn]] static void serve(util::core core, int tasks, int results, Work &work) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core.cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0)
+            std::cerr << "Can't pin worker to CPU " << core.cpu << std::endl;
+
+        int status = 0;
+        uint64_t unit;
+        try {
+            while (read_all(tasks, &unit, sizeof(unit))) {
+                const std::string result = work(unit);
+                const uint64_t length = result.size();
+                if (!write_all(results, &length, sizeof(length)) ||
+                    !write_all(results, result.data(), length))
+                    break;
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Worker on CPU " << core.cpu << " failed: " << e.what() << std::endl;
+            status = 1;
+        }
+        std::cout.flush();
+        // Don't run the destructors of the parent's objects
+        _exit(status);
+    }
+
+    static bool receive(int fd, std::string &result) {
+        uint64_t length;
+        if (!read_all(fd, &length, sizeof(length))) return false;
+        result.resize(length);
+        return read_all(fd, &result[0], length);
+    }
+
+    static bool read_all(int fd, void *buffer, size_t bytes) {
+        char *pos = static_cast<char*>(buffer);
+        while (bytes > 0) {
+            const ssize_t n = read(fd, pos, bytes);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            pos += n;
+            bytes -= n;
+        }
+        return true;
+    }
+
+    static bool write_all(int fd, const void *buffer, size_t bytes) {
+        const char *pos = static_cast<const char*>(buffer);
+        while (bytes > 0) {
+            const ssize_t n = write(fd, pos, bytes);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            pos += n;
+            bytes -= n;
+        }
+        return true;
+    }
+
+    std::vector<worker> workers;
+};
+
+}
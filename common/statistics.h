@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace common {
+
+namespace util {
+    /// Median of a non-empty sample (the mean of the middle two for an even
+    /// number of values)
+    __attribute__((unused))
+    static double median(std::vector<double> values) {
+        assert(!values.empty());
+        const size_t mid = values.size() / 2;
+        std::nth_element(values.begin(), values.begin() + mid, values.end());
+        const double upper = values[mid];
+        if (values.size() % 2 == 1) return upper;
+        return (*std::max_element(values.begin(), values.begin() + mid) + upper) / 2;
+    }
+
+    /// Median absolute deviation from the median
+    __attribute__((unused))
+    static double mad(const std::vector<double> &values) {
+        const double m = median(values);
+        std::vector<double> deviations;
+        deviations.reserve(values.size());
+        for (double v : values)
+            deviations.push_back(std::abs(v - m));
+        return median(deviations);
+    }
+
+    /// Sample standard deviation, 0 for fewer than two values
+    __attribute__((unused))
+    static double stddev(const std::vector<double> &values) {
+        if (values.size() < 2) return 0;
+        double mean = 0;
+        for (double v : values) mean += v;
+        mean /= values.size();
+        double sum = 0;
+        for (double v : values) sum += (v - mean) * (v - mean);
+        return std::sqrt(sum / (values.size() - 1));
+    }
+
+    /// Distribution-free 95% confidence interval of the median: the order
+    /// statistics around it whose ranks the number of values below the
+    /// median (binomial with p = 1/2) falls between with 95% probability.
+    /// With few values, that's the whole range and covers less than 95%.
+    __attribute__((unused))
+    static std::pair<double, double> median_confidence_interval(std::vector<double> values) {
+        assert(!values.empty());
+        std::sort(values.begin(), values.end());
+        const double n = values.size(), spread = 1.96 * std::sqrt(n) / 2;
+        const double lower = std::floor(n / 2 - spread), upper = std::ceil(n / 2 + spread);
+        return std::make_pair(values[static_cast<size_t>(std::max(0.0, lower))],
+                              values[static_cast<size_t>(std::min(n - 1, upper))]);
+    }
+
+    /// Indices of the values that are outliers by their modified z-score
+    /// 0.6745 (x - median) / MAD (Iglewicz and Hoaglin), which is robust to
+    /// the outliers themselves. Nothing is an outlier if the MAD is 0.
+    __attribute__((unused))
+    static std::vector<bool> mad_outliers(const std::vector<double> &values, double threshold = 3.5) {
+        std::vector<bool> outliers(values.size(), false);
+        if (values.size() < 3) return outliers;
+        const double m = median(values), d = mad(values);
+        if (d == 0) return outliers;
+        for (size_t i = 0; i < values.size(); ++i)
+            outliers[i] = 0.6745 * std::abs(values[i] - m) / d > threshold;
+        return outliers;
+    }
+
+    /// Two-sided p-value of the Mann-Whitney U test of whether the values in
+    /// a and b come from the same distribution, against the alternative that
+    /// one of them tends to be larger. It only looks at ranks, so a single
+    /// spike can't make a difference significant. Small samples without ties
+    /// get the exact distribution of U, others the normal approximation with
+    /// tie and continuity correction.
+    __attribute__((unused))
+    static double mann_whitney_u(const std::vector<double> &a, const std::vector<double> &b) {
+        const size_t n1 = a.size(), n2 = b.size(), n = n1 + n2;
+        if (n1 == 0 || n2 == 0) return 1;
+
+        // Rank all values, ties get the average of their ranks
+        std::vector<std::pair<double, bool>> all; // value, from a?
+        for (double v : a) all.emplace_back(v, true);
+        for (double v : b) all.emplace_back(v, false);
+        std::sort(all.begin(), all.end());
+        double rank_sum = 0, ties = 0; // ties: sum of t^3 - t over groups of t ties
+        for (size_t i = 0; i < n;) {
+            size_t j = i;
+            while (j < n && all[j].first == all[i].first) ++j;
+            const double t = j - i, rank = (i + 1 + j) / 2.0;
+            for (size_t k = i; k < j; ++k)
+                if (all[k].second) rank_sum += rank;
+            ties += t * t * t - t;
+            i = j;
+        }
+        const double u1 = rank_sum - n1 * (n1 + 1) / 2.0, mean = n1 * n2 / 2.0;
+        const double u = std::min(u1, n1 * n2 - u1);
+
+        if (ties == 0 && n1 <= 20 && n2 <= 20) {
+            // count[i][j][k]: orderings of i values of a and j of b with
+            // U = k, built up by adding the largest value
+            const size_t max_u = n1 * n2;
+            std::vector<std::vector<std::vector<double>>> count(n1 + 1,
+                std::vector<std::vector<double>>(n2 + 1, std::vector<double>(max_u + 1, 0)));
+            for (size_t i = 0; i <= n1; ++i) {
+                for (size_t j = 0; j <= n2; ++j) {
+                    if (i == 0 || j == 0) {
+                        count[i][j][0] = 1;
+                        continue;
+                    }
+                    for (size_t k = 0; k <= i * j; ++k) {
+                        // the largest value is from a and larger than all j of b, or from b
+                        count[i][j][k] = (k >= j ? count[i - 1][j][k - j] : 0) + count[i][j - 1][k];
+                    }
+                }
+            }
+            double below = 0, total = 0;
+            for (size_t k = 0; k <= max_u; ++k) {
+                total += count[n1][n2][k];
+                if (k <= u) below += count[n1][n2][k];
+            }
+            return std::min(1.0, 2 * below / total);
+        }
+
+        const double variance = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1.0)));
+        if (variance <= 0) return 1;
+        const double z = std::max(0.0, std::abs(u1 - mean) - 0.5) / std::sqrt(variance);
+        return std::erfc(z / std::sqrt(2.0));
+    }
+
+    /// The smallest p-value that mann_whitney_u can give for samples of these
+    /// sizes, that of two samples that don't overlap at all
+    __attribute__((unused))
+    static double mann_whitney_u_min(size_t n1, size_t n2) {
+        std::vector<double> a(n1), b(n2);
+        for (size_t i = 0; i < n1; ++i) a[i] = i;
+        for (size_t i = 0; i < n2; ++i) b[i] = n1 + i;
+        return mann_whitney_u(a, b);
+    }
+}
+
+/// How often a benchmark runs on each configuration: a fixed number of times,
+/// or adaptively until the 95% confidence interval of the median of the
+/// first result component (e.g. the time) is narrow enough relative to the
+/// median, or a time budget is used up.
+struct repetition_policy {
+    size_t min_runs, max_runs;
+    double max_ci_width; // relative to the median, 0 to ignore the CI
+    double time_budget;  // milliseconds per configuration, 0 for none
+
+    /// A fixed number of runs
+    repetition_policy(size_t runs = 1)
+        : min_runs(runs), max_runs(runs), max_ci_width(0), time_budget(0) {}
+
+    static repetition_policy adaptive(double max_ci_width, double time_budget,
+                                      size_t min_runs = 5, size_t max_runs = 100)
+    {
+        repetition_policy policy(min_runs);
+        policy.max_runs = std::max(min_runs, max_runs);
+        policy.max_ci_width = max_ci_width;
+        policy.time_budget = time_budget;
+        return policy;
+    }
+
+    bool is_adaptive() const {
+        return max_ci_width > 0 || time_budget > 0;
+    }
+
+    /// Whether enough runs were made, given the first components of their
+    /// results and the time spent on them (in milliseconds)
+    bool done(const std::vector<double> &values, double elapsed) const {
+        if (values.size() < min_runs) return false;
+        if (values.size() >= max_runs) return true;
+        if (time_budget > 0 && elapsed >= time_budget) return true;
+        if (max_ci_width > 0) {
+            const double m = util::median(values);
+            const auto ci = util::median_confidence_interval(values);
+            return ci.second - ci.first <= max_ci_width * std::abs(m);
+        }
+        return !is_adaptive();
+    }
+};
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// std::string_view is C++17, the framework is built as C++14. The
+// experimental one has the same interface and a std::hash specialization.
+#if __cplusplus >= 201703L
+#include <string_view>
+#else
+#include <experimental/string_view>
+#endif
+
+namespace common {
+
+#if __cplusplus >= 201703L
+using string_view = std::string_view;
+#else
+using string_view = std::experimental::string_view;
+#endif
+
+}
@@ -35,7 +35,7 @@ static constexpr auto erase_line = "\33[K";
 
 static constexpr auto clear_screen = "\33[2J";
 
-const std::string set_colour(colour c) {
+inline std::string set_colour(colour c) {
     std::stringstream s;
     s << "\33[" << (int)c << "m";
     return s.str();
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "string_view.h"
+
+namespace common {
+
+/// A file mapped into memory read-only
+class mapped_file {
+public:
+    /// Map a file, throws std::invalid_argument if it can't be opened and
+    /// std::runtime_error if it can't be mapped
+    explicit mapped_file(const std::string &fn) : data_(nullptr), size_(0) {
+        const int fd = open(fn.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::invalid_argument("Cannot open file '" + fn + "'.");
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Can't stat file: " + fn);
+        }
+        size_ = st.st_size;
+        if (size_ == 0) { // can't map an empty file
+            close(fd);
+            return;
+        }
+        // Populate the mapping right away, so that later reads (e.g. of
+        // string_view keys during a measurement) don't fault pages in
+        void *mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+            throw std::runtime_error("Can't map file: " + fn);
+        data_ = static_cast<const char*>(mapping);
+    }
+
+    mapped_file(const mapped_file &other) = delete;
+    mapped_file& operator=(const mapped_file &other) = delete;
+
+    ~mapped_file() {
+        if (data_ != nullptr)
+            munmap(const_cast<char*>(data_), size_);
+    }
+
+    const char* begin() const { return data_; }
+    const char* end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+
+private:
+    const char *data_;
+    size_t size_;
+};
+
+namespace util {
+
+/// Whether c is whitespace in the "C" locale, like std::isspace, but
+/// without the locale lookup
+inline bool is_space(char c) {
+    return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+}
+
+/// Bit i is set iff byte i of the 64 bytes at pos is whitespace. Uses SSE2
+/// to check 16 bytes at a time.
+inline uint64_t space_mask(const char *pos) {
+    uint64_t mask = 0;
+#ifdef __SSE2__
+    for (int i = 0; i < 4; ++i) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos + 16 * i));
+        const __m128i space = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+        // '\t' to '\r' are those whose distance to '\t' is at most 4, unsigned
+        const __m128i dist = _mm_sub_epi8(bytes, _mm_set1_epi8('\t'));
+        const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(dist, _mm_set1_epi8('\r' - '\t')), dist);
+        mask |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_or_si128(space, control))) << (16 * i);
+    }
+#else
+    for (int i = 0; i < 64; ++i)
+        mask |= static_cast<uint64_t>(is_space(pos[i])) << i;
+#endif
+    return mask;
+}
+
+/// Call f with a string_view of every whitespace-separated token in
+/// [begin, end), in order. Tokens are the same as those read with
+/// `std::istream >> std::string` in the "C" locale.
+///
+/// Works on 64-byte blocks: a bit mask of the whitespace in the block,
+/// XORed with itself shifted by one, has a bit set exactly where a token
+/// starts or ends. These alternate, so no byte is looked at twice.
+template <typename F>
+void for_each_token(const char *begin, const char *end, F &&f) {
+    uint64_t previous = 1; // as if there was whitespace before begin
+    const char *token = nullptr;
+    auto scan = [&](const char *block, uint64_t spaces) {
+        uint64_t changes = spaces ^ ((spaces << 1) | previous);
+        previous = spaces >> 63;
+        while (changes != 0) {
+            const char *pos = block + __builtin_ctzll(changes);
+            if (token == nullptr) {
+                token = pos;
+            } else {
+                f(string_view(token, pos - token));
+                token = nullptr;
+            }
+            changes &= changes - 1;
+        }
+    };
+    const char *block = begin;
+    for (; end - block >= 64; block += 64)
+        scan(block, space_mask(block));
+    // Pad the rest with whitespace, which also ends the last token
+    char rest[64];
+    std::memset(rest, ' ', sizeof(rest));
+    if (end != block)
+        std::memcpy(rest, block, end - block);
+    scan(block, space_mask(rest));
+}
+
+}
+
+}
@@ -10,40 +10,66 @@
 #include "common/arg_parser.h"
 #include "common/benchmark.h"
 #include "common/comparison.h"
+#include "common/displacement.h"
 #include "common/instrumentation.h"
+#include "common/latency.h"
+#include "common/perf_instrumentation.h"
+#include "common/rank_error.h"
+#include "common/regression.h"
+#include "common/result_store.h"
 
 void usage(char* name) {
     using std::cout;
     using std::endl;
-    cout << "Usage: " << name << " <options>" << endl << endl
+    cout << "Usage: " << name << " <options> [<baseline> <candidate>]" << endl << endl
+         << "Compares the contenders of one serialization file, or the results in the" << endl
+         << "candidate file to those in the baseline file. The latter exits with status 2" << endl
+         << "if the candidate has regressions, and with status 3 if it has none but not" << endl
+         << "everything could be tested: results with too few runs, or results that occur" << endl
+         << "more than once in a file (e.g. appended with -a)." << endl << endl
          << "Options:" << endl
          << "-i <filename> input serialization filename (default: data.txt)" << endl
-         << "-c <double>   cutoff, at which difference ratio to stop printing (deafult: 1.01)" << endl
+         << "-c <double>   cutoff, at which difference ratio to stop printing" << endl
+         << "              (default: 1.01, or 1.05 with baseline and candidate)" << endl
+         << "-p <double>   significance level of the Mann-Whitney U test (default: 0.05)" << endl
          << "-m <int>      maximum number of differences to print (default: 10)" << endl
          << "-b <int>      which contender to compare to the others (default: 0)" << endl;
     exit(0);
 }
 
+void load(const std::string &filename, std::vector<std::vector<common::benchmark_result_aggregate>> &results) {
+    if (!common::read_results(filename, results))
+        exit(1);
+}
+
 int main(int argc, char** argv) {
     common::arg_parser args(argc, argv);
     if (args.is_set("h") || args.is_set("-help")) usage(argv[0]);
     const int max_results = args.get<int>("m", 10),
               base_contender = args.get<int>("b", 0);
-    const double cutoff = args.get<double>("c", 1.01);
+    const double alpha = args.get<double>("p", 0.05);
     const std::string &filename = args.get<std::string>("i", "data.txt");
 
-    std::vector<std::vector<common::benchmark_result_aggregate>> results;
+    if (args.num_data_args() == 2) {
+        const double cutoff = args.get<double>("c", 1.05);
+        std::vector<std::vector<common::benchmark_result_aggregate>> baseline, candidate;
+        load(args.data_arg(0), baseline);
+        load(args.data_arg(1), candidate);
 
-    // Serialize results
-    std::ifstream ifs(filename);
-    if (!ifs.good() || !ifs.is_open()) {
-        std::cerr << "Can't open file: " << filename << std::endl;
-        exit(1);
+        common::regression_check check(baseline, candidate, cutoff, alpha);
+        check.compare();
+        check.print(std::cout, max_results);
+        if (check.regressions() > 0) return 2;
+        return check.conclusive() ? 0 : 3;
+    } else if (args.num_data_args() != 0) {
+        usage(argv[0]);
     }
-    boost::archive::text_iarchive ia(ifs);
-    ia >> results;
 
-    common::comparison comparison(results, base_contender);
+    const double cutoff = args.get<double>("c", 1.01);
+    std::vector<std::vector<common::benchmark_result_aggregate>> results;
+    load(filename, results);
+
+    common::comparison comparison(results, base_contender, alpha);
     comparison.compare();
     comparison.print(std::cout, cutoff, max_results);
 }
@@ -0,0 +1,481 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "../common/contenders.h"
+#include "concurrent_hashtable.h"
+#include "swiss_table.h" // for swiss::mix
+
+namespace hashtable {
+
+/// Bucketized cuckoo hashing with lock striping, in the style of libcuckoo.
+/// Every key has two candidate buckets of SlotsPerBucket slots each. Buckets
+/// are protected by a fixed number of striped spinlocks, and operations lock
+/// the stripes of a key's two buckets (in order, to avoid deadlocks).
+/// If both buckets are full, an insertion first searches a cuckoo path to a
+/// free slot, locking only one stripe at a time, and then moves the elements
+/// along the path backwards, two buckets at a time, validating each step.
+/// If no path is found the table doubles in size, which takes all locks.
+template <typename Key,
+          typename T,
+          size_t SlotsPerBucket = 4,
+          typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class concurrent_cuckoo
+    : public for_each_forwarding<concurrent_cuckoo<Key, T, SlotsPerBucket, Hash, KeyEqual>,
+                                 concurrent_hashtable<Key, T>> {
+    static_assert(SlotsPerBucket >= 1 && SlotsPerBucket <= 32,
+                  "Bucket occupancy is stored in 32 bits");
+public:
+    using value_type = typename hashtable<Key, T>::value_type;
+
+    concurrent_cuckoo(const size_t bucket_count = 0)
+        : table(buckets_for(bucket_count)), locks(nullptr)
+        , num_buckets(table.num_buckets), hasher(), equal()
+    {
+        void *mem = nullptr;
+        if (posix_memalign(&mem, sizeof(spinlock), num_locks * sizeof(spinlock)) != 0)
+            throw std::bad_alloc();
+        locks = static_cast<spinlock*>(mem);
+        for (size_t i = 0; i < num_locks; ++i)
+            new (locks + i) spinlock();
+    }
+
+    concurrent_cuckoo(const concurrent_cuckoo &other) = delete;
+    concurrent_cuckoo& operator=(const concurrent_cuckoo &other) = delete;
+
+    virtual ~concurrent_cuckoo() {
+        std::free(locks);
+    }
+
+    // Register all contenders in the list
+    static void register_contenders(common::contender_list<concurrent_hashtable<Key, T>> &list) {
+        using Factory = common::contender_factory<concurrent_hashtable<Key, T>>;
+        list.register_contender(Factory("concurrent cuckoo (4-way buckets)", "concurrent-cuckoo-4",
+            [](){ return new concurrent_cuckoo<Key, T, 4>(); }
+        ));
+        list.register_contender(Factory("concurrent cuckoo (8-way buckets)", "concurrent-cuckoo-8",
+            [](){ return new concurrent_cuckoo<Key, T, 8>(); }
+        ));
+    }
+
+    bool insert(const Key &key, const T &value) override {
+        const size_t hash = hash_key(key);
+        while (true) {
+            size_t b1, b2;
+            lock_two(hash, b1, b2);
+            if (value_type *elem = locate(b1, b2, key)) {
+                elem->second = value;
+                unlock_two(b1, b2);
+                return false;
+            }
+            if (table.try_place(b1, key, value) || table.try_place(b2, key, value)) {
+                lock_of(b1).elements.fetch_add(1, std::memory_order_relaxed);
+                unlock_two(b1, b2);
+                return true;
+            }
+            unlock_two(b1, b2);
+            // Both buckets were full: make room and try again
+            make_room(hash);
+        }
+    }
+
+    T& operator[](const Key &key) override {
+        return (*this)[Key(key)];
+    }
+
+    T& operator[](Key &&key) override {
+        const size_t hash = hash_key(key);
+        while (true) {
+            size_t b1, b2;
+            lock_two(hash, b1, b2);
+            value_type *elem = locate(b1, b2, key);
+            if (elem == nullptr) {
+                elem = table.try_place(b1, key, T());
+                if (elem == nullptr)
+                    elem = table.try_place(b2, key, T());
+                if (elem != nullptr)
+                    lock_of(b1).elements.fetch_add(1, std::memory_order_relaxed);
+            }
+            unlock_two(b1, b2);
+            if (elem != nullptr)
+                return elem->second;
+            make_room(hash);
+        }
+    }
+
+    maybe<T> find(const Key &key) const override {
+        const size_t hash = hash_key(key);
+        size_t b1, b2;
+        lock_two(hash, b1, b2);
+        const value_type *elem = locate(b1, b2, key);
+        maybe<T> result = (elem == nullptr) ? nothing<T>() : just<T>(elem->second);
+        unlock_two(b1, b2);
+        return result;
+    }
+
+    size_t erase(const Key &key) override {
+        const size_t hash = hash_key(key);
+        size_t b1, b2;
+        lock_two(hash, b1, b2);
+        size_t erased = 0;
+        if (table.erase(b1, key) || table.erase(b2, key)) {
+            lock_of(b1).elements.fetch_sub(1, std::memory_order_relaxed);
+            erased = 1;
+        }
+        unlock_two(b1, b2);
+        return erased;
+    }
+
+    size_t size() const override {
+        // The per-stripe counters are only meaningful in sum
+        int64_t sum = 0;
+        for (size_t i = 0; i < num_locks; ++i)
+            sum += locks[i].elements.load(std::memory_order_relaxed);
+        return static_cast<size_t>(sum);
+    }
+
+    // Takes all locks, so f must not call the table
+    template <typename F>
+    void for_each(F &&f) {
+        lock_all();
+        for (size_t b = 0; b < table.num_buckets; ++b) {
+            bucket &bu = table.buckets[b];
+            for (uint32_t occ = bu.occupied; occ != 0; occ &= occ - 1) {
+                value_type *elem = bu.slot(__builtin_ctz(occ));
+                f(elem->first, elem->second);
+            }
+        }
+        unlock_all();
+    }
+
+    void clear() override {
+        lock_all();
+        table.clear();
+        for (size_t i = 0; i < num_locks; ++i)
+            locks[i].elements.store(0, std::memory_order_relaxed);
+        unlock_all();
+    }
+
+protected:
+    struct bucket {
+        uint32_t occupied; // bit i is set iff slot i is in use
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type
+            slots[SlotsPerBucket];
+
+        value_type* slot(size_t i) {
+            return reinterpret_cast<value_type*>(&slots[i]);
+        }
+        bool full() const {
+            return occupied == (SlotsPerBucket == 32 ? ~0u : (1u << SlotsPerBucket) - 1);
+        }
+    };
+
+    // The buckets. Methods that take bucket indices require the caller to
+    // hold the respective locks, the others require all locks.
+    struct bucket_table {
+        bucket *buckets;
+        size_t num_buckets, mask;
+        size_t random_state;
+
+        explicit bucket_table(size_t n)
+            : buckets(new bucket[n]), num_buckets(n), mask(n - 1)
+            , random_state(0x9E3779B97F4A7C15ULL)
+        {
+            for (size_t b = 0; b < n; ++b)
+                buckets[b].occupied = 0;
+        }
+
+        ~bucket_table() {
+            clear();
+            delete[] buckets;
+        }
+
+        size_t index1(size_t hash) const { return hash & mask; }
+        size_t index2(size_t hash) const { return (hash >> 32) & mask; }
+
+        value_type* locate(size_t b, const Key &key, const KeyEqual &equal) {
+            bucket &bu = buckets[b];
+            for (uint32_t occ = bu.occupied; occ != 0; occ &= occ - 1) {
+                value_type *elem = bu.slot(__builtin_ctz(occ));
+                if (equal(elem->first, key))
+                    return elem;
+            }
+            return nullptr;
+        }
+
+        template <typename K, typename V>
+        value_type* try_place(size_t b, K &&key, V &&value) {
+            bucket &bu = buckets[b];
+            if (bu.full()) return nullptr;
+            const size_t slot = __builtin_ctz(~bu.occupied);
+            bu.occupied |= 1u << slot;
+            return new (bu.slot(slot)) value_type(std::forward<K>(key), std::forward<V>(value));
+        }
+
+        bool erase(size_t b, const Key &key) {
+            bucket &bu = buckets[b];
+            for (uint32_t occ = bu.occupied; occ != 0; occ &= occ - 1) {
+                const size_t slot = __builtin_ctz(occ);
+                if (KeyEqual()(bu.slot(slot)->first, key)) {
+                    bu.slot(slot)->~value_type();
+                    bu.occupied &= ~(1u << slot);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        size_t random() {
+            // xorshift64
+            random_state ^= random_state << 13;
+            random_state ^= random_state >> 7;
+            random_state ^= random_state << 17;
+            return random_state;
+        }
+
+        // Sequential insertion with a random walk, used while growing
+        void insert(value_type &&value) {
+            size_t hash = hash_of(value.first);
+            size_t b = index1(hash);
+            for (size_t step = 0; step < max_path; ++step) {
+                if (try_place(index1(hash), std::move(value.first), std::move(value.second)) ||
+                    try_place(index2(hash), std::move(value.first), std::move(value.second)))
+                    return;
+                // evict a random element from the bucket we didn't come from
+                b = (b == index1(hash)) ? index2(hash) : index1(hash);
+                std::swap(value, *buckets[b].slot(random() % SlotsPerBucket));
+                hash = hash_of(value.first);
+            }
+            grow();
+            insert(std::move(value));
+        }
+
+        void grow() {
+            bucket_table bigger(num_buckets * 2);
+            for (size_t b = 0; b < num_buckets; ++b) {
+                for (uint32_t occ = buckets[b].occupied; occ != 0; occ &= occ - 1) {
+                    value_type *elem = buckets[b].slot(__builtin_ctz(occ));
+                    bigger.insert(std::move(*elem));
+                    elem->~value_type();
+                }
+                buckets[b].occupied = 0;
+            }
+            std::swap(buckets, bigger.buckets);
+            std::swap(num_buckets, bigger.num_buckets);
+            std::swap(mask, bigger.mask);
+        }
+
+        void clear() {
+            for (size_t b = 0; b < num_buckets; ++b) {
+                for (uint32_t occ = buckets[b].occupied; occ != 0; occ &= occ - 1)
+                    buckets[b].slot(__builtin_ctz(occ))->~value_type();
+                buckets[b].occupied = 0;
+            }
+        }
+    };
+
+    struct alignas(64) spinlock {
+        std::atomic<bool> locked;
+        // Change in the number of elements by operations holding this lock
+        std::atomic<int64_t> elements;
+
+        spinlock() : locked(false), elements(0) {}
+
+        void lock() {
+            while (locked.exchange(true, std::memory_order_acquire)) {
+                while (locked.load(std::memory_order_relaxed))
+                    std::this_thread::yield();
+            }
+        }
+
+        void unlock() {
+            locked.store(false, std::memory_order_release);
+        }
+    };
+
+    // One step of a cuckoo path: the element in slot of bucket moves to
+    // its other bucket, which is the next step's bucket
+    struct path_step {
+        size_t bucket, slot, hash;
+    };
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    static constexpr size_t num_locks = 1 << 12;
+    static constexpr size_t max_path = 256;
+
+    static size_t buckets_for(size_t n) {
+        size_t buckets = 16;
+        while (buckets * SlotsPerBucket < n)
+            buckets *= 2;
+        return buckets;
+    }
+
+    static size_t hash_of(const Key &key) {
+        return swiss::mix(Hash()(key));
+    }
+
+    size_t hash_key(const Key &key) const {
+        return swiss::mix(hasher(key));
+    }
+
+    spinlock& lock_of(size_t bucket) const {
+        return locks[bucket & (num_locks - 1)];
+    }
+
+    // Lock the stripes of a single bucket, checking that the table wasn't
+    // resized since nb was read
+    bool lock_one(size_t b, size_t nb) const {
+        lock_of(b).lock();
+        if (nb == num_buckets.load(std::memory_order_relaxed))
+            return true;
+        lock_of(b).unlock();
+        return false;
+    }
+
+    // Lock the stripes of two buckets in order
+    void lock_pair(size_t b1, size_t b2) const {
+        size_t l1 = b1 & (num_locks - 1), l2 = b2 & (num_locks - 1);
+        if (l1 > l2) std::swap(l1, l2);
+        locks[l1].lock();
+        if (l2 != l1) locks[l2].lock();
+    }
+
+    void unlock_two(size_t b1, size_t b2) const {
+        const size_t l1 = b1 & (num_locks - 1), l2 = b2 & (num_locks - 1);
+        locks[l1].unlock();
+        if (l2 != l1) locks[l2].unlock();
+    }
+
+    // Lock a key's two buckets. Retries if the table is resized in between.
+    void lock_two(size_t hash, size_t &b1, size_t &b2) const {
+        while (true) {
+            const size_t nb = num_buckets.load(std::memory_order_acquire);
+            b1 = hash & (nb - 1);
+            b2 = (hash >> 32) & (nb - 1);
+            lock_pair(b1, b2);
+            // A resize holds all locks, so once we hold ours it's either
+            // done or hasn't started
+            if (nb == num_buckets.load(std::memory_order_relaxed))
+                return;
+            unlock_two(b1, b2);
+        }
+    }
+
+    void lock_all() const {
+        for (size_t i = 0; i < num_locks; ++i)
+            locks[i].lock();
+    }
+
+    void unlock_all() const {
+        for (size_t i = num_locks; i > 0; --i)
+            locks[i - 1].unlock();
+    }
+
+    value_type* locate(size_t b1, size_t b2, const Key &key) const {
+        value_type *elem = table.locate(b1, key, equal);
+        if (elem == nullptr && b2 != b1)
+            elem = table.locate(b2, key, equal);
+        return elem;
+    }
+
+    // Both buckets of a key were full. Free a slot in one of them by moving
+    // elements along a cuckoo path, or grow the table if there is none.
+    void make_room(size_t hash) {
+        const size_t nb = num_buckets.load(std::memory_order_acquire);
+        path_step path[max_path];
+        const size_t length = find_path(hash, nb, path);
+        if (length == npos)
+            grow(nb);
+        else
+            // If someone interfered, the caller simply retries
+            execute_path(path, length, nb);
+    }
+
+    // Random walk from one of the key's buckets to a bucket with a free
+    // slot, locking one bucket at a time. Returns the number of moves, or
+    // npos if there is no short path. If the table was resized meanwhile,
+    // the path is left empty.
+    size_t find_path(size_t hash, size_t nb, path_step *path) {
+        thread_local size_t random_state = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+        auto random = [&]() {
+            random_state ^= random_state << 13;
+            random_state ^= random_state >> 7;
+            random_state ^= random_state << 17;
+            return random_state;
+        };
+
+        const size_t mask = nb - 1;
+        size_t b = (random() & 1) ? (hash & mask) : ((hash >> 32) & mask);
+        for (size_t length = 0; length < max_path; ++length) {
+            if (!lock_one(b, nb)) return 0;
+            bucket &bu = table.buckets[b];
+            if (!bu.full()) {
+                lock_of(b).unlock();
+                return length;
+            }
+            const size_t slot = random() % SlotsPerBucket;
+            const size_t h = hash_key(bu.slot(slot)->first);
+            lock_of(b).unlock();
+
+            path[length] = path_step{b, slot, h};
+            b = ((h & mask) == b) ? ((h >> 32) & mask) : (h & mask);
+        }
+        return npos;
+    }
+
+    // Move the elements along the path, starting at the end. Every move
+    // locks the two buckets involved and checks that the path is still valid.
+    bool execute_path(const path_step *path, size_t length, size_t nb) {
+        const size_t mask = nb - 1;
+        for (size_t i = length; i > 0; --i) {
+            const path_step &step = path[i - 1];
+            const size_t target = ((step.hash & mask) == step.bucket)
+                ? ((step.hash >> 32) & mask) : (step.hash & mask);
+            lock_pair(step.bucket, target);
+            if (nb != num_buckets.load(std::memory_order_relaxed)) {
+                unlock_two(step.bucket, target);
+                return false;
+            }
+            bucket &from = table.buckets[step.bucket];
+            value_type *elem = from.slot(step.slot);
+            const bool valid = (from.occupied & (1u << step.slot))
+                && hash_key(elem->first) == step.hash
+                && !table.buckets[target].full();
+            if (valid) {
+                table.try_place(target, std::move(elem->first), std::move(elem->second));
+                elem->~value_type();
+                from.occupied &= ~(1u << step.slot);
+            }
+            unlock_two(step.bucket, target);
+            if (!valid) return false;
+        }
+        return true;
+    }
+
+    // Double the number of buckets, unless someone else already did
+    void grow(size_t nb) {
+        lock_all();
+        if (nb == num_buckets.load(std::memory_order_relaxed)) {
+            table.grow();
+            num_buckets.store(table.num_buckets, std::memory_order_release);
+        }
+        unlock_all();
+    }
+
+    mutable bucket_table table;
+    spinlock *locks;
+    std::atomic<size_t> num_buckets;
+    Hash hasher;
+    KeyEqual equal;
+};
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "hashtable.h"
+
+namespace hashtable {
+
+/// Interface for hash tables that can be used from multiple threads at once.
+/// find, erase, size and the operations declared here are thread-safe.
+/// operator[] is inherited from hashtable for single-threaded use, but the
+/// reference it returns may be invalidated by concurrent modifications.
+/// for_each is for single-threaded use as well.
+template <typename Key, typename T>
+class concurrent_hashtable : public hashtable<Key, T> {
+public:
+    // You also need to provide the following:
+    // static void register_contenders(common::contender_list<concurrent_hashtable<Key, T>> &list)
+
+    /// Insert a key with a value, or overwrite the value if the key exists.
+    /// Returns whether the key was newly inserted.
+    virtual bool insert(const Key &key, const T &value) = 0;
+
+    /// Virtual destructor to allow destruction through derived pointer
+    virtual ~concurrent_hashtable() {}
+};
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "../common/benchmark.h"
+#include "../common/benchmark_util.h"
+#include "../common/concurrency.h"
+#include "../common/contenders.h"
+#include "../common/instrumentation.h"
+
+namespace hashtable {
+
+/// Microbenchmarks for concurrent hash tables. Every benchmark splits its
+/// work evenly among the configured number of threads and reports the total
+/// number of operations, so that throughput can be measured. The threads are
+/// started in the setup, so only their work is timed.
+template <typename HashTable>
+class concurrent_microbenchmark {
+public:
+    using Configuration = common::concurrent_configuration;
+    using Benchmark = common::benchmark<HashTable, Configuration>;
+    using T = typename HashTable::mapped_type;
+
+    enum class op_kind : uint8_t { find, insert, erase };
+    struct operation {
+        op_kind kind;
+        uint32_t key;
+    };
+
+    static void* fill_data_random(HashTable&, Configuration &config, void*) {
+        return common::util::fill_data_random<T>(config.size, config.seed);
+    }
+
+    // Single-threaded, so the fill isn't part of any measurement
+    static void fill_map_random(HashTable &map, size_t size, size_t seed) {
+        std::mt19937 gen{seed};
+        for (size_t i = 1; i <= size; ++i) {
+            map.insert(i, gen());
+        }
+    }
+
+    static void* fill_both_random(HashTable &map, Configuration &config, void*) {
+        fill_map_random(map, config.size, config.seed);
+        return common::util::fill_data_random<T>(config.size, config.seed + 1);
+    }
+
+    static void delete_data(HashTable&, Configuration&, void* data) {
+        common::util::delete_data<T>(data);
+    }
+
+    // Fill half of the key range and generate a random operation mix on
+    // the whole key range, with the given percentages of finds and inserts
+    // (the rest are erasures)
+    template <int find_percent, int insert_percent>
+    static void* generate_mix(HashTable &map, Configuration &config, void*) {
+        fill_map_random(map, config.size / 2, config.seed);
+        std::mt19937 gen{config.seed + 1};
+        std::uniform_int_distribution<uint32_t> key_dist(1, config.size);
+        std::uniform_int_distribution<int> percent(0, 99);
+        return common::util::fill_data<operation>(config.size, [&](size_t) {
+            const int p = percent(gen);
+            const op_kind kind = (p < find_percent) ? op_kind::find
+                : (p < find_percent + insert_percent) ? op_kind::insert : op_kind::erase;
+            return operation{kind, key_dist(gen)};
+        });
+    }
+
+    static void delete_mix(HashTable&, Configuration&, void* data) {
+        common::util::delete_data<operation>(data);
+    }
+
+    static void run_mix(HashTable &map, Configuration &config, void* ptr) {
+        const operation* ops = static_cast<const operation*>(ptr);
+        common::util::run_parallel(config.threads, [&](size_t thread) {
+            for (size_t i = config.begin(thread); i < config.end(thread); ++i) {
+                switch (ops[i].kind) {
+                case op_kind::find:
+                    common::util::do_not_optimize(map.find(ops[i].key));
+                    break;
+                case op_kind::insert:
+                    map.insert(ops[i].key, ops[i].key);
+                    break;
+                case op_kind::erase:
+                    map.erase(ops[i].key);
+                    break;
+                }
+            }
+        });
+        common::instrumentation::report_operations(config.size);
+    }
+
+    static void register_benchmarks(common::contender_list<Benchmark> &benchmarks,
+                                    const std::vector<size_t> &thread_counts)
+    {
+        std::vector<Configuration> configs;
+        const std::vector<std::pair<size_t, size_t>> sizes{
+            std::make_pair(1<<16, 0xDECAF),
+            std::make_pair(1<<18, 0xBEEF),
+            std::make_pair(1<<20, 0xC0FFEE),
+        };
+        for (const auto &size : sizes) {
+            for (const size_t threads : thread_counts)
+                configs.push_back(Configuration{size.first, size.second, threads});
+        }
+
+        // insert data, every thread inserts its own range of keys
+        common::register_benchmark("insert", "insert",
+            common::util::with_threads(concurrent_microbenchmark::fill_data_random),
+            [](HashTable &map, Configuration &config, void* ptr) {
+                const T* data = static_cast<const T*>(ptr);
+                common::util::run_parallel(config.threads, [&](size_t thread) {
+                    for (size_t i = config.begin(thread); i < config.end(thread); ++i) {
+                        map.insert(i+1, data[i]);
+                    }
+                });
+                common::instrumentation::report_operations(config.size);
+            }, concurrent_microbenchmark::delete_data, configs, benchmarks);
+
+        // find entries that were previously inserted
+        common::register_benchmark("find", "find",
+            common::util::with_threads([](HashTable &map, Configuration &config, void*) -> void* {
+                fill_map_random(map, config.size, config.seed);
+                return nullptr;
+            }),
+            [](HashTable &map, Configuration &config, void*) {
+                common::util::run_parallel(config.threads, [&](size_t thread) {
+                    for (size_t i = config.begin(thread); i < config.end(thread); ++i) {
+                        common::util::do_not_optimize(map.find(i+1));
+                    }
+                });
+                common::instrumentation::report_operations(config.size);
+            }, configs, benchmarks);
+
+        // find random keys that very likely don't exist
+        common::register_benchmark("find random", "find-random",
+            common::util::with_threads(concurrent_microbenchmark::fill_both_random),
+            [](HashTable &map, Configuration &config, void* ptr) {
+                const T* data = static_cast<const T*>(ptr);
+                common::util::run_parallel(config.threads, [&](size_t thread) {
+                    for (size_t i = config.begin(thread); i < config.end(thread); ++i) {
+                        common::util::do_not_optimize(map.find(data[i]+1));
+                    }
+                });
+                common::instrumentation::report_operations(config.size);
+            }, concurrent_microbenchmark::delete_data, configs, benchmarks);
+
+        // erase entries that were previously inserted
+        common::register_benchmark("erase", "erase",
+            common::util::with_threads([](HashTable &map, Configuration &config, void*) -> void* {
+                fill_map_random(map, config.size, config.seed);
+                return nullptr;
+            }),
+            [](HashTable &map, Configuration &config, void*) {
+                common::util::run_parallel(config.threads, [&](size_t thread) {
+                    for (size_t i = config.begin(thread); i < config.end(thread); ++i) {
+                        map.erase(i+1);
+                    }
+                });
+                common::instrumentation::report_operations(config.size);
+            }, configs, benchmarks);
+
+        // read-mostly mix on a half-full table
+        common::register_benchmark("mix 90% find, 5% insert, 5% erase", "mix-90-5-5",
+            common::util::with_threads(concurrent_microbenchmark::generate_mix<90, 5>),
+            concurrent_microbenchmark::run_mix,
+            concurrent_microbenchmark::delete_mix, configs, benchmarks);
+
+        // write-heavy mix on a half-full table
+        common::register_benchmark("mix 50% find, 25% insert, 25% erase", "mix-50-25-25",
+            common::util::with_threads(concurrent_microbenchmark::generate_mix<50, 25>),
+            concurrent_microbenchmark::run_mix,
+            concurrent_microbenchmark::delete_mix, configs, benchmarks);
+    }
+};
+}
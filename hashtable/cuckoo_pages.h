@@ -0,0 +1,490 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "../common/contenders.h"
+#include "hashtable.h"
+#include "swiss_table.h" // for swiss::mix
+
+namespace hashtable {
+
+/// Cuckoo hashing with pages (Dietzfelbinger, Mitzenmacher, Rink 2011).
+/// The table is an array of pages of PageBytes bytes each, which should be
+/// the size of a cache line. A key hashes to a primary page, and to Choices
+/// consecutive cells on it. It also has one backup cell on a second page,
+/// which it only takes when all of its primary cells are taken. Every page
+/// counts the keys that overflowed from it to their backup page, so a
+/// lookup only touches the backup page when that count isn't zero. Lookups,
+/// successful or not, thus cost one cache miss on pages that haven't
+/// overflowed, and never more than two. Inserts take the first free cell and otherwise go for a random walk
+/// that evicts elements into their other cells. Elements for which the walk
+/// fails go into a small stash of StashSize elements, and the table grows
+/// once the stash is full.
+template <typename Key,
+          typename T,
+          size_t Choices = 2,
+          size_t PageBytes = 64,
+          size_t StashSize = 4,
+          typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class cuckoo_pages
+    : public for_each_forwarding<cuckoo_pages<Key, T, Choices, PageBytes, StashSize, Hash, KeyEqual>,
+                                 hashtable<Key, T>> {
+public:
+    using value_type = typename hashtable<Key, T>::value_type;
+
+    static constexpr size_t slots_per_page =
+        (PageBytes - 2 * sizeof(uint32_t)) / sizeof(value_type);
+
+    static_assert(Choices >= 1, "Keys need at least one cell on their primary page");
+    static_assert(slots_per_page >= 1, "Page too small for a single element");
+    static_assert(slots_per_page <= 32, "Page occupancy is stored in 32 bits");
+
+    cuckoo_pages(const size_t bucket_count = 0)
+        : pages(nullptr), num_pages(0), mask(0), num_elements(0)
+        , stash_size(0), random_state(0x9E3779B97F4A7C15ULL), hasher(), equal()
+    {
+        size_t n = min_pages;
+        while (max_load(n) < bucket_count)
+            n *= 2;
+        allocate(n);
+    }
+
+    cuckoo_pages(const cuckoo_pages &other) = delete;
+    cuckoo_pages& operator=(const cuckoo_pages &other) = delete;
+
+    virtual ~cuckoo_pages() {
+        destroy_elements();
+        std::free(pages);
+    }
+
+    // Register all contenders in the list
+    static void register_contenders(common::contender_list<hashtable<Key, T>> &list) {
+        register_variant<2,  64, 0>(list);
+        register_variant<2,  64, 4>(list);
+        register_variant<2, 128, 0>(list);
+        register_variant<2, 128, 4>(list);
+        register_variant<3,  64, 0>(list);
+        register_variant<3,  64, 4>(list);
+        register_variant<3, 128, 0>(list);
+        register_variant<3, 128, 4>(list);
+    }
+
+    T& operator[](const Key &key) override {
+        value_type *elem = locate(key);
+        if (elem == nullptr)
+            elem = insert(value_type(key, T()));
+        return elem->second;
+    }
+
+    T& operator[](Key &&key) override {
+        value_type *elem = locate(key);
+        if (elem == nullptr)
+            elem = insert(value_type(std::move(key), T()));
+        return elem->second;
+    }
+
+    maybe<T> find(const Key &key) const override {
+        const value_type *elem = locate(key);
+        if (elem == nullptr)
+            return nothing<T>();
+        return just<T>(elem->second);
+    }
+
+    void find_batch(const Key *keys, size_t n, maybe<T> *out) const override {
+        // Compute the cells of a window of keys ahead and prefetch their
+        // primary pages
+        cell candidates[batch_window][num_cells];
+        const size_t ahead = (n < batch_window) ? n : batch_window;
+        for (size_t i = 0; i < ahead; ++i) {
+            get_candidates(keys[i], candidates[i]);
+            __builtin_prefetch(&pages[candidates[i][0].page]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            cell *cand = candidates[i % batch_window];
+            const value_type *elem = locate(keys[i], cand);
+            this->replace_result(out + i,
+                elem == nullptr ? nothing<T>() : just<T>(elem->second));
+            if (i + batch_window < n) {
+                get_candidates(keys[i + batch_window], cand);
+                __builtin_prefetch(&pages[cand[0].page]);
+            }
+        }
+    }
+
+    void insert_batch(const Key *keys, const T *values, size_t n) override {
+        // Inserting may grow the table, so only prefetch ahead
+        cell candidates[num_cells];
+        const size_t ahead = (n < batch_window) ? n : batch_window;
+        for (size_t i = 0; i < ahead; ++i) {
+            get_candidates(keys[i], candidates);
+            __builtin_prefetch(&pages[candidates[0].page]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            if (i + batch_window < n) {
+                get_candidates(keys[i + batch_window], candidates);
+                __builtin_prefetch(&pages[candidates[0].page]);
+            }
+            (*this)[keys[i]] = values[i];
+        }
+    }
+
+    size_t erase(const Key &key) override {
+        cell candidates[num_cells];
+        get_candidates(key, candidates);
+        for (size_t i = 0; i < num_cells; ++i) {
+            const cell &c = candidates[i];
+            if (i == primary_cells && pages[candidates[0].page].overflow == 0) break;
+            if (!occupied(c) || !equal(slot(c)->first, key)) continue;
+            slot(c)->~value_type();
+            pages[c.page].occupied &= ~(1u << c.slot);
+            if (i == primary_cells) --pages[candidates[0].page].overflow;
+            --num_elements;
+            // Make room for a stashed element, if there is one
+            if (stash_size > 0) unstash();
+            return 1;
+        }
+        for (size_t i = 0; i < stash_size; ++i) {
+            if (equal(stash_slot(i)->first, key)) {
+                *stash_slot(i) = std::move(*stash_slot(stash_size - 1));
+                stash_slot(--stash_size)->~value_type();
+                --num_elements;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    size_t size() const override { return num_elements; }
+
+    template <typename F>
+    void for_each(F &&f) {
+        for (size_t p = 0; p < num_pages; ++p) {
+            for (uint32_t occ = pages[p].occupied; occ != 0; occ &= occ - 1) {
+                value_type *elem = pages[p].slot(__builtin_ctz(occ));
+                f(elem->first, elem->second);
+            }
+        }
+        for (size_t i = 0; i < stash_size; ++i)
+            f(stash_slot(i)->first, stash_slot(i)->second);
+    }
+
+    void clear() override {
+        destroy_elements();
+        num_elements = 0;
+        stash_size = 0;
+    }
+
+    /// Number of elements in the stash
+    size_t stashed() const { return stash_size; }
+
+    /// Number of elements in their backup cell
+    size_t overflowed() const {
+        size_t sum = 0;
+        for (size_t p = 0; p < num_pages; ++p)
+            sum += pages[p].overflow;
+        return sum;
+    }
+
+    /// Fraction of slots that are in use
+    double load_factor() const {
+        return static_cast<double>(num_elements) / (num_pages * slots_per_page);
+    }
+
+protected:
+    struct alignas(PageBytes) page {
+        uint32_t occupied; // bit i is set iff slot i is in use
+        uint32_t overflow; // number of keys from this page in their backup cell
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type
+            slots[slots_per_page];
+
+        value_type* slot(size_t i) {
+            return reinterpret_cast<value_type*>(&slots[i]);
+        }
+        const value_type* slot(size_t i) const {
+            return reinterpret_cast<const value_type*>(&slots[i]);
+        }
+    };
+    static_assert(sizeof(page) == PageBytes, "Page doesn't have the requested size");
+
+    // A key's cells: up to Choices on its primary page, then its backup cell
+    static constexpr size_t primary_cells =
+        (Choices < slots_per_page) ? Choices : slots_per_page;
+    static constexpr size_t num_cells = primary_cells + 1;
+    static constexpr size_t min_pages = 8;
+    static constexpr size_t max_walk = 256;
+    // How many keys batch operations look ahead
+    static constexpr size_t batch_window = 16;
+
+    struct cell {
+        size_t page, slot;
+        bool operator==(const cell &other) const {
+            return page == other.page && slot == other.slot;
+        }
+    };
+
+    template <size_t C, size_t P, size_t S>
+    static void register_variant(common::contender_list<hashtable<Key, T>> &list) {
+        using Factory = common::contender_factory<hashtable<Key, T>>;
+        list.register_contender(Factory(
+            "Cuckoo with pages (" + std::to_string(C) + " cells + backup, "
+                + std::to_string(P) + "B pages, stash " + std::to_string(S) + ")",
+            "cuckoo-pages-c" + std::to_string(C) + "-p" + std::to_string(P)
+                + "-s" + std::to_string(S),
+            [](){ return new cuckoo_pages<Key, T, C, P, S>(); }
+        ));
+    }
+
+    // Maximum number of elements before growing the table. Random walks
+    // start failing at about 85% load with two cells per page and 92% with
+    // three, so stay a bit below that.
+    static size_t max_load(size_t num_pages) {
+        return num_pages * slots_per_page * (Choices >= 3 ? 90 : 80) / 100;
+    }
+
+    // The primary cells are consecutive (wrapping around) from a start slot.
+    // The backup page is hashed independently and differs from the primary.
+    void get_candidates(const Key &key, cell *candidates) const {
+        const size_t hash = swiss::mix(hasher(key)), backup = swiss::mix(hash);
+        const size_t primary = hash & mask, start = (hash >> 32) % slots_per_page;
+        for (size_t i = 0; i < primary_cells; ++i)
+            candidates[i] = cell{primary, (start + i) % slots_per_page};
+        size_t backup_page = backup & mask;
+        if (backup_page == primary) backup_page ^= 1;
+        candidates[primary_cells] = cell{backup_page, (backup >> 32) % slots_per_page};
+    }
+
+    value_type* slot(const cell &c) {
+        return pages[c.page].slot(c.slot);
+    }
+    const value_type* slot(const cell &c) const {
+        return pages[c.page].slot(c.slot);
+    }
+    bool occupied(const cell &c) const {
+        return (pages[c.page].occupied >> c.slot) & 1;
+    }
+
+    value_type* stash_slot(size_t i) {
+        return reinterpret_cast<value_type*>(&stash[i]);
+    }
+    const value_type* stash_slot(size_t i) const {
+        return reinterpret_cast<const value_type*>(&stash[i]);
+    }
+
+    value_type* locate(const Key &key) {
+        return const_cast<value_type*>(
+            static_cast<const cuckoo_pages*>(this)->locate(key));
+    }
+
+    const value_type* locate(const Key &key) const {
+        cell candidates[num_cells];
+        get_candidates(key, candidates);
+        return locate(key, candidates);
+    }
+
+    // Look for key in its cells and the stash. The backup page is only
+    // read if some key of the primary page overflowed.
+    const value_type* locate(const Key &key, const cell *candidates) const {
+        for (size_t i = 0; i < primary_cells; ++i) {
+            if (occupied(candidates[i]) && equal(slot(candidates[i])->first, key))
+                return slot(candidates[i]);
+        }
+        if (pages[candidates[0].page].overflow > 0) {
+            const cell &backup = candidates[primary_cells];
+            if (occupied(backup) && equal(slot(backup)->first, key))
+                return slot(backup);
+        }
+        for (size_t i = 0; i < stash_size; ++i) {
+            if (equal(stash_slot(i)->first, key))
+                return stash_slot(i);
+        }
+        return nullptr;
+    }
+
+    // Primary page of the element in cell c, if c is its backup cell
+    bool in_backup(const cell &c, size_t &primary) const {
+        primary = swiss::mix(hasher(slot(c)->first)) & mask;
+        return primary != c.page;
+    }
+
+    // Account for the element in c being moved in (+1) or out (-1) of it
+    void count(const cell &c, int delta) {
+        size_t primary;
+        if (in_backup(c, primary))
+            pages[primary].overflow += delta;
+    }
+
+    // Move value into cell c, if it is free
+    value_type* try_place(const cell &c, value_type &value) {
+        if (occupied(c)) return nullptr;
+        pages[c.page].occupied |= 1u << c.slot;
+        value_type *elem = new (slot(c)) value_type(std::move(value));
+        count(c, 1);
+        return elem;
+    }
+
+    // Swap value with the element in cell c
+    void evict(const cell &c, value_type &value) {
+        count(c, -1);
+        std::swap(value, *slot(c));
+        count(c, 1);
+    }
+
+    size_t random() {
+        // xorshift64
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 7;
+        random_state ^= random_state << 17;
+        return random_state;
+    }
+
+    // Insert an element whose key is not in the table yet
+    value_type* insert(value_type &&value) {
+        if (num_elements >= max_load(num_pages))
+            grow();
+        ++num_elements;
+        return place(std::move(value));
+    }
+
+    // Find a place for a new element and return it. The number of elements
+    // must already include the new element.
+    value_type* place(value_type &&value) {
+        cell candidates[num_cells];
+        get_candidates(value.first, candidates);
+        for (size_t i = 0; i < num_cells; ++i) {
+            if (value_type *elem = try_place(candidates[i], value))
+                return elem;
+        }
+
+        // All cells are taken. Put the new element in place of a random
+        // victim on its primary page and go for a random walk with the
+        // victim. The new element itself must not be evicted so that we can
+        // return it.
+        cell from = candidates[random() % primary_cells];
+        value_type *result = slot(from);
+        evict(from, value);
+
+        for (size_t step = 0; step < max_walk; ++step) {
+            get_candidates(value.first, candidates);
+            for (size_t i = 0; i < num_cells; ++i) {
+                if (!(candidates[i] == from) && try_place(candidates[i], value))
+                    return result;
+            }
+            // Evict from one of the victim's other cells
+            cell others[num_cells];
+            size_t num_others = 0;
+            for (size_t i = 0; i < num_cells; ++i) {
+                if (!(candidates[i] == from) && slot(candidates[i]) != result)
+                    others[num_others++] = candidates[i];
+            }
+            if (num_others == 0) break;
+            from = others[random() % num_others];
+            evict(from, value);
+        }
+
+        // The walk failed, value is homeless
+        if (stash_size < StashSize) {
+            new (stash_slot(stash_size++)) value_type(std::move(value));
+            return result;
+        }
+        const Key key = result->first;
+        grow();
+        place(std::move(value));
+        return locate(key);
+    }
+
+    // Try to move stashed elements back into the table, without evicting
+    void unstash() {
+        cell candidates[num_cells];
+        for (size_t i = 0; i < stash_size; ) {
+            get_candidates(stash_slot(i)->first, candidates);
+            bool placed = false;
+            for (size_t j = 0; j < num_cells && !placed; ++j)
+                placed = try_place(candidates[j], *stash_slot(i)) != nullptr;
+            if (placed) {
+                *stash_slot(i) = std::move(*stash_slot(stash_size - 1));
+                stash_slot(--stash_size)->~value_type();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    // Double the number of pages and re-insert everything
+    void grow() {
+        cuckoo_pages bigger(0);
+        std::free(bigger.pages);
+        bigger.allocate(num_pages * 2);
+
+        for (size_t p = 0; p < num_pages; ++p) {
+            for (uint32_t occ = pages[p].occupied; occ != 0; occ &= occ - 1) {
+                value_type *elem = pages[p].slot(__builtin_ctz(occ));
+                bigger.insert(std::move(*elem));
+                elem->~value_type();
+            }
+            pages[p].occupied = 0;
+            pages[p].overflow = 0;
+        }
+        for (size_t i = 0; i < stash_size; ++i) {
+            bigger.insert(std::move(*stash_slot(i)));
+            stash_slot(i)->~value_type();
+        }
+        stash_size = 0;
+
+        std::swap(pages, bigger.pages);
+        std::swap(num_pages, bigger.num_pages);
+        std::swap(mask, bigger.mask);
+        for (size_t i = 0; i < bigger.stash_size; ++i) {
+            new (stash_slot(i)) value_type(std::move(*bigger.stash_slot(i)));
+            bigger.stash_slot(i)->~value_type();
+        }
+        std::swap(stash_size, bigger.stash_size);
+        // bigger's destructor frees our old (now empty) pages
+    }
+
+    void allocate(size_t n) {
+        void *mem = nullptr;
+        if (posix_memalign(&mem, PageBytes, n * sizeof(page)) != 0)
+            throw std::bad_alloc();
+        pages = static_cast<page*>(mem);
+        for (size_t p = 0; p < n; ++p) {
+            pages[p].occupied = 0;
+            pages[p].overflow = 0;
+        }
+        num_pages = n;
+        mask = n - 1;
+    }
+
+    void destroy_elements() {
+        for (size_t p = 0; p < num_pages; ++p) {
+            for (uint32_t occ = pages[p].occupied; occ != 0; occ &= occ - 1)
+                pages[p].slot(__builtin_ctz(occ))->~value_type();
+            pages[p].occupied = 0;
+            pages[p].overflow = 0;
+        }
+        for (size_t i = 0; i < stash_size; ++i)
+            stash_slot(i)->~value_type();
+    }
+
+    page *pages;
+    size_t num_pages, mask;
+    size_t num_elements;
+    // An empty std::array hands out null pointers, which the compiler warns
+    // about in the (never executed) stash code of stash-less variants
+    std::array<typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type,
+               StashSize == 0 ? 1 : StashSize> stash;
+    size_t stash_size;
+    size_t random_state;
+    Hash hasher;
+    KeyEqual equal;
+};
+
+}
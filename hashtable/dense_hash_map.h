@@ -14,9 +14,10 @@ template <typename Key,
           typename HashFcn = std::hash<Key>,
           typename EqualKey = std::equal_to<Key>,
           typename Alloc = google::libc_allocator_with_realloc<std::pair<const Key, T>>>
-class dense_hash_map : public hashtable<Key, T> {
+class dense_hash_map
+    : public for_each_forwarding<dense_hash_map<Key, T, HashFcn, EqualKey, Alloc>, hashtable<Key, T>> {
 public:
-    dense_hash_map(const size_t bucket_count = 0, const Key empty_key = Key{}, const Key deleted_key = Key{-1}) : hashtable<Key, T>(), map(bucket_count) {
+    dense_hash_map(const size_t bucket_count = 0, const Key empty_key = Key{}, const Key deleted_key = Key{-1}) : map(bucket_count) {
         map.set_empty_key(empty_key);
         if (deleted_key != empty_key) {
             map.set_deleted_key(deleted_key);
@@ -59,6 +60,12 @@ public:
 
     size_t size() const override { return map.size(); }
 
+    template <typename F>
+    void for_each(F &&f) {
+        for (auto &elem : map)
+            f(elem.first, elem.second);
+    }
+
     void clear() override { map.clear(); }
 
 protected:
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <utility>
+
 #include "../common/maybe.h"
 
 using namespace common::monad;
@@ -25,6 +30,21 @@ public:
     /// Find a key in the hash table
     virtual maybe<T> find(const Key &key) const = 0;
 
+    /// Find a batch of keys. out must point to n maybe<T>s, which are
+    /// replaced by the results. Override this to overlap the memory accesses
+    /// of several lookups, e.g. by hashing ahead and prefetching.
+    virtual void find_batch(const Key *keys, size_t n, maybe<T> *out) const {
+        for (size_t i = 0; i < n; ++i)
+            replace_result(out + i, find(keys[i]));
+    }
+
+    /// Insert a batch of keys with their values, overwriting the values of
+    /// keys that already exist
+    virtual void insert_batch(const Key *keys, const T *values, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            (*this)[keys[i]] = values[i];
+    }
+
     /// Erases all elements with the given key
     /// Returns the number of elements removed
     virtual size_t erase(const Key &key) = 0;
@@ -32,10 +52,49 @@ public:
     /// Returns the number of elements
     virtual size_t size() const = 0;
 
+    /// Call f(key, value) for every element, in no particular order. f may
+    /// modify the values, but not the hash table. Implementations usually
+    /// get this from for_each_forwarding.
+    virtual void for_each(const std::function<void(const Key&, T&)> &f) = 0;
+
     /// Clear the hash table
     virtual void clear() = 0;
 
     /// Virtual destructor to allow destruction through derived pointer
     virtual ~hashtable() {}
+
+protected:
+    // maybe's members are const, so it can't be assigned to
+    static void replace_result(maybe<T> *out, maybe<T> &&result) {
+        out->~maybe<T>();
+        new (out) maybe<T>(std::move(result));
+    }
+};
+
+/// Mixin that implements the virtual for_each of Base, a hash table
+/// interface, by calling the template for_each(F &&f) of Derived. Tables
+/// derive from for_each_forwarding<table, interface> instead of the
+/// interface and only write the template: devirtualized callers get it
+/// directly, so that f can be inlined into the scan.
+template <typename Derived, typename Base>
+class for_each_forwarding : public Base {
+public:
+    void for_each(const std::function<void(const typename Base::key_type&,
+                                           typename Base::mapped_type&)> &f) override {
+        static_cast<Derived*>(this)->for_each(f);
+    }
+};
+
+/// Implemented by open addressing tables that know how far their elements
+/// are from their home slots. Benchmarks report it for them.
+class displacement_statistics {
+public:
+    /// Largest distance of an element from its home slot
+    virtual size_t max_displacement() const = 0;
+
+    /// Average distance of the elements from their home slots
+    virtual double mean_displacement() const = 0;
+
+    virtual ~displacement_statistics() {}
 };
 }
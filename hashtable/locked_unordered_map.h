@@ -0,0 +1,89 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+
+#include "../common/contenders.h"
+#include "concurrent_hashtable.h"
+
+namespace hashtable {
+
+/// std::unordered_map behind a single global mutex, as a baseline for the
+/// concurrent hash tables
+template <typename Key,
+          typename T,
+          typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>,
+          typename Allocator = std::allocator<std::pair<const Key, T>>>
+class locked_unordered_map
+    : public for_each_forwarding<locked_unordered_map<Key, T, Hash, KeyEqual, Allocator>,
+                                 concurrent_hashtable<Key, T>> {
+public:
+    locked_unordered_map(const size_t bucket_count = 0) : map(bucket_count) {}
+    virtual ~locked_unordered_map() = default;
+
+    // Register all contenders in the list
+    static void register_contenders(common::contender_list<concurrent_hashtable<Key, T>> &list) {
+        using Factory = common::contender_factory<concurrent_hashtable<Key, T>>;
+        list.register_contender(Factory("std::unordered_map with global lock", "locked-unordered-map",
+            [](){ return new locked_unordered_map<Key, T>();}
+        ));
+    }
+
+    bool insert(const Key &key, const T &value) override {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto result = map.emplace(key, value);
+        if (!result.second)
+            result.first->second = value;
+        return result.second;
+    }
+
+    T& operator[](const Key &key) override {
+        std::lock_guard<std::mutex> guard(mutex);
+        return map[key];
+    }
+
+    T& operator[](Key&& key) override {
+        std::lock_guard<std::mutex> guard(mutex);
+        return map[std::move(key)];
+    }
+
+    maybe<T> find(const Key &key) const override {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto it = map.find(key);
+        if (it == map.end()) {
+            return nothing<T>();
+        } else {
+            return just<T>(it->second);
+        }
+    }
+
+    size_t erase(const Key &key) override {
+        std::lock_guard<std::mutex> guard(mutex);
+        return map.erase(key);
+    }
+
+    size_t size() const override {
+        std::lock_guard<std::mutex> guard(mutex);
+        return map.size();
+    }
+
+    // f runs under the lock, so it must not call the table
+    template <typename F>
+    void for_each(F &&f) {
+        std::lock_guard<std::mutex> guard(mutex);
+        for (auto &elem : map)
+            f(elem.first, elem.second);
+    }
+
+    void clear() override {
+        std::lock_guard<std::mutex> guard(mutex);
+        map.clear();
+    }
+
+protected:
+    std::unordered_map<Key, T, Hash, KeyEqual, Allocator> map;
+    mutable std::mutex mutex;
+};
+
+}
@@ -0,0 +1,375 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+#include "../common/contenders.h"
+#include "concurrent_hashtable.h"
+#include "swiss_table.h" // for swiss::mix
+
+namespace hashtable {
+
+/// Concurrent linear probing on cells that pack a key and its value into a
+/// single 64-bit word, in the style of the folklore table in growt (Maier,
+/// Sanders, Dementiev 2016). Lookups, insertions and erasures work on the
+/// cells with atomic loads and compare-and-swap only.
+/// Two key values are reserved to mark empty and erased cells. Erased cells
+/// are not reused, so a key can never end up in two cells.
+/// When the table is full, the threads that notice help migrate it: the
+/// first one allocates the new table, and after all operations in flight
+/// have left the old table, every thread copies blocks of cells until all
+/// of them are done. Memory of old tables is freed right after migration,
+/// except for their small headers, which operations that were delayed
+/// might still look at. They are freed together with the table.
+template <typename Key,
+          typename T,
+          int MaxLoadPercent = 50,
+          typename Hash = std::hash<Key>>
+class lockfree_linear_probing
+    : public for_each_forwarding<lockfree_linear_probing<Key, T, MaxLoadPercent, Hash>,
+                                 concurrent_hashtable<Key, T>> {
+    static_assert(MaxLoadPercent > 0 && MaxLoadPercent < 100,
+                  "Maximum load factor must be in (0, 100) percent");
+    static_assert(std::is_integral<Key>::value,
+                  "Keys must be integers, two of their values are reserved");
+public:
+    lockfree_linear_probing(const size_t bucket_count = 0)
+        : first(new table(capacity_for(bucket_count))), current(first)
+        , elements(0), hasher() {}
+
+    lockfree_linear_probing(const lockfree_linear_probing &other) = delete;
+    lockfree_linear_probing& operator=(const lockfree_linear_probing &other) = delete;
+
+    virtual ~lockfree_linear_probing() {
+        delete_tables();
+    }
+
+    // Register all contenders in the list. Works for lists of both
+    // hashtable and concurrent_hashtable.
+    template <typename Base>
+    static void register_contenders(common::contender_list<Base> &list) {
+        using Factory = common::contender_factory<Base>;
+        list.register_contender(Factory("lock-free linear probing (growing, max load 50%)", "lockfree-linear-probing",
+            [](){ return new lockfree_linear_probing<Key, T>(); }
+        ));
+    }
+
+    bool insert(const Key &key, const T &value) override {
+        check_key(key);
+        const size_t hash = hash_key(key);
+        while (true) {
+            table *t = enter();
+            cell *pos = nullptr;
+            const status s = t->insert(key, value, hash, true, pos);
+            leave(t);
+            if (s == status::inserted) {
+                elements.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            if (s == status::found)
+                return false;
+            migrate(t);
+        }
+    }
+
+    /// The returned reference is written to without synchronization, and
+    /// it's invalidated by the next migration
+    T& operator[](const Key &key) override {
+        check_key(key);
+        const size_t hash = hash_key(key);
+        while (true) {
+            table *t = enter();
+            cell *pos = nullptr;
+            const status s = t->insert(key, T(), hash, false, pos);
+            leave(t);
+            if (s == status::inserted)
+                elements.fetch_add(1, std::memory_order_relaxed);
+            if (s != status::full)
+                return pos->value;
+            migrate(t);
+        }
+    }
+
+    T& operator[](Key &&key) override {
+        return (*this)[static_cast<const Key&>(key)];
+    }
+
+    maybe<T> find(const Key &key) const override {
+        if (key == empty_key || key == deleted_key)
+            return nothing<T>();
+        const size_t hash = hash_key(key);
+        table *t = enter();
+        const cell *pos = t->find(key, hash);
+        maybe<T> result = (pos == nullptr) ? nothing<T>() : just<T>(load(*pos).value);
+        leave(t);
+        return result;
+    }
+
+    size_t erase(const Key &key) override {
+        if (key == empty_key || key == deleted_key)
+            return 0;
+        const size_t hash = hash_key(key);
+        table *t = enter();
+        const size_t erased = t->erase(key, hash);
+        leave(t);
+        if (erased > 0)
+            elements.fetch_sub(1, std::memory_order_relaxed);
+        return erased;
+    }
+
+    size_t size() const override {
+        return elements.load(std::memory_order_relaxed);
+    }
+
+    /// Not thread-safe
+    template <typename F>
+    void for_each(F &&f) {
+        table *t = current.load();
+        for (size_t i = 0; i < t->capacity; ++i) {
+            cell &c = t->cells[i];
+            if (c.key != empty_key && c.key != deleted_key)
+                f(c.key, c.value);
+        }
+    }
+
+    /// Not thread-safe
+    void clear() override {
+        const size_t capacity = current.load()->capacity;
+        delete_tables();
+        first = new table(capacity);
+        current.store(first);
+        elements.store(0);
+    }
+
+protected:
+    // Key and value, loaded and swapped as a whole
+    struct alignas(8) cell {
+        Key key;
+        T value;
+    };
+    static_assert(sizeof(cell) == 8, "Key and value must fit into 64 bits together");
+    static_assert(std::is_trivially_copyable<cell>::value,
+                  "Keys and values must be trivially copyable");
+
+    static constexpr Key empty_key = std::numeric_limits<Key>::max();
+    static constexpr Key deleted_key = std::numeric_limits<Key>::max() - 1;
+    static constexpr size_t block_size = 4096; // cells per migration block
+
+    enum class status { inserted, found, full };
+
+    static cell load(const cell &c) {
+        cell result;
+        __atomic_load(&c, &result, __ATOMIC_ACQUIRE);
+        return result;
+    }
+
+    // On failure, expected is updated to the cell's current contents
+    static bool cas(cell &c, cell &expected, cell desired) {
+        return __atomic_compare_exchange(&c, &expected, &desired, false,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    }
+
+    static size_t max_fill(size_t capacity) {
+        return capacity * MaxLoadPercent / 100;
+    }
+
+    static size_t capacity_for(size_t n) {
+        size_t capacity = 64;
+        while (max_fill(capacity) < n)
+            capacity *= 2;
+        return capacity;
+    }
+
+    struct table {
+        cell *cells;
+        const size_t capacity, mask;
+        std::atomic<size_t> occupied;   // cells that aren't empty
+        std::atomic<size_t> users;      // operations in flight
+        std::atomic<bool> migrating;
+        std::atomic<table*> next;       // set once migration has started
+        std::atomic<size_t> next_block, blocks_done;
+
+        explicit table(size_t capacity)
+            : cells(new cell[capacity]), capacity(capacity), mask(capacity - 1)
+            , occupied(0), users(0), migrating(false), next(nullptr)
+            , next_block(0), blocks_done(0)
+        {
+            for (size_t i = 0; i < capacity; ++i)
+                cells[i] = cell{empty_key, T()};
+        }
+
+        ~table() {
+            delete[] cells;
+        }
+
+        const cell* find(const Key &key, size_t hash) const {
+            for (size_t i = hash & mask, step = 0; step < capacity; i = (i + 1) & mask, ++step) {
+                const Key k = load(cells[i]).key;
+                if (k == key) return cells + i;
+                if (k == empty_key) return nullptr;
+            }
+            return nullptr;
+        }
+
+        // Insert a key, or find it. If assign is set, an existing key's
+        // value is overwritten. pos is set to the key's cell.
+        status insert(const Key &key, const T &value, size_t hash, bool assign, cell *&pos) {
+            for (size_t i = hash & mask, step = 0; step < capacity; ) {
+                cell c = load(cells[i]);
+                if (c.key == key) {
+                    pos = cells + i;
+                    // Only fails if the value changed or the key was erased
+                    while (assign && c.key == key && !cas(cells[i], c, cell{key, value})) {}
+                    if (c.key == key)
+                        return status::found;
+                    // erased concurrently, keep probing
+                } else if (c.key == empty_key) {
+                    if (occupied.load(std::memory_order_relaxed) >= max_fill(capacity))
+                        return status::full;
+                    if (cas(cells[i], c, cell{key, value})) {
+                        occupied.fetch_add(1, std::memory_order_relaxed);
+                        pos = cells + i;
+                        return status::inserted;
+                    }
+                    // someone else took the cell, look at it again
+                    continue;
+                }
+                i = (i + 1) & mask;
+                ++step;
+            }
+            return status::full;
+        }
+
+        size_t erase(const Key &key, size_t hash) {
+            for (size_t i = hash & mask, step = 0; step < capacity; i = (i + 1) & mask, ++step) {
+                cell c = load(cells[i]);
+                // The value may change under our feet, retry until it doesn't
+                while (c.key == key) {
+                    if (cas(cells[i], c, cell{deleted_key, T()}))
+                        return 1;
+                }
+                if (c.key == empty_key) return 0;
+            }
+            return 0;
+        }
+
+        // Migration helpers insert concurrently into the new table, but
+        // every key is only inserted once
+        void place(const cell &c, size_t hash) {
+            for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+                cell expected{empty_key, T()};
+                if (load(cells[i]).key == empty_key && cas(cells[i], expected, c))
+                    return;
+            }
+        }
+    };
+
+    static void check_key(const Key &key) {
+        if (key == empty_key || key == deleted_key)
+            throw std::invalid_argument("lockfree_linear_probing: reserved key");
+    }
+
+    size_t hash_key(const Key &key) const {
+        return swiss::mix(hasher(key));
+    }
+
+    // Announce an operation on the current table, helping with migrations
+    // until there is a table that isn't being migrated
+    table* enter() const {
+        while (true) {
+            table *t = current.load(std::memory_order_acquire);
+            // Both of these are sequentially consistent, as are their
+            // counterparts in help_migrate, so either we see the migration
+            // or the migration sees us
+            t->users.fetch_add(1);
+            if (!t->migrating.load())
+                return t;
+            t->users.fetch_sub(1);
+            help_migrate(t);
+        }
+    }
+
+    void leave(table *t) const {
+        t->users.fetch_sub(1, std::memory_order_release);
+    }
+
+    // Start migrating a full table, unless someone else already did, and help
+    void migrate(table *t) {
+        bool expected = false;
+        if (t->migrating.compare_exchange_strong(expected, true)) {
+            // Double the capacity unless most of the table are erased cells
+            const size_t live = elements.load(std::memory_order_relaxed);
+            size_t capacity = t->capacity;
+            if (live >= max_fill(capacity) / 2)
+                capacity *= 2;
+            while (max_fill(capacity) <= live)
+                capacity *= 2;
+            t->next.store(new table(capacity), std::memory_order_release);
+        }
+        help_migrate(t);
+    }
+
+    // Copy blocks of cells into the next table until all are taken, then
+    // wait for the other helpers to finish theirs
+    void help_migrate(table *t) const {
+        table *next;
+        while ((next = t->next.load(std::memory_order_acquire)) == nullptr)
+            std::this_thread::yield();
+        while (t->users.load() != 0)
+            std::this_thread::yield();
+
+        const size_t blocks = (t->capacity + block_size - 1) / block_size;
+        while (true) {
+            const size_t block = t->next_block.fetch_add(1, std::memory_order_relaxed);
+            if (block >= blocks) break;
+
+            // Nobody writes to the old table anymore
+            const size_t end = std::min(t->capacity, (block + 1) * block_size);
+            size_t copied = 0;
+            for (size_t i = block * block_size; i < end; ++i) {
+                const cell c = t->cells[i];
+                if (c.key == empty_key || c.key == deleted_key) continue;
+                next->place(c, hash_key(c.key));
+                ++copied;
+            }
+            next->occupied.fetch_add(copied, std::memory_order_relaxed);
+
+            if (t->blocks_done.fetch_add(1, std::memory_order_acq_rel) + 1 == blocks) {
+                // Last block done. Nobody is going to look at the cells again.
+                delete[] t->cells;
+                t->cells = nullptr;
+                current.store(next, std::memory_order_release);
+            }
+        }
+        while (current.load(std::memory_order_acquire) == t)
+            std::this_thread::yield();
+    }
+
+    void delete_tables() {
+        table *t = first;
+        while (t != nullptr) {
+            table *next = t->next.load();
+            delete t;
+            t = next;
+        }
+        first = nullptr;
+    }
+
+    table *first; // oldest table, the others are reachable from here
+    mutable std::atomic<table*> current;
+    std::atomic<size_t> elements;
+    Hash hasher;
+};
+
+template <typename Key, typename T, int MaxLoadPercent, typename Hash>
+constexpr Key lockfree_linear_probing<Key, T, MaxLoadPercent, Hash>::empty_key;
+template <typename Key, typename T, int MaxLoadPercent, typename Hash>
+constexpr Key lockfree_linear_probing<Key, T, MaxLoadPercent, Hash>::deleted_key;
+
+}
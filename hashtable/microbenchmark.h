@@ -2,31 +2,45 @@
 
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "../common/benchmark.h"
 #include "../common/benchmark_util.h"
 #include "../common/contenders.h"
+#include "../common/displacement.h"
+#include "../common/latency.h"
 
 namespace hashtable {
 
 template <typename HashTable>
 class microbenchmark {
 public:
-    using Configuration = std::pair<size_t, size_t>;
+    using Configuration = common::key_configuration;
     using Benchmark = common::benchmark<HashTable, Configuration>;
     using BenchmarkFactory = common::contender_factory<Benchmark>;
+    using Key = typename HashTable::key_type;
     using T = typename HashTable::mapped_type;
     common::contender_list<Benchmark> benchmarks;
 
+    // Keys are processed in batches of this size by the batch benchmarks
+    static constexpr size_t batch_size = 1024;
+
+    // Keys 1..n, their values, and room for the results of a batch
+    struct batch_data {
+        std::vector<Key> keys;
+        std::vector<T> values;
+        std::vector<maybe<T>> results;
+    };
+
     template <int factor=1>
     static void* fill_data_random(HashTable&, Configuration config, void*) {
         return common::util::fill_data_random<T>(
-            factor*config.first, config.second);
+            factor*config.size, config.seed);
     }
 
     static void* fill_map_random(HashTable &map, Configuration config, void*) {
-        std::mt19937 gen{config.second};
-        for (size_t i = 1; i <= config.first; ++i) {
+        std::mt19937 gen{config.seed};
+        for (size_t i = 1; i <= config.size; ++i) {
             map[i] = gen();
         }
         return nullptr;
@@ -35,7 +49,7 @@ public:
     template <int factor = 1>
     static void* fill_both_random(HashTable &map, Configuration config, void* ptr) {
         fill_map_random(map, config, ptr);
-        config.second++;
+        config.seed++;
         return fill_data_random<factor>(map, config, ptr);
     }
 
@@ -43,24 +57,102 @@ public:
         common::util::delete_data<T>(data);
     }
 
+    // Report the displacement of tables that keep track of it
+    static void report_displacement(const HashTable &map) {
+        auto table = dynamic_cast<const displacement_statistics*>(&map);
+        if (table != nullptr)
+            common::report_displacement(*table);
+    }
+
+    static void* fill_batch_data(HashTable&, Configuration config, void*) {
+        batch_data *data = new batch_data;
+        std::mt19937 gen{config.seed};
+        for (size_t i = 1; i <= config.size; ++i) {
+            data->keys.push_back(i);
+            data->values.push_back(gen());
+        }
+        data->results.resize(batch_size);
+        return data;
+    }
+
+    static void* fill_map_batch_data(HashTable &map, Configuration config, void* ptr) {
+        fill_map_random(map, config, ptr);
+        return fill_batch_data(map, config, ptr);
+    }
+
+    static void delete_batch_data(HashTable&, Configuration, void* data) {
+        delete static_cast<batch_data*>(data);
+    }
+
+    // Keys 1..n in the map, and the keys of n operations on it, drawn by
+    // the configuration's key distribution
+    static void* fill_map_keys(HashTable &map, Configuration config, void* ptr) {
+        fill_map_random(map, config, ptr);
+        return common::util::fill_keys<Key>(config.size, config.size, config.keys, config.seed + 1);
+    }
+
+    static void delete_keys(HashTable&, Configuration, void* data) {
+        common::util::delete_data<Key>(data);
+    }
+
+    // Operations of a YCSB-style workload: the keys as in fill_map_keys,
+    // each operation an update with the given probability, else a read
+    struct workload_data {
+        std::vector<Key> keys;
+        std::vector<char> updates;
+    };
+
+    template <int update_percent>
+    static void* fill_map_workload(HashTable &map, Configuration config, void* ptr) {
+        fill_map_random(map, config, ptr);
+        workload_data *data = new workload_data;
+        common::util::key_generator next(config.keys, config.size, config.size, config.seed + 1);
+        std::mt19937 gen{config.seed + 2};
+        std::bernoulli_distribution update(update_percent / 100.0);
+        for (size_t i = 0; i < config.size; ++i) {
+            data->keys.push_back(static_cast<Key>(next()));
+            data->updates.push_back(update(gen));
+        }
+        return data;
+    }
+
+    static void delete_workload(HashTable&, Configuration, void* data) {
+        delete static_cast<workload_data*>(data);
+    }
+
     static void register_benchmarks(common::contender_list<Benchmark> &benchmarks) {
         auto fill = [](HashTable &map, Configuration config, void* ptr) {
             T* data = static_cast<T*>(ptr);
-            for (size_t i = 0; i < config.first; ++i) {
-                map[i+1] = data[i];
+            common::latency_probe probe;
+            for (size_t i = 0; i < config.size; ++i) {
+                probe([&]{ map[i+1] = data[i]; });
             }
+            microbenchmark::report_displacement(map);
             return nullptr;
         };
 
         const std::vector<Configuration> configs{
-            std::make_pair(1<<16, 0xDECAF),
-            std::make_pair(1<<18, 0xBEEF),
-            std::make_pair(1<<20, 0xC0FFEE),
-            //std::make_pair(1<<22, 0xF005BA11),
-            //std::make_pair(1<<24, 0xBA5EBA11),
-            //std::make_pair(1<<26, 0xCA55E77E)
+            Configuration{1<<16, 0xDECAF},
+            Configuration{1<<18, 0xBEEF},
+            Configuration{1<<20, 0xC0FFEE},
+            //Configuration{1<<22, 0xF005BA11},
+            //Configuration{1<<24, 0xBA5EBA11},
+            //Configuration{1<<26, 0xCA55E77E}
         };
 
+        // The skewed lookups on two Zipf distributions, and the YCSB-style
+        // workloads on all kinds of locality
+        std::vector<Configuration> zipf_configs, workload_configs;
+        for (const Configuration &config : configs) {
+            for (double s : {0.99, 1.2})
+                zipf_configs.push_back(Configuration{config.size, config.seed, common::key_distribution::zipf(s)});
+            for (const auto &keys : {common::key_distribution::zipf(0.99),
+                                     common::key_distribution::hotspot(0.2, 0.8),
+                                     common::key_distribution::sliding_window(0.01),
+                                     common::key_distribution::shuffled()})
+                workload_configs.push_back(Configuration{config.size, config.seed, keys});
+        }
+
         // insert data
         common::register_benchmark("insert", "insert",  microbenchmark::fill_data_random<1>,
             fill, microbenchmark::delete_data, configs, benchmarks);
@@ -69,12 +161,12 @@ public:
         common::register_benchmark("insert+find", "insert-find", microbenchmark::fill_data_random<1>,
             [](HashTable &map, Configuration config, void* ptr) {
                 T* data = static_cast<T*>(ptr);
-                size_t num = config.first;
+                size_t num = config.size;
                 for (size_t i = 0; i < num; ++i) {
                     map[i+1] = data[i];
                 }
                 for (size_t i = 1; i <= num; ++i) {
-                    map.find(i);
+                    common::util::do_not_optimize(map.find(i));
                 }
             }, microbenchmark::delete_data, configs, benchmarks);
 
@@ -82,12 +174,14 @@ public:
         common::register_benchmark("(ins-del-ins)^n (del-ins-del)^n", "ins-del-cycle", microbenchmark::fill_data_random<3>,
             [](HashTable &map, Configuration &config, void* ptr) {
                 T* data = static_cast<T*>(ptr);
-                size_t num = config.first;
+                size_t num = config.size;
                 for (size_t i = 0; i < num; ++i) {
                     map[i+1] = data[i];
                     map.erase(i+1);
                     map[i+1] = data[num + i];
                 }
+                // the map is empty at the end
+                microbenchmark::report_displacement(map);
                 for (size_t i = 0; i < num; ++i) {
                     map.erase(i+1);
                     map[i+1] = data[2*num + i];
@@ -98,16 +192,17 @@ public:
         // access entries that were previously inserted
         common::register_benchmark("access", "access", microbenchmark::fill_map_random,
             [](HashTable &map, Configuration config, void*) {
-                for (size_t i = 1; i <= config.first; ++i) {
-                    (void)map[i];
+                for (size_t i = 1; i <= config.size; ++i) {
+                    common::util::do_not_optimize(map[i]);
                 }
             }, configs, benchmarks);
 
         // find entries that were previously inserted
         common::register_benchmark("find", "find", microbenchmark::fill_map_random,
             [](HashTable &map, Configuration config, void*) {
-                for (size_t i = 1; i <= config.first; ++i) {
-                    (void)map.find(i);
+                common::latency_probe probe;
+                for (size_t i = 1; i <= config.size; ++i) {
+                    probe([&]{ common::util::do_not_optimize(map.find(i)); });
                 }
             }, configs, benchmarks);
 
@@ -115,10 +210,79 @@ public:
         common::register_benchmark("find random", "find-random", microbenchmark::fill_both_random<1>,
             [](HashTable &map, Configuration config, void* ptr) {
                 T* data = static_cast<T*>(ptr);
-                for (size_t i = 0; i < config.first; ++i) {
-                    (void)map.find(data[i]+1);
+                common::latency_probe probe;
+                for (size_t i = 0; i < config.size; ++i) {
+                    probe([&]{ common::util::do_not_optimize(map.find(data[i]+1)); });
                 }
             }, microbenchmark::delete_data, configs, benchmarks);
+
+        // find entries with Zipf-distributed popularity, some very often
+        common::register_benchmark("find zipf", "find-zipf", microbenchmark::fill_map_keys,
+            [](HashTable &map, Configuration config, void* ptr) {
+                const Key* keys = static_cast<const Key*>(ptr);
+                common::latency_probe probe;
+                for (size_t i = 0; i < config.size; ++i) {
+                    probe([&]{ common::util::do_not_optimize(map.find(keys[i])); });
+                }
+            }, microbenchmark::delete_keys, zipf_configs, benchmarks);
+
+        // access entries with Zipf-distributed popularity
+        common::register_benchmark("access zipf", "access-zipf", microbenchmark::fill_map_keys,
+            [](HashTable &map, Configuration config, void* ptr) {
+                const Key* keys = static_cast<const Key*>(ptr);
+                for (size_t i = 0; i < config.size; ++i) {
+                    common::util::do_not_optimize(map[keys[i]]);
+                }
+            }, microbenchmark::delete_keys, zipf_configs, benchmarks);
+
+        // reads and updates of existing entries, like the core workloads of
+        // the Yahoo! Cloud Serving Benchmark
+        auto workload = [](HashTable &map, Configuration config, void* ptr) {
+            const workload_data *data = static_cast<const workload_data*>(ptr);
+            common::latency_probe probe;
+            for (size_t i = 0; i < config.size; ++i) {
+                const Key key = data->keys[i];
+                if (data->updates[i])
+                    probe([&]{ map[key] = static_cast<T>(i); });
+                else
+                    probe([&]{ common::util::do_not_optimize(map.find(key)); });
+            }
+        };
+        common::register_benchmark("YCSB A (50% updates)", "ycsb-a", microbenchmark::fill_map_workload<50>,
+            workload, microbenchmark::delete_workload, workload_configs, benchmarks);
+        common::register_benchmark("YCSB B (5% updates)", "ycsb-b", microbenchmark::fill_map_workload<5>,
+            workload, microbenchmark::delete_workload, workload_configs, benchmarks);
+        common::register_benchmark("YCSB C (reads only)", "ycsb-c", microbenchmark::fill_map_workload<0>,
+            workload, microbenchmark::delete_workload, workload_configs, benchmarks);
+
+        // insert data in batches
+        common::register_benchmark("insert batches", "insert-batch", microbenchmark::fill_batch_data,
+            [](HashTable &map, Configuration config, void* ptr) {
+                batch_data *data = static_cast<batch_data*>(ptr);
+                for (size_t i = 0; i < config.size; i += batch_size) {
+                    const size_t n = (config.size - i < batch_size) ? config.size - i : batch_size;
+                    map.insert_batch(data->keys.data() + i, data->values.data() + i, n);
+                }
+            }, microbenchmark::delete_batch_data, configs, benchmarks);
+
+        // find entries that were previously inserted, in batches
+        common::register_benchmark("find batches", "find-batch", microbenchmark::fill_map_batch_data,
+            [](HashTable &map, Configuration config, void* ptr) {
+                batch_data *data = static_cast<batch_data*>(ptr);
+                for (size_t i = 0; i < config.size; i += batch_size) {
+                    const size_t n = (config.size - i < batch_size) ? config.size - i : batch_size;
+                    map.find_batch(data->keys.data() + i, n, data->results.data());
+                }
+            }, microbenchmark::delete_batch_data, configs, benchmarks);
+
+        // visit all entries once, like aggregations over the whole table.
+        // Dense layouts stream through memory, node-based ones chase pointers
+        common::register_benchmark("scan", "scan", microbenchmark::fill_map_random,
+            [](HashTable &map, Configuration, void*) {
+                size_t sum = 0; // wraps around instead of overflowing
+                map.for_each([&sum](const Key&, T &value) { sum += static_cast<size_t>(value); });
+                common::util::do_not_optimize(sum);
+            }, configs, benchmarks);
     }
 };
 }
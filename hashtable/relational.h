@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+#include "../common/benchmark.h"
+#include "../common/benchmark_util.h"
+#include "../common/contenders.h"
+#include "hashtable.h"
+
+namespace hashtable {
+
+/// Application benchmarks from query processing on columns of keys and
+/// values, like an analytical database stores them. A group-by hits a small
+/// table over and over, a hash join streams the rows of one relation past a
+/// table built on the other one, which may be large.
+template <typename HashTable>
+class relational {
+public:
+    using Configuration = common::relational_configuration;
+    using Benchmark = common::benchmark<HashTable, Configuration>;
+    using Key = typename HashTable::key_type;
+    using T = typename HashTable::mapped_type;
+
+    // Probe keys are looked up in batches of this size by the batched join
+    static constexpr size_t batch_size = 1024;
+
+    // The input of a group-by: config.rows keys from 1..config.keys, and
+    // values from 0..99, so that the sum of a group can't overflow
+    struct group_by_data {
+        std::unique_ptr<Key[]> keys;
+        std::unique_ptr<T[]> values;
+    };
+
+    // The relations of a join. The build side has the keys 1..config.keys in
+    // random order, each with its row number, the probe side config.rows
+    // keys that match one of them with probability config.match_rate.
+    struct join_data {
+        std::unique_ptr<Key[]> build_keys, probe_keys;
+        std::unique_ptr<T[]> build_values;
+        std::vector<maybe<T>> results; // of a batch
+    };
+
+    static void* fill_group_by(HashTable&, Configuration config, void*) {
+        group_by_data *data = new group_by_data;
+        data->keys.reset(static_cast<Key*>(common::util::fill_keys<Key>(
+            config.rows, config.keys, common::key_distribution::uniform(), config.seed)));
+        data->values.reset(static_cast<T*>(common::util::fill_data_uniform<T>(
+            config.rows, 99, config.seed + 1)));
+        return data;
+    }
+
+    static void delete_group_by(HashTable&, Configuration, void* data) {
+        delete static_cast<group_by_data*>(data);
+    }
+
+    static void* fill_join(HashTable&, Configuration config, void*) {
+        join_data *data = new join_data;
+        data->build_keys.reset(static_cast<Key*>(common::util::fill_keys<Key>(
+            config.keys, config.keys, common::key_distribution::shuffled(), config.seed)));
+        data->build_values.reset(common::util::fill_data<T>(
+            config.keys, [](size_t i) { return static_cast<T>(i); }));
+        data->probe_keys.reset(static_cast<Key*>(common::util::fill_probe_keys<Key>(
+            config.rows, config.keys, config.match_rate, config.seed + 1)));
+        data->results.resize(batch_size);
+        return data;
+    }
+
+    static void delete_join(HashTable&, Configuration, void* data) {
+        delete static_cast<join_data*>(data);
+    }
+
+    static void build(HashTable &map, const join_data &data, const Configuration &config) {
+        for (size_t i = 0; i < config.keys; ++i)
+            map[data.build_keys[i]] = data.build_values[i];
+    }
+
+    static void register_benchmarks(common::contender_list<Benchmark> &benchmarks) {
+        // From a few groups, which fit into the L1 cache, to so many that
+        // the table doesn't fit into the L2 cache
+        std::vector<Configuration> group_by_configs;
+        for (size_t groups : {16, 1<<10, 1<<16, 1<<20})
+            group_by_configs.push_back(Configuration::group_by(1<<22, groups, 0xDECAF));
+
+        std::vector<Configuration> join_configs;
+        for (size_t build : {1<<16, 1<<20}) {
+            for (double match_rate : {0.1, 0.9})
+                join_configs.push_back(Configuration::hash_join(build, 1<<22, match_rate, 0xBEEF));
+        }
+        register_benchmarks(benchmarks, group_by_configs, join_configs);
+    }
+
+    // Tables of millions of elements, far too large for the cache
+    static void register_large_benchmarks(common::contender_list<Benchmark> &benchmarks) {
+        const std::vector<Configuration> group_by_configs{
+            Configuration::group_by(1<<24, 1<<22, 0xC0FFEE)
+        };
+        const std::vector<Configuration> join_configs{
+            Configuration::hash_join(1<<23, 1<<24, 0.5, 0xF005BA11)
+        };
+        register_benchmarks(benchmarks, group_by_configs, join_configs);
+    }
+
+    static void register_benchmarks(common::contender_list<Benchmark> &benchmarks,
+                                    const std::vector<Configuration> &group_by_configs,
+                                    const std::vector<Configuration> &join_configs) {
+        // SELECT key, SUM(value) GROUP BY key
+        common::register_benchmark("group-by sum", "group-by", relational::fill_group_by,
+            [](HashTable &map, Configuration config, void* ptr) {
+                assert(ptr != nullptr);
+                const group_by_data *data = static_cast<const group_by_data*>(ptr);
+                for (size_t i = 0; i < config.rows; ++i)
+                    map[data->keys[i]] += data->values[i];
+                common::util::do_not_optimize(map.size());
+            }, relational::delete_group_by, group_by_configs, benchmarks);
+
+        // Build a table on one relation, then count the probe rows that
+        // find a partner and sum up the partners' row numbers
+        common::register_benchmark("hash join", "hash-join", relational::fill_join,
+            [](HashTable &map, Configuration config, void* ptr) {
+                assert(ptr != nullptr);
+                const join_data *data = static_cast<const join_data*>(ptr);
+                relational::build(map, *data, config);
+                size_t matches = 0, sum = 0;
+                for (size_t i = 0; i < config.rows; ++i) {
+                    const maybe<T> partner = map.find(data->probe_keys[i]);
+                    if (partner.valid) {
+                        ++matches;
+                        sum += static_cast<size_t>(partner.data);
+                    }
+                }
+                common::util::do_not_optimize(matches);
+                common::util::do_not_optimize(sum);
+            }, relational::delete_join, join_configs, benchmarks);
+
+        // The same with the probes in batches, which tables can overlap
+        common::register_benchmark("hash join (batched probes)", "hash-join-batch", relational::fill_join,
+            [](HashTable &map, Configuration config, void* ptr) {
+                assert(ptr != nullptr);
+                join_data *data = static_cast<join_data*>(ptr);
+                relational::build(map, *data, config);
+                size_t matches = 0, sum = 0;
+                for (size_t i = 0; i < config.rows; i += batch_size) {
+                    const size_t n = std::min(batch_size, config.rows - i);
+                    map.find_batch(data->probe_keys.get() + i, n, data->results.data());
+                    for (size_t j = 0; j < n; ++j) {
+                        if (data->results[j].valid) {
+                            ++matches;
+                            sum += static_cast<size_t>(data->results[j].data);
+                        }
+                    }
+                }
+                common::util::do_not_optimize(matches);
+                common::util::do_not_optimize(sum);
+            }, relational::delete_join, join_configs, benchmarks);
+    }
+};
+
+template <typename HashTable>
+constexpr size_t relational<HashTable>::batch_size;
+
+}
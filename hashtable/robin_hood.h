@@ -0,0 +1,298 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "../common/contenders.h"
+#include "hashtable.h"
+#include "swiss_table.h" // for swiss::mix
+
+namespace hashtable {
+
+/// Linear probing with Robin Hood insertion: an element that is further away
+/// from its home slot than the resident of a slot takes that slot, and the
+/// resident continues probing. This keeps the probe sequence lengths (PSL)
+/// balanced and lets unsuccessful lookups stop as soon as they encounter an
+/// element with a smaller PSL than the current one.
+/// Erase shifts the following elements back by one slot until it reaches an
+/// empty slot or an element in its home slot, so there are no tombstones.
+template <typename Key,
+          typename T,
+          int MaxLoadPercent = 90,
+          typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class robin_hood
+    : public for_each_forwarding<robin_hood<Key, T, MaxLoadPercent, Hash, KeyEqual>, hashtable<Key, T>>
+    , public displacement_statistics {
+    static_assert(MaxLoadPercent > 0 && MaxLoadPercent < 100,
+                  "Maximum load factor must be in (0, 100) percent");
+public:
+    using value_type = typename hashtable<Key, T>::value_type;
+
+    robin_hood(const size_t bucket_count = 0)
+        : dist(nullptr), slots(nullptr), capacity(0), mask(0)
+        , num_elements(0), hasher(), equal()
+    {
+        allocate(capacity_for(bucket_count));
+    }
+
+    robin_hood(const robin_hood &other) = delete;
+    robin_hood& operator=(const robin_hood &other) = delete;
+
+    virtual ~robin_hood() {
+        destroy_slots();
+        deallocate();
+    }
+
+    // Register all contenders in the list
+    static void register_contenders(common::contender_list<hashtable<Key, T>> &list) {
+        using Factory = common::contender_factory<hashtable<Key, T>>;
+        list.register_contender(Factory("Robin Hood (max load 80%)", "robin-hood-80",
+            [](){ return new robin_hood<Key, T, 80>(); }
+        ));
+        list.register_contender(Factory("Robin Hood (max load 95%)", "robin-hood-95",
+            [](){ return new robin_hood<Key, T, 95>(); }
+        ));
+    }
+
+    T& operator[](const Key &key) override {
+        const size_t hash = hash_key(key);
+        size_t idx = lookup(key, hash);
+        if (idx == npos)
+            idx = insert(value_type(key, T()), hash);
+        return slots[idx].second;
+    }
+
+    T& operator[](Key &&key) override {
+        const size_t hash = hash_key(key);
+        size_t idx = lookup(key, hash);
+        if (idx == npos)
+            idx = insert(value_type(std::move(key), T()), hash);
+        return slots[idx].second;
+    }
+
+    maybe<T> find(const Key &key) const override {
+        const size_t idx = lookup(key, hash_key(key));
+        if (idx == npos)
+            return nothing<T>();
+        return just<T>(slots[idx].second);
+    }
+
+    void find_batch(const Key *keys, size_t n, maybe<T> *out) const override {
+        // Hash a window of keys ahead and prefetch their home slots
+        size_t hashes[batch_window];
+        const size_t ahead = (n < batch_window) ? n : batch_window;
+        for (size_t i = 0; i < ahead; ++i) {
+            hashes[i] = hash_key(keys[i]);
+            prefetch(hashes[i]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            const size_t hash = hashes[i % batch_window];
+            if (i + batch_window < n) {
+                hashes[i % batch_window] = hash_key(keys[i + batch_window]);
+                prefetch(hashes[i % batch_window]);
+            }
+            const size_t idx = lookup(keys[i], hash);
+            this->replace_result(out + i,
+                idx == npos ? nothing<T>() : just<T>(slots[idx].second));
+        }
+    }
+
+    void insert_batch(const Key *keys, const T *values, size_t n) override {
+        // Inserting may grow the table, so only prefetch ahead and hash again
+        const size_t ahead = (n < batch_window) ? n : batch_window;
+        for (size_t i = 0; i < ahead; ++i)
+            prefetch(hash_key(keys[i]));
+        for (size_t i = 0; i < n; ++i) {
+            if (i + batch_window < n)
+                prefetch(hash_key(keys[i + batch_window]));
+            (*this)[keys[i]] = values[i];
+        }
+    }
+
+    size_t erase(const Key &key) override {
+        size_t idx = lookup(key, hash_key(key));
+        if (idx == npos)
+            return 0;
+
+        // Backward shift: move the following elements one slot closer to
+        // their home until one is already there (or the slot is empty)
+        size_t next = (idx + 1) & mask;
+        while (dist[next] > 1) {
+            slots[idx] = std::move(slots[next]);
+            dist[idx] = dist[next] - 1;
+            idx = next;
+            next = (next + 1) & mask;
+        }
+        slots[idx].~value_type();
+        dist[idx] = 0;
+        --num_elements;
+        return 1;
+    }
+
+    size_t size() const override { return num_elements; }
+
+    template <typename F>
+    void for_each(F &&f) {
+        for (size_t i = 0; i < capacity; ++i) {
+            if (dist[i] > 0)
+                f(slots[i].first, slots[i].second);
+        }
+    }
+
+    void clear() override {
+        destroy_slots();
+        std::fill(dist, dist + capacity, 0);
+        num_elements = 0;
+    }
+
+    /// Largest distance of an element from its home slot
+    size_t max_displacement() const override {
+        uint16_t max = 0;
+        for (size_t i = 0; i < capacity; ++i)
+            max = std::max(max, dist[i]);
+        return max > 0 ? max - 1 : 0;
+    }
+
+    /// Average distance of the elements from their home slots
+    double mean_displacement() const override {
+        if (num_elements == 0) return 0;
+        size_t sum = 0;
+        for (size_t i = 0; i < capacity; ++i) {
+            if (dist[i] > 0)
+                sum += dist[i] - 1;
+        }
+        return static_cast<double>(sum) / num_elements;
+    }
+
+    /// Fraction of slots that are in use
+    double load_factor() const {
+        return static_cast<double>(num_elements) / capacity;
+    }
+
+protected:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    // dist is stored in 16 bits, 0 means empty, otherwise it's PSL + 1
+    static constexpr uint16_t max_dist = 0xFFFF;
+    // How many keys batch operations hash ahead
+    static constexpr size_t batch_window = 16;
+
+    static size_t max_load(size_t capacity) {
+        return capacity * MaxLoadPercent / 100;
+    }
+
+    static size_t capacity_for(size_t n) {
+        size_t capacity = 16;
+        while (max_load(capacity) < n)
+            capacity *= 2;
+        return capacity;
+    }
+
+    size_t hash_key(const Key &key) const {
+        return swiss::mix(hasher(key));
+    }
+
+    // Load a hash's home slot into the cache
+    void prefetch(size_t hash) const {
+        __builtin_prefetch(dist + (hash & mask));
+        __builtin_prefetch(slots + (hash & mask));
+    }
+
+    // Slot of key, or npos if it isn't in the table. The search stops at
+    // the first element that is closer to its home than key would be.
+    size_t lookup(const Key &key, size_t hash) const {
+        size_t idx = hash & mask;
+        for (uint16_t d = 1; d <= dist[idx]; ++d) {
+            if (dist[idx] == d && equal(slots[idx].first, key))
+                return idx;
+            idx = (idx + 1) & mask;
+        }
+        return npos;
+    }
+
+    // Insert a new element and return its slot
+    size_t insert(value_type &&value, size_t hash) {
+        if (num_elements + 1 > max_load(capacity))
+            grow();
+        ++num_elements;
+        return place(std::move(value), hash);
+    }
+
+    // Robin Hood insertion of an element that is known not to be in the
+    // table. Returns the slot in which the element ended up.
+    size_t place(value_type &&value, size_t hash) {
+        size_t idx = hash & mask, result = npos;
+        uint16_t d = 1;
+        while (true) {
+            if (dist[idx] == 0) {
+                new (slots + idx) value_type(std::move(value));
+                dist[idx] = d;
+                return result == npos ? idx : result;
+            }
+            if (dist[idx] < d) {
+                // take from the rich, continue inserting the evicted element
+                std::swap(value, slots[idx]);
+                std::swap(d, dist[idx]);
+                if (result == npos) result = idx;
+            }
+            idx = (idx + 1) & mask;
+            // Can't happen with a reasonable hash function at our load factors
+            if (d == max_dist)
+                throw std::overflow_error("robin_hood: probe sequence too long");
+            ++d;
+        }
+    }
+
+    void grow() {
+        uint16_t *old_dist = dist;
+        value_type *old_slots = slots;
+        const size_t old_capacity = capacity;
+
+        allocate(capacity * 2);
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_dist[i] == 0) continue;
+            const size_t hash = hash_key(old_slots[i].first);
+            place(std::move(old_slots[i]), hash);
+            old_slots[i].~value_type();
+        }
+
+        delete[] old_dist;
+        std::allocator<value_type>().deallocate(old_slots, old_capacity);
+    }
+
+    void allocate(size_t new_capacity) {
+        dist = new uint16_t[new_capacity]();
+        slots = std::allocator<value_type>().allocate(new_capacity);
+        capacity = new_capacity;
+        mask = capacity - 1;
+    }
+
+    void deallocate() {
+        delete[] dist;
+        std::allocator<value_type>().deallocate(slots, capacity);
+        dist = nullptr;
+        slots = nullptr;
+    }
+
+    void destroy_slots() {
+        for (size_t i = 0; i < capacity; ++i) {
+            if (dist[i] > 0)
+                slots[i].~value_type();
+        }
+    }
+
+    uint16_t *dist;
+    value_type *slots;
+    size_t capacity, mask;
+    size_t num_elements;
+    Hash hasher;
+    KeyEqual equal;
+};
+
+}
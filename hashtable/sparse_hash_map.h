@@ -14,9 +14,10 @@ template <typename Key,
           typename HashFcn = std::hash<Key>,
           typename EqualKey = std::equal_to<Key>,
           typename Alloc = google::libc_allocator_with_realloc<std::pair<const Key, T>>>
-class sparse_hash_map : public hashtable<Key, T> {
+class sparse_hash_map
+    : public for_each_forwarding<sparse_hash_map<Key, T, HashFcn, EqualKey, Alloc>, hashtable<Key, T>> {
 public:
-    sparse_hash_map(const size_t bucket_count = 0, const Key deleted_key = Key{-1}) : hashtable<Key, T>(), map(bucket_count) {
+    sparse_hash_map(const size_t bucket_count = 0, const Key deleted_key = Key{-1}) : map(bucket_count) {
         map.set_deleted_key(deleted_key);
     }
     virtual ~sparse_hash_map() = default;
@@ -56,6 +57,12 @@ public:
 
     size_t size() const override { return map.size(); }
 
+    template <typename F>
+    void for_each(F &&f) {
+        for (auto &elem : map)
+            f(elem.first, elem.second);
+    }
+
     void clear() override { map.clear(); }
 
 protected:
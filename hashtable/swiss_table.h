@@ -0,0 +1,451 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "../common/contenders.h"
+#include "hashtable.h"
+
+namespace hashtable {
+
+namespace swiss {
+
+// Every slot has a control byte. Full slots store the lower 7 bits of their
+// key's hash (so the high bit is unset), the special states have it set.
+enum ctrl : int8_t {
+    empty = -128,   // 0b10000000
+    deleted = -2,   // 0b11111110
+};
+
+/// Group of control bytes, scanned using SSE2 byte comparisons
+#ifdef __SSE2__
+struct sse2_group {
+    static constexpr size_t width = 16;
+
+    explicit sse2_group(const int8_t *pos)
+        : ctrl(_mm_load_si128(reinterpret_cast<const __m128i*>(pos))) {}
+
+    /// Bit mask of the slots whose control byte equals h2
+    uint32_t match(int8_t h2) const {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));
+    }
+
+    uint32_t match_empty() const {
+        return match(empty);
+    }
+
+    /// Empty and deleted are the only control bytes with their high bit set
+    uint32_t match_empty_or_deleted() const {
+        return _mm_movemask_epi8(ctrl);
+    }
+
+
+    __m128i ctrl;
+};
+#endif
+
+/// Group of control bytes, scanned using AVX2 byte comparisons
+#ifdef __AVX2__
+struct avx2_group {
+    static constexpr size_t width = 32;
+
+    explicit avx2_group(const int8_t *pos)
+        : ctrl(_mm256_load_si256(reinterpret_cast<const __m256i*>(pos))) {}
+
+    uint32_t match(int8_t h2) const {
+        return _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_set1_epi8(h2), ctrl));
+    }
+
+    uint32_t match_empty() const {
+        return match(empty);
+    }
+
+    uint32_t match_empty_or_deleted() const {
+        return _mm256_movemask_epi8(ctrl);
+    }
+
+
+    __m256i ctrl;
+};
+#endif
+
+/// Scalar group for comparison (and for machines without SSE2)
+struct portable_group {
+    static constexpr size_t width = 8;
+
+    explicit portable_group(const int8_t *pos) {
+        std::memcpy(ctrl, pos, width);
+    }
+
+    uint32_t match(int8_t h2) const {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < width; ++i)
+            mask |= static_cast<uint32_t>(ctrl[i] == h2) << i;
+        return mask;
+    }
+
+    uint32_t match_empty() const {
+        return match(empty);
+    }
+
+    uint32_t match_empty_or_deleted() const {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < width; ++i)
+            mask |= static_cast<uint32_t>(ctrl[i] < 0) << i;
+        return mask;
+    }
+
+
+    int8_t ctrl[width];
+};
+
+#ifdef __SSE2__
+using default_group = sse2_group;
+#else
+using default_group = portable_group;
+#endif
+
+/// Finalizer from MurmurHash3. std::hash<int> is the identity, which doesn't
+/// give us any usable bits for the control bytes.
+inline size_t mix(size_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+}
+
+/// Open addressing with one control byte per slot holding a 7-bit hash
+/// fragment. Probing inspects whole groups of control bytes at once, only
+/// slots whose fragment matches are compared to the key. Probing proceeds
+/// quadratically over aligned groups and stops at the first group that
+/// contains an empty slot. Erasing leaves a tombstone only if the slot's
+/// group is full, i.e. if some probe sequence might have passed through it.
+template <typename Key,
+          typename T,
+          typename Group = swiss::default_group,
+          typename Hash = std::hash<Key>,
+          typename KeyEqual = std::equal_to<Key>>
+class swiss_table
+    : public for_each_forwarding<swiss_table<Key, T, Group, Hash, KeyEqual>, hashtable<Key, T>> {
+public:
+    using value_type = typename hashtable<Key, T>::value_type;
+
+    swiss_table(const size_t bucket_count = 0)
+        : ctrl(nullptr), slots(nullptr), capacity(0), num_elements(0)
+        , growth_left(0), tombstones(0), hasher(), equal()
+    {
+        allocate(capacity_for(bucket_count));
+    }
+
+    swiss_table(const swiss_table &other) = delete;
+    swiss_table& operator=(const swiss_table &other) = delete;
+
+    virtual ~swiss_table() {
+        destroy_slots();
+        deallocate();
+    }
+
+    // Register all contenders in the list
+    static void register_contenders(common::contender_list<hashtable<Key, T>> &list) {
+        using Factory = common::contender_factory<hashtable<Key, T>>;
+#ifdef __SSE2__
+        list.register_contender(Factory("Swiss table (SSE2)", "swiss-table-sse2",
+            [](){ return new swiss_table<Key, T, swiss::sse2_group>(); }
+        ));
+#endif
+#ifdef __AVX2__
+        list.register_contender(Factory("Swiss table (AVX2)", "swiss-table-avx2",
+            [](){ return new swiss_table<Key, T, swiss::avx2_group>(); }
+        ));
+#endif
+        list.register_contender(Factory("Swiss table (portable)", "swiss-table-portable",
+            [](){ return new swiss_table<Key, T, swiss::portable_group>(); }
+        ));
+    }
+
+    T& operator[](const Key &key) override {
+        auto pos = find_or_prepare_insert(key);
+        if (!pos.found) {
+            pos.idx = prepare_insert(pos.idx, pos.hash);
+            new (slots + pos.idx) value_type(key, T());
+        }
+        return slots[pos.idx].second;
+    }
+
+    T& operator[](Key &&key) override {
+        auto pos = find_or_prepare_insert(key);
+        if (!pos.found) {
+            pos.idx = prepare_insert(pos.idx, pos.hash);
+            new (slots + pos.idx) value_type(std::move(key), T());
+        }
+        return slots[pos.idx].second;
+    }
+
+    maybe<T> find(const Key &key) const override {
+        const size_t idx = lookup(key, hash_key(key));
+        if (idx == npos)
+            return nothing<T>();
+        return just<T>(slots[idx].second);
+    }
+
+    void find_batch(const Key *keys, size_t n, maybe<T> *out) const override {
+        // Hash a window of keys ahead and prefetch their first groups
+        size_t hashes[batch_window];
+        const size_t ahead = (n < batch_window) ? n : batch_window;
+        for (size_t i = 0; i < ahead; ++i) {
+            hashes[i] = hash_key(keys[i]);
+            prefetch(hashes[i]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            const size_t hash = hashes[i % batch_window];
+            if (i + batch_window < n) {
+                hashes[i % batch_window] = hash_key(keys[i + batch_window]);
+                prefetch(hashes[i % batch_window]);
+            }
+            const size_t idx = lookup(keys[i], hash);
+            this->replace_result(out + i,
+                idx == npos ? nothing<T>() : just<T>(slots[idx].second));
+        }
+    }
+
+    void insert_batch(const Key *keys, const T *values, size_t n) override {
+        // Inserting may rehash, so only prefetch ahead and hash again later
+        const size_t ahead = (n < batch_window) ? n : batch_window;
+        for (size_t i = 0; i < ahead; ++i)
+            prefetch(hash_key(keys[i]));
+        for (size_t i = 0; i < n; ++i) {
+            if (i + batch_window < n)
+                prefetch(hash_key(keys[i + batch_window]));
+            (*this)[keys[i]] = values[i];
+        }
+    }
+
+    size_t erase(const Key &key) override {
+        auto pos = find_or_prepare_insert(key);
+        if (!pos.found)
+            return 0;
+
+        const size_t idx = pos.idx;
+        slots[idx].~value_type();
+        --num_elements;
+        // If the slot's group has an empty slot, it was never full since
+        // the last rehash, so no probe sequence continues past it.
+        const Group g(ctrl + (idx & ~(width - 1)));
+        if (g.match_empty() != 0) {
+            ctrl[idx] = swiss::empty;
+            ++growth_left;
+        } else {
+            ctrl[idx] = swiss::deleted;
+            ++tombstones;
+        }
+        return 1;
+    }
+
+    size_t size() const override { return num_elements; }
+
+    // Finds the full slots a group of control bytes at a time
+    template <typename F>
+    void for_each(F &&f) {
+        for (size_t group = 0; group < capacity; group += width) {
+            uint32_t full = ~Group(ctrl + group).match_empty_or_deleted() & all_slots;
+            for (; full != 0; full &= full - 1) {
+                value_type &slot = slots[group + __builtin_ctz(full)];
+                f(slot.first, slot.second);
+            }
+        }
+    }
+
+    void clear() override {
+        destroy_slots();
+        std::memset(ctrl, swiss::empty, capacity);
+        num_elements = 0;
+        tombstones = 0;
+        growth_left = max_load(capacity);
+    }
+
+protected:
+    static constexpr size_t width = Group::width;
+    // Mask with a bit for every slot of a group
+    static constexpr uint32_t all_slots = (width == 32) ? ~0u : (1u << width) - 1;
+    static constexpr size_t npos = static_cast<size_t>(-1);
+    // How many keys batch operations hash ahead
+    static constexpr size_t batch_window = 16;
+
+    // Result of a lookup for insertion. If the key wasn't found, idx is the
+    // first free slot on its probe sequence.
+    struct probe_result {
+        size_t idx;
+        bool found;
+        size_t hash;
+    };
+
+    static int8_t fragment(size_t hash) {
+        return static_cast<int8_t>(hash & 0x7F);
+    }
+
+    // Maximum load factor 7/8, counting tombstones
+    static size_t max_load(size_t capacity) {
+        return capacity - capacity / 8;
+    }
+
+    // Smallest power of two capacity that holds n elements
+    static size_t capacity_for(size_t n) {
+        size_t capacity = 2 * width;
+        while (max_load(capacity) < n)
+            capacity *= 2;
+        return capacity;
+    }
+
+    size_t hash_key(const Key &key) const {
+        return swiss::mix(hasher(key));
+    }
+
+    // Slot of key, or npos if it isn't in the table
+    size_t lookup(const Key &key, size_t hash) const {
+        const int8_t h2 = fragment(hash);
+        size_t group = (hash >> 7) & group_mask;
+        for (size_t step = 1; ; ++step) {
+            const Group g(ctrl + group * width);
+            for (uint32_t match = g.match(h2); match != 0; match &= match - 1) {
+                const size_t idx = group * width + __builtin_ctz(match);
+                if (equal(slots[idx].first, key))
+                    return idx;
+            }
+            if (g.match_empty() != 0)
+                return npos;
+            group = (group + step) & group_mask;
+        }
+    }
+
+    // Load the first group of a hash's probe sequence into the cache
+    void prefetch(size_t hash) const {
+        const size_t group = (hash >> 7) & group_mask;
+        __builtin_prefetch(ctrl + group * width);
+        __builtin_prefetch(slots + group * width);
+    }
+
+    probe_result find_or_prepare_insert(const Key &key) const {
+        const size_t hash = hash_key(key);
+        const int8_t h2 = fragment(hash);
+        size_t group = (hash >> 7) & group_mask;
+        size_t target = npos;
+        for (size_t step = 1; ; ++step) {
+            const Group g(ctrl + group * width);
+            for (uint32_t match = g.match(h2); match != 0; match &= match - 1) {
+                const size_t idx = group * width + __builtin_ctz(match);
+                if (equal(slots[idx].first, key))
+                    return {idx, true, hash};
+            }
+            if (target == npos) {
+                const uint32_t free = g.match_empty_or_deleted();
+                if (free != 0)
+                    target = group * width + __builtin_ctz(free);
+            }
+            if (g.match_empty() != 0)
+                return {target, false, hash};
+            group = (group + step) & group_mask;
+        }
+    }
+
+    // First empty or deleted slot on the probe sequence of a hash
+    size_t find_insert_slot(size_t hash) const {
+        size_t group = (hash >> 7) & group_mask;
+        for (size_t step = 1; ; ++step) {
+            const uint32_t free = Group(ctrl + group * width).match_empty_or_deleted();
+            if (free != 0)
+                return group * width + __builtin_ctz(free);
+            group = (group + step) & group_mask;
+        }
+    }
+
+    // Claim a free slot for a new element, rehashing if needed. Returns the
+    // slot, which the caller must construct the element in.
+    size_t prepare_insert(size_t idx, size_t hash) {
+        if (ctrl[idx] == swiss::empty && growth_left == 0) {
+            rehash();
+            idx = find_insert_slot(hash);
+        }
+        if (ctrl[idx] == swiss::empty)
+            --growth_left;
+        else
+            --tombstones;
+        ctrl[idx] = fragment(hash);
+        ++num_elements;
+        return idx;
+    }
+
+    // Grow the table, or just drop the tombstones if they take up most of it
+    void rehash() {
+        int8_t *old_ctrl = ctrl;
+        value_type *old_slots = slots;
+        const size_t old_capacity = capacity;
+
+        const size_t new_capacity = (num_elements < max_load(capacity) / 2)
+            ? capacity : capacity * 2;
+        allocate(new_capacity);
+
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_ctrl[i] < 0) continue;
+            const size_t hash = hash_key(old_slots[i].first);
+            const size_t idx = find_insert_slot(hash);
+            ctrl[idx] = fragment(hash);
+            new (slots + idx) value_type(std::move(old_slots[i]));
+            old_slots[i].~value_type();
+        }
+        growth_left -= num_elements;
+
+        std::free(old_ctrl);
+        std::allocator<value_type>().deallocate(old_slots, old_capacity);
+    }
+
+    void allocate(size_t new_capacity) {
+        void *mem = nullptr;
+        // Groups are loaded with aligned loads
+        if (posix_memalign(&mem, 64, new_capacity) != 0)
+            throw std::bad_alloc();
+        ctrl = static_cast<int8_t*>(mem);
+        std::memset(ctrl, swiss::empty, new_capacity);
+        slots = std::allocator<value_type>().allocate(new_capacity);
+        capacity = new_capacity;
+        group_mask = capacity / width - 1;
+        growth_left = max_load(capacity);
+        tombstones = 0;
+    }
+
+    void deallocate() {
+        std::free(ctrl);
+        std::allocator<value_type>().deallocate(slots, capacity);
+        ctrl = nullptr;
+        slots = nullptr;
+    }
+
+    void destroy_slots() {
+        for (size_t i = 0; i < capacity; ++i) {
+            if (ctrl[i] >= 0)
+                slots[i].~value_type();
+        }
+    }
+
+    int8_t *ctrl;
+    value_type *slots;
+    size_t capacity, group_mask;
+    size_t num_elements, growth_left, tombstones;
+    Hash hasher;
+    KeyEqual equal;
+};
+
+}
@@ -13,7 +13,8 @@ template <typename Key,
           typename Hash = std::hash<Key>,
           typename KeyEqual = std::equal_to<Key>,
           typename Allocator = std::allocator<std::pair<const Key, T>>>
-class unordered_map : public hashtable<Key, T> {
+class unordered_map
+    : public for_each_forwarding<unordered_map<Key, T, Hash, KeyEqual, Allocator>, hashtable<Key, T>> {
 public:
     unordered_map(const size_t bucket_count = 0) : map(bucket_count) {}
     virtual ~unordered_map() = default;
@@ -50,6 +51,12 @@ public:
 
     size_t size() const override { return map.size(); }
 
+    template <typename F>
+    void for_each(F &&f) {
+        for (auto &elem : map)
+            f(elem.first, elem.second);
+    }
+
     void clear() override { map.clear(); }
 
 protected:
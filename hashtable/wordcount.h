@@ -1,25 +1,38 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
-#include <fstream>
-#include <sstream>
-#include <stdexcept>
+#include <functional>
+#include <map>
+#include <string>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "../common/benchmark.h"
+#include "../common/benchmark_util.h"
 #include "../common/contenders.h"
+#include "../common/corpus.h"
+#include "../pq/std_pq.h"
 
 namespace hashtable {
 
 template <typename HashTable>
 class wordcount {
 public:
-    using Configuration = std::pair<size_t, size_t>;
+    using Configuration = common::corpus_configuration;
     using Benchmark = common::benchmark<HashTable, Configuration>;
     using BenchmarkFactory = common::contender_factory<Benchmark>;
+    using Key = typename HashTable::key_type;
+    using T = typename HashTable::mapped_type;
+    // A word's count and the word
+    using Entry = std::pair<T, Key>;
 
-    // fake word count, doesn't actually determine the most frequent
-    // words because our hashtables don't have an iterator interface
+    // How many of the most frequent words the top-k benchmark determines
+    static constexpr size_t top_k = 100;
+
+    // Count the occurrences of every word
     template <typename It>
     static void count(HashTable &map, It begin, It end) {
         It it = begin;
@@ -28,56 +41,129 @@ public:
         }
     }
 
+    // The k most frequent words with their counts, most frequent first, ties
+    // broken by the larger word. Scans the table once and keeps the k most
+    // frequent words so far in a min-heap.
+    static std::vector<Entry> top_words(HashTable &map, size_t k) {
+        if (k == 0) return std::vector<Entry>();
+        pq::std_pq<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+        map.for_each([&heap, k](const Key &word, T &count) {
+            if (heap.size() < k) {
+                heap.push(Entry(count, word));
+            } else if (heap.top() < Entry(count, word)) {
+                heap.pop();
+                heap.push(Entry(count, word));
+            }
+        });
+        std::vector<Entry> top(heap.size());
+        heap.pop_n(top.size(), top.data());
+        std::reverse(top.begin(), top.end());
+        return top;
+    }
+
+    // The words of a text as keys. String keys are the words themselves, so
+    // that the hash table has to hash and compare them (string views point
+    // into the text). Integer keys are ids, one per distinct word. Cached
+    // like the texts, repetitions and other contenders get the same array.
+    static std::vector<Key>& words(const Configuration &config) {
+        const std::string key = config.description();
+        auto it = cache().find(key);
+        if (it == cache().end()) {
+            const common::corpus_text &text = common::corpus_text::get(config);
+            it = cache().emplace(key, to_keys(config, text, std::is_integral<Key>())).first;
+        }
+        return it->second;
+    }
+
+    // Free the cached words, e.g. once all benchmarks with this key type ran
+    static void clear_cache() {
+        cache().clear();
+    }
+
+    // The texts in data/ and synthetic ones whose hash tables fit into the
+    // cache, or at least mostly
     static void register_benchmarks(common::contender_list<Benchmark> &benchmarks) {
-        // HACKHACKHACK
+        std::vector<Configuration> configs = Configuration::files();
+        configs.push_back(Configuration::synthetic(10000, 1, 1000000));
+        configs.push_back(Configuration::synthetic(1000000, 1, 10000000));
+        register_benchmarks(benchmarks, configs);
+    }
+
+    // Over 10^7 distinct words in 10^8 tokens (a text of about 700 MB). The
+    // hash tables don't fit into the cache by far.
+    static void register_large_benchmarks(common::contender_list<Benchmark> &benchmarks) {
         const std::vector<Configuration> configs{
-            std::make_pair(0x4b61666b61, 0x56657277616e646c), // "Kafka", "Verwandl"
-            std::make_pair(0x5368616b657370, 0x636f6d706c657465) // "Shakesp", "complete"
+            Configuration::synthetic(20000000, 0.8, 100000000)
         };
+        register_benchmarks(benchmarks, configs);
+    }
 
-        using Key = typename HashTable::key_type;
-
-        common::register_benchmark("wordcount", "wordcount",
-            [](HashTable&, Configuration config, void*) -> void* {
-                // awful hack approaching
-                std::stringstream fn;
-                // convert encoded filename back to ascii
-                fn << "data/wordcount_" << common::util::hex_to_ascii(config.first);
-                if (config.second > 0)
-                    fn << "_" << common::util::hex_to_ascii(config.second);
-                fn << ".txt";
-
-                std::ifstream in(fn.str());
-                if (!in.is_open())
-                    throw std::invalid_argument("Cannot open file '" + fn.str() + "'.");
-
-                // map strings to key type because stupid benchmark
-                std::unordered_map<std::string, Key> ids;
-                ids[""] = Key{}; // dummy to use key Key{}
-                auto words = new std::vector<Key>();
-
-                std::string word;
-                while (in >> word) {
-                    Key& key = ids[word];
-                    if (key == Key{}) {
-                        key = static_cast<Key>(ids.size());
-                    }
-                    words->push_back(key);
-                }
-
-                // Allocate data array and copy
-                return words;
-            },
+    static void register_benchmarks(common::contender_list<Benchmark> &benchmarks,
+                                    const std::vector<Configuration> &configs) {
+        common::register_benchmark("wordcount", "wordcount", wordcount::load_words,
             [](HashTable &map, Configuration, void* ptr) {
                 assert(ptr != nullptr);
                 auto data = static_cast<std::vector<Key>*>(ptr);
                 wordcount::count(map, data->begin(), data->end());
-            },
-            [](HashTable &, Configuration, void* ptr) {
-                delete static_cast<std::vector<Key>*>(ptr);
             }, configs, benchmarks);
+
+        // count, then scan the table for the most frequent words
+        common::register_benchmark("wordcount top-k", "wordcount-topk", wordcount::load_words,
+            [](HashTable &map, Configuration, void* ptr) {
+                assert(ptr != nullptr);
+                auto data = static_cast<std::vector<Key>*>(ptr);
+                wordcount::count(map, data->begin(), data->end());
+                common::util::do_not_optimize(wordcount::top_words(map, top_k));
+            }, configs, benchmarks);
+    }
+
+protected:
+    static void* load_words(HashTable&, Configuration config, void*) {
+        return &words(config);
+    }
+
+    static std::map<std::string, std::vector<Key>>& cache() {
+        static std::map<std::string, std::vector<Key>> words;
+        return words;
     }
 
+    // String keys: the words themselves
+    static std::vector<Key> to_keys(const Configuration &, const common::corpus_text &text,
+                                    std::false_type) {
+        std::vector<Key> keys;
+        text.for_each_token([&keys](common::string_view token) {
+            keys.push_back(Key(token.data(), token.size()));
+        });
+        return keys;
+    }
+
+    // Integer keys: map strings to key type because stupid benchmark. Ids
+    // start at 1 in order of first occurrence. The words of synthetic texts
+    // are their ranks spelled out, which is much faster than looking up
+    // 10^8 words in a table of 10^7.
+    static std::vector<Key> to_keys(const Configuration &config, const common::corpus_text &text,
+                                    std::true_type) {
+        std::vector<Key> keys;
+        if (config.is_synthetic()) {
+            keys.reserve(config.tokens);
+            text.for_each_token([&keys](common::string_view token) {
+                keys.push_back(static_cast<Key>(common::util::corpus_word_rank(token)));
+            });
+            return keys;
+        }
+        std::unordered_map<common::string_view, Key> ids;
+        text.for_each_token([&keys, &ids](common::string_view token) {
+            Key &key = ids[token];
+            if (key == Key{}) {
+                key = static_cast<Key>(ids.size());
+            }
+            keys.push_back(key);
+        });
+        return keys;
+    }
 };
 
-}
\ No newline at end of file
+template <typename HashTable>
+constexpr size_t wordcount<HashTable>::top_k;
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+
+namespace pq {
+
+/// A min-priority queue of values ordered by their keys, whose elements can
+/// be addressed through handles, e.g. to decrease their keys.
+/// Handles are small integers. A handle is valid until its element is popped
+/// or erased, and it may be reused by later pushes afterwards.
+template <typename Key, typename Value>
+class addressable_priority_queue {
+public:
+    using key_type = Key;
+    using value_type = Value;
+    using handle = size_t;
+
+    // You also need to provide the following:
+    // static void register_contenders(common::contender_list<addressable_priority_queue<Key, Value>> &list)
+
+    /// Add an element and get a handle to it
+    virtual handle push(const Key &key, const Value &value) = 0;
+
+    /// Deletes the element with the smallest key
+    virtual void pop() = 0;
+
+    /// Handle of the element with the smallest key
+    virtual handle top_handle() = 0;
+
+    /// Decrease an element's key. The new key must not be larger than the
+    /// old one.
+    virtual void decrease_key(handle h, const Key &key) = 0;
+
+    /// Delete an element
+    virtual void erase(handle h) = 0;
+
+    /// The key of an element
+    virtual const Key& key(handle h) = 0;
+
+    /// The value of an element
+    virtual const Value& value(handle h) = 0;
+
+    /// Get the number of elements in the priority queue
+    virtual size_t size() = 0;
+
+    bool empty() { return size() == 0; }
+
+    /// Virtual destructor needed for inheritance
+    virtual ~addressable_priority_queue() {}
+};
+
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <random>
+#include <vector>
+
+#include "../common/benchmark.h"
+#include "../common/benchmark_util.h"
+#include "../common/concurrency.h"
+#include "../common/contenders.h"
+#include "../common/instrumentation.h"
+#include "../common/rank_error.h"
+
+namespace pq {
+
+/// Microbenchmarks for concurrent priority queues. Every benchmark splits its
+/// work evenly among the configured number of threads and reports the total
+/// number of operations, so that throughput can be measured. The threads are
+/// started in the setup, so only their work is timed. Pushes and pops are
+/// logged through rank_error_probes to measure the rank error.
+template <typename PQ>
+class concurrent_microbenchmark {
+public:
+    using Configuration = common::concurrent_configuration;
+    using Benchmark = common::benchmark<PQ, Configuration>;
+    using T = typename PQ::value_type;
+
+    static void* fill_data_random(PQ&, Configuration &config, void*) {
+        return common::util::fill_data_random<T>(config.size, config.seed);
+    }
+
+    // Single-threaded, so the fill isn't part of any measurement. Returns the
+    // values that were pushed, as the rank error log needs them.
+    static void* fill_queue_random(PQ &queue, Configuration &config, void*) {
+        T* data = static_cast<T*>(common::util::fill_data_random<T>(config.size, config.seed));
+        for (size_t i = 0; i < config.size; ++i)
+            queue.push(data[i]);
+        return data;
+    }
+
+    // The queue's values followed by as many values to push
+    static void* fill_both_random(PQ &queue, Configuration &config, void*) {
+        std::mt19937 gen{config.seed};
+        T* data = common::util::fill_data<T>(2 * config.size, [&gen](size_t) { return gen(); });
+        for (size_t i = 0; i < config.size; ++i)
+            queue.push(data[i]);
+        return data;
+    }
+
+    static void delete_data(PQ&, Configuration&, void* data) {
+        common::util::delete_data<T>(data);
+    }
+
+    static void register_benchmarks(common::contender_list<Benchmark> &benchmarks,
+                                    const std::vector<size_t> &thread_counts)
+    {
+        std::vector<Configuration> configs;
+        const std::vector<std::pair<size_t, size_t>> sizes{
+            std::make_pair(1<<16, 0xDECAF),
+            std::make_pair(1<<18, 0xBEEF),
+            std::make_pair(1<<20, 0xC0FFEE),
+        };
+        for (const auto &size : sizes) {
+            for (const size_t threads : thread_counts)
+                configs.push_back(Configuration{size.first, size.second, threads});
+        }
+
+        // every thread pushes its own range of values
+        common::register_benchmark("push", "push",
+            common::util::with_threads(concurrent_microbenchmark::fill_data_random),
+            [](PQ &queue, Configuration &config, void* ptr) {
+                const T* data = static_cast<const T*>(ptr);
+                common::util::run_parallel(config.threads, [&](size_t thread) {
+                    for (size_t i = config.begin(thread); i < config.end(thread); ++i)
+                        queue.push(data[i]);
+                });
+                common::instrumentation::report_operations(config.size);
+            }, concurrent_microbenchmark::delete_data, configs, benchmarks);
+
+        // drain a full queue from all threads
+        common::register_benchmark("pop", "pop",
+            common::util::with_threads(concurrent_microbenchmark::fill_queue_random),
+            [](PQ &queue, Configuration &config, void* ptr) {
+                const T* data = static_cast<const T*>(ptr);
+                common::start_rank_error_log(config.threads, data, data + config.size);
+                std::atomic<size_t> operations{0};
+                common::util::run_parallel(config.threads, [&](size_t thread) {
+                    common::rank_error_probe probe(thread);
+                    size_t pops = 0;
+                    T value;
+                    while (queue.try_pop(value)) {
+                        probe.popped(value);
+                        ++pops;
+                    }
+                    operations += pops;
+                });
+                common::instrumentation::report_operations(operations);
+            }, concurrent_microbenchmark::delete_data, configs, benchmarks);
+
+        // alternating pushes and pops on a full queue
+        common::register_benchmark("push-pop-mix on full queue", "push-pop-mix",
+            common::util::with_threads(concurrent_microbenchmark::fill_both_random),
+            [](PQ &queue, Configuration &config, void* ptr) {
+                const T* data = static_cast<const T*>(ptr);
+                common::start_rank_error_log(config.threads, data, data + config.size);
+                common::util::run_parallel(config.threads, [&](size_t thread) {
+                    common::rank_error_probe probe(thread);
+                    const T* values = data + config.size;
+                    T value;
+                    for (size_t i = config.begin(thread); i < config.end(thread); ++i) {
+                        probe.pushed(values[i]);
+                        queue.push(values[i]);
+                        if (queue.try_pop(value))
+                            probe.popped(value);
+                    }
+                });
+                common::instrumentation::report_operations(2 * config.size);
+            }, concurrent_microbenchmark::delete_data, configs, benchmarks);
+    }
+};
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+namespace pq {
+
+/// Interface for priority queues that can be used from multiple threads at
+/// once. Like priority_queue, it's a max-queue, but pops may be relaxed:
+/// they need not return the largest element, only one that is close to it.
+/// How close is measured as rank error by bench_pq_mt.
+template <typename T>
+class concurrent_priority_queue {
+public:
+    using value_type = T;
+
+    // You also need to provide the following:
+    // static void register_contenders(common::contender_list<concurrent_priority_queue<T>> &list)
+
+    /// Add an element
+    virtual void push(const T& value) = 0;
+
+    /// Take out an element that is (close to) the largest one. Returns false
+    /// if the queue was found empty.
+    virtual bool try_pop(T &value) = 0;
+
+    /// Get the number of elements, which may be outdated when other threads
+    /// are modifying the queue
+    virtual size_t size() = 0;
+
+    /// Virtual destructor needed for inheritance
+    virtual ~concurrent_priority_queue() {}
+};
+
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "../common/contenders.h"
+#include "priority_queue.h"
+
+namespace pq {
+
+/// Implicit d-ary max-heap with the arity as a template parameter.
+/// The root is stored at index Arity-1 of a 64-byte aligned array, so that
+/// the children of a node, which are next to each other, start at a multiple
+/// of Arity. If Arity elements take up a cache line (or an integral fraction
+/// of one), every sift-down step only touches a single cache line for the
+/// children. For ints, that's the case for all arities up to 16.
+template <typename T,
+          int Arity = 4,
+          typename Compare = std::less<T>>
+class dary_heap : public priority_queue<T> {
+    static_assert(Arity >= 2, "Heaps need an arity of at least 2");
+public:
+    dary_heap() : data(nullptr), num_elements(0), capacity(0), cmp() {}
+
+    dary_heap(const dary_heap &other) = delete;
+    dary_heap& operator=(const dary_heap &other) = delete;
+
+    virtual ~dary_heap() {
+        destroy_elements();
+        std::free(data);
+    }
+
+    static void register_contenders(common::contender_list<priority_queue<T>> &list) {
+        using Factory = common::contender_factory<priority_queue<T>>;
+        list.register_contender(Factory("aligned binary heap", "dary-heap-2",
+            [](){ return new dary_heap<T, 2>(); }
+        ));
+        list.register_contender(Factory("aligned 4-ary heap", "dary-heap-4",
+            [](){ return new dary_heap<T, 4>(); }
+        ));
+        list.register_contender(Factory("aligned 8-ary heap", "dary-heap-8",
+            [](){ return new dary_heap<T, 8>(); }
+        ));
+        list.register_contender(Factory("aligned 16-ary heap", "dary-heap-16",
+            [](){ return new dary_heap<T, 16>(); }
+        ));
+    }
+
+    /// Add an element to the priority queue by const lvalue reference
+    void push(const T& value) override {
+        push(T(value));
+    }
+    /// Add an element to the priority queue by rvalue reference (with move)
+    void push(T&& value) override {
+        if (num_elements == capacity)
+            grow();
+        sift_up(root + num_elements, std::move(value));
+        ++num_elements;
+    }
+
+    /// Deletes the top element
+    void pop() override {
+        data[root].~T();
+        --num_elements;
+        if (num_elements > 0) {
+            const size_t last = root + num_elements;
+            T value(std::move(data[last]));
+            data[last].~T();
+            sift_down(std::move(value));
+        }
+    }
+
+    /// Retrieves the top element
+    const T& top() override {
+        return data[root];
+    }
+
+    /// Get the number of elements in the priority queue
+    size_t size() override {
+        return num_elements;
+    }
+
+    /// Add the elements [begin, end). If there are at least as many of them
+    /// as there are elements in the heap already, rebuild the heap bottom-up
+    /// in linear time instead of sifting them up one by one.
+    void push_bulk(const T *begin, const T *end) override {
+        const size_t count = end - begin;
+        while (num_elements + count > capacity)
+            grow();
+        if (count < num_elements) {
+            for (; begin != end; ++begin) {
+                sift_up(root + num_elements, T(*begin));
+                ++num_elements;
+            }
+            return;
+        }
+        std::uninitialized_copy(begin, end, data + root + num_elements);
+        num_elements += count;
+        heapify();
+    }
+
+    /// Move the top k elements to out and delete them. If that's a large part
+    /// of the heap (k log n > n), select and sort them instead of popping them
+    /// one by one, and rebuild the heap from the rest.
+    size_t pop_n(size_t k, T *out) override {
+        k = std::min(k, num_elements);
+        size_t log_n = 0;
+        while ((size_t(1) << log_n) < num_elements) ++log_n;
+        if (k * log_n <= num_elements) {
+            for (size_t i = 0; i < k; ++i) {
+                out[i] = std::move(data[root]);
+                pop();
+            }
+            return k;
+        }
+        T *first = data + root, *last = first + num_elements;
+        auto before = [this](const T &a, const T &b) { return cmp(b, a); };
+        if (k < num_elements)
+            std::nth_element(first, first + k, last, before);
+        std::sort(first, first + k, before);
+        std::move(first, first + k, out);
+        std::move(first + k, last, first);
+        for (T *it = last - k; it != last; ++it)
+            it->~T();
+        num_elements -= k;
+        heapify();
+        return k;
+    }
+
+protected:
+    // Index of the root. Indices below it are unused.
+    static constexpr size_t root = Arity - 1;
+
+    static size_t parent(size_t pos) {
+        return pos / Arity + Arity - 2;
+    }
+
+    static size_t first_child(size_t pos) {
+        return Arity * (pos - Arity + 2);
+    }
+
+    // Move the hole at pos up until value can be put there, but not above
+    // top. The hole doesn't contain an element.
+    void sift_up(size_t pos, T &&value, size_t top = root) {
+        while (pos > top) {
+            const size_t p = parent(pos);
+            if (!cmp(data[p], value)) break;
+            new (data + pos) T(std::move(data[p]));
+            data[p].~T();
+            pos = p;
+        }
+        new (data + pos) T(std::move(value));
+    }
+
+    // Move the hole at start down to a leaf, always taking the place of
+    // the largest child, and sift value up from there. The element that
+    // fills the hole came from the bottom of the heap, so it usually goes
+    // back there, and this saves the comparisons against it on the way down.
+    // The element at start was removed already.
+    void sift_down(T &&value, size_t start = root) {
+        const size_t end = root + num_elements;
+        size_t pos = start;
+        while (true) {
+            const size_t child = first_child(pos);
+            if (child >= end) break;
+            // Full sibling groups have a fixed size, which lets the
+            // compiler unroll the loop
+            size_t largest = child;
+            if (child + Arity <= end) {
+                for (size_t i = child + 1; i < child + Arity; ++i) {
+                    if (cmp(data[largest], data[i])) largest = i;
+                }
+            } else {
+                for (size_t i = child + 1; i < end; ++i) {
+                    if (cmp(data[largest], data[i])) largest = i;
+                }
+            }
+            new (data + pos) T(std::move(data[largest]));
+            data[largest].~T();
+            pos = largest;
+        }
+        sift_up(pos, std::move(value), start);
+    }
+
+    // Restore the heap property for all elements bottom-up (Floyd), sifting
+    // down every inner node in reverse order. That's linear time.
+    void heapify() {
+        if (num_elements < 2) return;
+        for (size_t pos = parent(root + num_elements - 1) + 1; pos-- > root;) {
+            T value(std::move(data[pos]));
+            data[pos].~T();
+            sift_down(std::move(value), pos);
+        }
+    }
+
+    void grow() {
+        const size_t new_capacity = (capacity == 0) ? 64 : 2 * capacity;
+        void *mem = nullptr;
+        // Sibling groups are aligned to cache lines
+        if (posix_memalign(&mem, 64, (root + new_capacity) * sizeof(T)) != 0)
+            throw std::bad_alloc();
+        T *new_data = static_cast<T*>(mem);
+        for (size_t i = root; i < root + num_elements; ++i) {
+            new (new_data + i) T(std::move(data[i]));
+            data[i].~T();
+        }
+        std::free(data);
+        data = new_data;
+        capacity = new_capacity;
+    }
+
+    void destroy_elements() {
+        for (size_t i = root; i < root + num_elements; ++i)
+            data[i].~T();
+        num_elements = 0;
+    }
+
+    T *data;
+    size_t num_elements, capacity;
+    Compare cmp;
+};
+
+}
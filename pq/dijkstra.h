@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <random>
+#include <vector>
+
+#include "../common/benchmark.h"
+#include "../common/contenders.h"
+
+#include "addressable_priority_queue.h"
+
+namespace pq {
+
+/// Directed graph with edge weights in adjacency array representation
+struct graph {
+    // The edges of node u are offsets[u] to offsets[u+1]-1
+    std::vector<uint32_t> offsets, targets, weights;
+
+    size_t num_nodes() const { return offsets.size() - 1; }
+    size_t num_edges() const { return targets.size(); }
+
+    /// Road-like graph: a side x side grid in which every node is connected
+    /// to its four neighbours in both directions, with random weights.
+    static graph grid(size_t side, size_t seed, uint32_t max_weight = 1000) {
+        std::mt19937 gen{seed};
+        std::uniform_int_distribution<uint32_t> weight(1, max_weight);
+        graph g;
+        g.offsets.reserve(side * side + 1);
+        for (size_t y = 0; y < side; ++y) {
+            for (size_t x = 0; x < side; ++x) {
+                g.offsets.push_back(g.targets.size());
+                const size_t u = y * side + x;
+                if (x > 0)        g.add_edge(u - 1,    weight(gen));
+                if (x + 1 < side) g.add_edge(u + 1,    weight(gen));
+                if (y > 0)        g.add_edge(u - side, weight(gen));
+                if (y + 1 < side) g.add_edge(u + side, weight(gen));
+            }
+        }
+        g.offsets.push_back(g.targets.size());
+        return g;
+    }
+
+    /// Random graph with n nodes, each of which has degree edges to
+    /// uniformly chosen targets with random weights
+    static graph random(size_t n, size_t degree, size_t seed, uint32_t max_weight = 1000) {
+        std::mt19937 gen{seed};
+        std::uniform_int_distribution<uint32_t> target(0, n - 1), weight(1, max_weight);
+        graph g;
+        g.offsets.reserve(n + 1);
+        for (size_t u = 0; u < n; ++u) {
+            g.offsets.push_back(g.targets.size());
+            for (size_t i = 0; i < degree; ++i)
+                g.add_edge(target(gen), weight(gen));
+        }
+        g.offsets.push_back(g.targets.size());
+        return g;
+    }
+
+private:
+    void add_edge(size_t target, uint32_t weight) {
+        targets.push_back(target);
+        weights.push_back(weight);
+    }
+};
+
+/// Configuration of shortest path benchmarks: which kind of graph, its
+/// number of nodes, and a random seed for its edge weights
+struct graph_configuration {
+    enum class kind { grid, random };
+    kind type;
+    size_t nodes, seed;
+
+    friend std::ostream& operator<<(std::ostream &os, const graph_configuration &c) {
+        return os << "(" << (c.type == kind::grid ? "grid" : "random") << ", "
+                  << c.nodes << ", " << c.seed << ")";
+    }
+
+    /// RESULT columns for sqlplot-tools
+    std::ostream& result(std::ostream &os) const {
+        return os << " graph=" << (type == kind::grid ? "grid" : "random")
+                  << " nodes=" << nodes << " seed=" << seed;
+    }
+};
+
+/// Dijkstra's algorithm, with decrease_key on nodes that are in the queue
+template <typename PQ>
+class dijkstra {
+public:
+    using Configuration = graph_configuration;
+    using Benchmark = common::benchmark<PQ, Configuration>;
+    using handle = typename PQ::handle;
+    static constexpr uint64_t unreached = std::numeric_limits<uint64_t>::max();
+
+    struct instance {
+        graph g;
+        std::vector<uint64_t> distances;
+    };
+
+    /// Compute the distances of all nodes from the source. Unreachable
+    /// nodes are at distance unreached.
+    static void shortest_paths(PQ &queue, const graph &g, uint32_t source,
+                               std::vector<uint64_t> &distances)
+    {
+        distances.assign(g.num_nodes(), unreached);
+        std::vector<handle> handles(g.num_nodes());
+        distances[source] = 0;
+        handles[source] = queue.push(0, source);
+        while (!queue.empty()) {
+            const uint32_t u = queue.value(queue.top_handle());
+            queue.pop();
+            // Weights are positive, so nodes that were popped already are
+            // never updated again
+            for (uint32_t e = g.offsets[u]; e < g.offsets[u+1]; ++e) {
+                const uint32_t v = g.targets[e];
+                const uint64_t distance = distances[u] + g.weights[e];
+                if (distance >= distances[v]) continue;
+                if (distances[v] == unreached)
+                    handles[v] = queue.push(distance, v);
+                else
+                    queue.decrease_key(handles[v], distance);
+                distances[v] = distance;
+            }
+        }
+    }
+
+    static void* generate_graph(PQ&, Configuration &config, void*) {
+        instance *data = new instance;
+        if (config.type == graph_configuration::kind::grid) {
+            size_t side = 1;
+            while (side * side < config.nodes) ++side;
+            data->g = graph::grid(side, config.seed);
+        } else {
+            data->g = graph::random(config.nodes, 8, config.seed);
+        }
+        return data;
+    }
+
+    static void delete_graph(PQ&, Configuration&, void* data) {
+        delete static_cast<instance*>(data);
+    }
+
+    static void register_benchmarks(common::contender_list<Benchmark> &benchmarks) {
+        using kind = graph_configuration::kind;
+        const std::vector<Configuration> configs{
+            Configuration{kind::grid, 1<<16, 0xDECAF},
+            Configuration{kind::grid, 1<<18, 0xBEEF},
+            Configuration{kind::grid, 1<<20, 0xC0FFEE},
+            Configuration{kind::random, 1<<16, 0xDECAF},
+            Configuration{kind::random, 1<<18, 0xBEEF},
+            Configuration{kind::random, 1<<20, 0xC0FFEE},
+        };
+
+        // single-source shortest paths from node 0
+        common::register_benchmark("Dijkstra", "dijkstra", dijkstra::generate_graph,
+            [](PQ &queue, Configuration&, void* ptr) {
+                instance *data = static_cast<instance*>(ptr);
+                shortest_paths(queue, data->g, 0, data->distances);
+                assert(queue.empty());
+            }, dijkstra::delete_graph, configs, benchmarks);
+    }
+};
+
+template <typename PQ>
+constexpr uint64_t dijkstra<PQ>::unreached;
+
+}
@@ -6,7 +6,9 @@
 
 #include <ext/pb_ds/priority_queue.hpp>
 #include <utility>
+#include <vector>
 
+#include "addressable_priority_queue.h"
 #include "priority_queue.h"
 
 namespace pq {
@@ -82,6 +84,101 @@ protected:
     __gnu_pbds::priority_queue<T, Cmp_Fn, Tag, Allocator> queue;
 };
 
+/// Addressable min-priority queue on top of the GNU heaps. Handles index a
+/// table of their elements' point iterators, which stay valid while the
+/// elements are in the heap.
+template<typename Key,
+         typename Value,
+         typename Tag = __gnu_pbds::pairing_heap_tag,
+         typename Allocator = std::allocator<char>>
+class gnu_addressable_pq : public addressable_priority_queue<Key, Value> {
+    using handle = typename addressable_priority_queue<Key, Value>::handle;
+    struct element {
+        Key key;
+        Value value;
+        handle h;
+    };
+    // The GNU heaps put the largest element on top
+    struct compare {
+        bool operator()(const element &a, const element &b) const {
+            return b.key < a.key;
+        }
+    };
+    using queue_type = __gnu_pbds::priority_queue<element, compare, Tag, Allocator>;
+public:
+    gnu_addressable_pq() : queue() {}
+
+    virtual ~gnu_addressable_pq() {
+        // Pairing heap has a recursive destructor
+        queue.clear();
+    };
+
+    static void register_contenders(common::contender_list<addressable_priority_queue<Key, Value>> &list) {
+        using Factory = common::contender_factory<addressable_priority_queue<Key, Value>>;
+        list.register_contender(Factory("GNU Pairing Heap", "GNU-pairing-heap",
+            [](){ return new gnu_addressable_pq<Key, Value, __gnu_pbds::pairing_heap_tag>();}
+        ));
+        list.register_contender(Factory("GNU Binomial Heap", "GNU-binomial-heap",
+            [](){ return new gnu_addressable_pq<Key, Value, __gnu_pbds::binomial_heap_tag>();}
+        ));
+        list.register_contender(Factory("GNU RC Binomial Heap", "GNU-rc-binomial-heap",
+            [](){ return new gnu_addressable_pq<Key, Value, __gnu_pbds::rc_binomial_heap_tag>();}
+        ));
+        list.register_contender(Factory("GNU Thin Heap", "GNU-thin-heap",
+            [](){ return new gnu_addressable_pq<Key, Value, __gnu_pbds::thin_heap_tag>();}
+        ));
+    }
+
+    handle push(const Key &key, const Value &value) override {
+        handle h;
+        if (free_handles.empty()) {
+            h = iterators.size();
+            iterators.emplace_back();
+        } else {
+            h = free_handles.back();
+            free_handles.pop_back();
+        }
+        iterators[h] = queue.push(element{key, value, h});
+        return h;
+    }
+
+    void pop() override {
+        free_handles.push_back(queue.top().h);
+        queue.pop();
+    }
+
+    handle top_handle() override {
+        return queue.top().h;
+    }
+
+    void decrease_key(handle h, const Key &key) override {
+        const element &e = *iterators[h];
+        queue.modify(iterators[h], element{key, e.value, h});
+    }
+
+    void erase(handle h) override {
+        queue.erase(iterators[h]);
+        free_handles.push_back(h);
+    }
+
+    const Key& key(handle h) override {
+        return iterators[h]->key;
+    }
+
+    const Value& value(handle h) override {
+        return iterators[h]->value;
+    }
+
+    size_t size() override {
+        return queue.size();
+    }
+
+protected:
+    queue_type queue;
+    std::vector<typename queue_type::point_iterator> iterators;
+    std::vector<handle> free_handles;
+};
+
 }
 
 #endif
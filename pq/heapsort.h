@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <utility>
 
 #include "../common/benchmark.h"
@@ -29,6 +30,23 @@ public:
         }
     }
 
+    /// Heapsort with the bulk operations: one call to insert everything, and
+    /// calls to pop_n for at most n / log n elements each to take it out
+    /// again. dary_heap would select and sort larger chunks instead of
+    /// popping them, which would make this a std::sort benchmark.
+    template<typename T>
+    static void sort_bulk(PQ &heap, T *begin, T *end) {
+        heap.push_bulk(begin, end);
+        for (size_t n = heap.size(); n > 0; n = heap.size()) {
+            size_t log_n = 1;
+            while ((size_t(1) << log_n) < n) ++log_n;
+            begin += heap.pop_n(std::max<size_t>(n / log_n, 1), begin);
+        }
+    }
+
+    /// Number of elements that the top-k benchmark takes out of n
+    static size_t top_k(size_t n) { return std::max<size_t>(n / 256, 1); }
+
 
     static void register_benchmarks(common::contender_list<Benchmark> &benchmarks) {
         const std::vector<Configuration> configs{
@@ -60,6 +78,49 @@ public:
                 auto ptr = static_cast<typename PQ::value_type*>(data);
                 heapsort::sort(queue, ptr, ptr+config.first);
             }, microbenchmark<PQ>::clear_data, configs, benchmarks);
+
+        common::register_benchmark("bulk heapsort permutation", "heapsort-bulk-perm",
+            microbenchmark<PQ>::fill_data_permutation,
+            [](PQ &queue, Configuration config, void* data) {
+                assert(data != nullptr);
+                auto ptr = static_cast<typename PQ::value_type*>(data);
+                heapsort::sort_bulk(queue, ptr, ptr+config.first);
+            },
+            [](PQ&, Configuration config, void* data) {
+                auto ptr = static_cast<typename PQ::value_type*>(data);
+                // Check that data is sorted
+                for (size_t i = 0; i < config.first; ++i) {
+                    assert(ptr[i] == static_cast<typename PQ::value_type>(config.first - i - 1));
+                }
+                delete[] ptr;
+            }, configs, benchmarks);
+
+        common::register_benchmark("bulk heapsort random", "heapsort-bulk-rand",
+            microbenchmark<PQ>::template fill_data_random<1>,
+            [](PQ &queue, Configuration config, void* data) {
+                assert(data != nullptr);
+                auto ptr = static_cast<typename PQ::value_type*>(data);
+                heapsort::sort_bulk(queue, ptr, ptr+config.first);
+            }, microbenchmark<PQ>::clear_data, configs, benchmarks);
+
+        // bulk insert everything, but only take out the first few elements
+        common::register_benchmark("bulk push, pop top k = n/256", "bulk-top-k",
+            microbenchmark<PQ>::template fill_data_random<1>,
+            [](PQ &queue, Configuration config, void* data) {
+                assert(data != nullptr);
+                auto ptr = static_cast<typename PQ::value_type*>(data);
+                queue.push_bulk(ptr, ptr+config.first);
+                queue.pop_n(top_k(config.first), ptr);
+            },
+            [](PQ &queue, Configuration config, void* data) {
+                auto ptr = static_cast<typename PQ::value_type*>(data);
+                // Check that the top elements came out in order
+                for (size_t i = 1; i < top_k(config.first); ++i) {
+                    assert(!(ptr[i-1] < ptr[i]));
+                }
+                (void)ptr;
+                microbenchmark<PQ>::clear_data(queue, config, data);
+            }, configs, benchmarks);
     }
 };
 
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../common/benchmark.h"
+#include "../common/benchmark_util.h"
+#include "../common/contenders.h"
+
+#include "microbenchmark.h"
+
+namespace pq {
+
+/// Hold model: a queue of n elements on which n hold operations are
+/// performed, each of which takes out the top element and pushes it back with
+/// a random decrement. In a discrete event simulation (on a max-heap), that's
+/// an event which schedules a follow-up event. The top values never increase,
+/// so monotone queues like radix heaps can take part.
+template <typename PQ>
+class hold_model {
+public:
+    using Configuration = std::pair<size_t, size_t>;
+    using Benchmark = common::benchmark<PQ, Configuration>;
+    using T = typename PQ::value_type;
+
+    /// Fill the queue with values close to the largest T, and generate the
+    /// decrements. n holds can't get anywhere near the smallest T then.
+    static void* fill(PQ &queue, Configuration config, void*) {
+        std::mt19937 gen{config.second};
+        const T max = std::numeric_limits<T>::max();
+        for (size_t i = 0; i < config.first; ++i)
+            queue.push(max - static_cast<T>(gen() % (1<<24)));
+        return common::util::fill_data<T>(config.first,
+            [&gen](size_t) { return static_cast<T>(gen() % 1024); });
+    }
+
+    static void register_benchmarks(common::contender_list<Benchmark> &benchmarks) {
+        const std::vector<Configuration> configs{
+            std::make_pair(1<<16, 0xDECAF),
+            std::make_pair(1<<18, 0xBEEF),
+            std::make_pair(1<<20, 0xC0FFEE),
+        };
+
+        common::register_benchmark("hold model", "hold", hold_model::fill,
+            [](PQ &queue, Configuration config, void* ptr) {
+                T* decrements = static_cast<T*>(ptr);
+                for (size_t i = 0; i < config.first; ++i) {
+                    const T value = queue.top();
+                    queue.pop();
+                    queue.push(value - decrements[i]);
+                }
+            }, microbenchmark<PQ>::clear_data, configs, benchmarks);
+    }
+};
+
+}
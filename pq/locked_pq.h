@@ -0,0 +1,51 @@
+#pragma once
+
+#include <mutex>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "../common/contenders.h"
+#include "concurrent_priority_queue.h"
+
+namespace pq {
+
+/// std::priority_queue behind a single global mutex, as a baseline for the
+/// concurrent priority queues. Its pops are exact.
+template <typename T, typename Compare = std::less<T>>
+class locked_pq : public concurrent_priority_queue<T> {
+public:
+    locked_pq() : queue() {}
+    virtual ~locked_pq() = default;
+
+    static void register_contenders(common::contender_list<concurrent_priority_queue<T>> &list) {
+        using Factory = common::contender_factory<concurrent_priority_queue<T>>;
+        list.register_contender(Factory("std::priority_queue with global lock", "locked-priority-queue",
+            [](){ return new locked_pq<T>(); }
+        ));
+    }
+
+    void push(const T& value) override {
+        std::lock_guard<std::mutex> guard(mutex);
+        queue.push(value);
+    }
+
+    bool try_pop(T &value) override {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (queue.empty()) return false;
+        value = queue.top();
+        queue.pop();
+        return true;
+    }
+
+    size_t size() override {
+        std::lock_guard<std::mutex> guard(mutex);
+        return queue.size();
+    }
+
+protected:
+    std::priority_queue<T, std::vector<T>, Compare> queue;
+    std::mutex mutex;
+};
+
+}
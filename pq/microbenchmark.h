@@ -8,6 +8,7 @@
 #include "../common/benchmark.h"
 #include "../common/benchmark_util.h"
 #include "../common/contenders.h"
+#include "../common/latency.h"
 
 namespace pq {
 
@@ -55,25 +56,39 @@ public:
             std::make_pair(1<<16, 0xDECAF),
             std::make_pair(1<<18, 0xBEEF),
             std::make_pair(1<<20, 0xC0FFEE),
-            //std::make_pair(1<<22, 0xF005BA11),
-            //std::make_pair(1<<24, 0xBA5EBA11),
-            //std::make_pair(1<<26, 0xCA55E77E)
         };
+        register_benchmarks(benchmarks, configs);
+    }
 
+    /// Instances that are far larger than the last-level cache. Only run
+    /// them on contenders that are built for this, binary heaps take ages.
+    static void register_large_benchmarks(common::contender_list<Benchmark> &benchmarks) {
+        const std::vector<Configuration> configs{
+            std::make_pair(1<<22, 0xF005BA11),
+            std::make_pair(1<<24, 0xBA5EBA11),
+            std::make_pair(1<<26, 0xCA55E77E)
+        };
+        register_benchmarks(benchmarks, configs);
+    }
+
+    static void register_benchmarks(common::contender_list<Benchmark> &benchmarks,
+                                    const std::vector<Configuration> &configs) {
         common::register_benchmark("push", "push",
             microbenchmark::fill_data_random<1>,
             [](PQ &queue, Configuration config, void* ptr) {
                 T* data = static_cast<T*>(ptr);
+                common::latency_probe probe;
                 for (size_t i = 0; i < config.first; ++i)
                 {
-                    queue.push(data[i]);
+                    probe([&]{ queue.push(data[i]); });
                 }
             }, microbenchmark::clear_data, configs, benchmarks);
 
         common::register_benchmark("pop", "pop", microbenchmark::fill_heap_random<1>,
             [](PQ &queue, Configuration, void*) {
+                common::latency_probe probe;
                 while (queue.size() > 0)
-                    queue.pop();
+                    probe([&]{ queue.pop(); });
             }, configs, benchmarks);
 
         common::register_benchmark("push-pop-mix on full heap", "push-pop-mix",
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+#include "../common/contenders.h"
+#include "concurrent_priority_queue.h"
+#include "dary_heap.h"
+
+namespace pq {
+
+/// MultiQueue (Rihani, Sanders, Dementiev 2015): a relaxed concurrent
+/// max-queue made of C*p sequential heaps with a lock each, where p is the
+/// number of hardware threads. A push goes to a random heap that isn't
+/// locked. A pop looks at the tops of two random heaps and takes the larger
+/// one. That makes contention unlikely, and the popped elements are close to
+/// the largest one with high probability: the expected rank error is O(C*p).
+template <typename T,
+          size_t C = 2,
+          typename Compare = std::less<T>>
+class multiqueue : public concurrent_priority_queue<T> {
+    static_assert(C >= 1, "Need at least one heap per thread");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "The tops of the heaps are cached in atomics");
+public:
+    multiqueue()
+        : num_queues(C * std::max(1u, std::thread::hardware_concurrency()))
+        , queues(nullptr)
+    {
+        // Two queues at least, so that there is something to choose from
+        if (num_queues < 2) num_queues = 2;
+        void *mem = nullptr;
+        if (posix_memalign(&mem, sizeof(sub_queue), num_queues * sizeof(sub_queue)) != 0)
+            throw std::bad_alloc();
+        queues = static_cast<sub_queue*>(mem);
+        for (size_t i = 0; i < num_queues; ++i)
+            new (queues + i) sub_queue();
+    }
+
+    multiqueue(const multiqueue &other) = delete;
+    multiqueue& operator=(const multiqueue &other) = delete;
+
+    virtual ~multiqueue() {
+        for (size_t i = 0; i < num_queues; ++i)
+            queues[i].~sub_queue();
+        std::free(queues);
+    }
+
+    static void register_contenders(common::contender_list<concurrent_priority_queue<T>> &list) {
+        using Factory = common::contender_factory<concurrent_priority_queue<T>>;
+        list.register_contender(Factory("MultiQueue with 2 heaps per thread", "multiqueue-2",
+            [](){ return new multiqueue<T, 2>(); }
+        ));
+        list.register_contender(Factory("MultiQueue with 4 heaps per thread", "multiqueue-4",
+            [](){ return new multiqueue<T, 4>(); }
+        ));
+    }
+
+    void push(const T& value) override {
+        sub_queue *q;
+        do {
+            q = &queues[random() % num_queues];
+        } while (!q->try_lock());
+        q->heap.push(value);
+        q->update();
+        q->unlock();
+    }
+
+    bool try_pop(T &value) override {
+        // Give up sampling after a few tries that only found empty heaps,
+        // the queue is probably (nearly) empty then
+        int empty_samples = 0;
+        while (empty_samples < 4) {
+            sub_queue *q = better(&queues[random() % num_queues], &queues[random() % num_queues]);
+            if (q == nullptr) {
+                ++empty_samples;
+                continue;
+            }
+            if (!q->try_lock()) continue;
+            if (q->pop(value)) return true;
+        }
+        // Look at every heap before reporting an empty queue
+        for (size_t i = 0; i < num_queues; ++i) {
+            sub_queue *q = &queues[i];
+            if (q->size.load(std::memory_order_relaxed) == 0) continue;
+            q->lock();
+            if (q->pop(value)) return true;
+        }
+        return false;
+    }
+
+    size_t size() override {
+        size_t total = 0;
+        for (size_t i = 0; i < num_queues; ++i)
+            total += queues[i].size.load(std::memory_order_relaxed);
+        return total;
+    }
+
+protected:
+    struct alignas(64) sub_queue {
+        std::atomic<bool> locked;
+        // Copies of the heap's size and top element, to choose between two
+        // heaps without locking them. top is only valid if size > 0.
+        std::atomic<size_t> size;
+        std::atomic<T> top;
+        dary_heap<T, 8, Compare> heap;
+
+        sub_queue() : locked(false), size(0), top(T()), heap() {}
+
+        bool try_lock() {
+            return !locked.load(std::memory_order_relaxed) &&
+                !locked.exchange(true, std::memory_order_acquire);
+        }
+
+        void lock() {
+            while (!try_lock())
+                std::this_thread::yield();
+        }
+
+        void unlock() {
+            locked.store(false, std::memory_order_release);
+        }
+
+        void update() {
+            size.store(heap.size(), std::memory_order_relaxed);
+            if (heap.size() > 0)
+                top.store(heap.top(), std::memory_order_relaxed);
+        }
+
+        // Pop the top element and unlock, needs to be locked
+        bool pop(T &value) {
+            if (heap.size() == 0) {
+                unlock();
+                return false;
+            }
+            value = heap.top();
+            heap.pop();
+            update();
+            unlock();
+            return true;
+        }
+    };
+
+    // The heap with the larger top element, or nullptr if both look empty
+    sub_queue* better(sub_queue *a, sub_queue *b) const {
+        const bool a_empty = a->size.load(std::memory_order_relaxed) == 0,
+                   b_empty = b->size.load(std::memory_order_relaxed) == 0;
+        if (a_empty) return b_empty ? nullptr : b;
+        if (b_empty) return a;
+        return cmp(a->top.load(std::memory_order_relaxed),
+                   b->top.load(std::memory_order_relaxed)) ? b : a;
+    }
+
+    static size_t random() {
+        thread_local size_t random_state = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+        random_state ^= random_state << 13;
+        random_state ^= random_state >> 7;
+        random_state ^= random_state << 17;
+        return random_state;
+    }
+
+    size_t num_queues;
+    sub_queue *queues;
+    Compare cmp;
+};
+
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 namespace pq {
 
 template <typename T>
@@ -24,6 +26,25 @@ public:
     /// Get the number of elements in the priority queue
     virtual size_t size() = 0;
 
+    /// Add the elements [begin, end). Override this if your priority queue
+    /// can do better than pushing them one by one, e.g. by building a heap
+    /// bottom-up.
+    virtual void push_bulk(const T *begin, const T *end) {
+        for (; begin != end; ++begin)
+            push(*begin);
+    }
+
+    /// Move the top k elements to out, in the order in which they would be
+    /// popped, and delete them. Returns how many there were (at most k).
+    virtual size_t pop_n(size_t k, T *out) {
+        size_t n = 0;
+        for (; n < k && size() > 0; ++n) {
+            out[n] = top();
+            pop();
+        }
+        return n;
+    }
+
     /// Virtual destructor needed for inheritance
     virtual ~priority_queue() {}
 };
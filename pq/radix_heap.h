@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../common/contenders.h"
+#include "priority_queue.h"
+
+namespace pq {
+
+/// Radix heap (Ahuja, Mehlhorn, Orlin, Tarjan 1990) for integers, a monotone
+/// max-heap: the values that are pushed must not be larger than the last
+/// value that was returned by top() (or popped), which is checked in debug
+/// builds. That's the case in discrete event simulations and Dijkstra's
+/// algorithm, but not in general!
+///
+/// Bucket i > 0 holds the values whose key first differs from the key of the
+/// last top value in bit i-1 (counting from the least significant bit), and
+/// bucket 0 those that are equal to it. Keys are the values mapped to
+/// unsigned integers such that larger values have smaller keys. When bucket
+/// 0 runs empty, the smallest key of the next non-empty bucket becomes the
+/// new reference and the bucket's values are distributed to lower buckets.
+/// Every value only moves down, so that's at most bits moves per value.
+template <typename T>
+class radix_heap : public priority_queue<T> {
+    static_assert(std::is_integral<T>::value, "radix_heap needs integer values");
+    static_assert(sizeof(T) <= sizeof(uint64_t), "radix_heap supports up to 64-bit values");
+public:
+    radix_heap() : last(0), num_elements(0) {}
+
+    static void register_contenders(common::contender_list<priority_queue<T>> &list) {
+        using Factory = common::contender_factory<priority_queue<T>>;
+        list.register_contender(Factory("radix heap (monotone)", "radix-heap",
+            [](){ return new radix_heap<T>(); }
+        ));
+    }
+
+    /// Add an element to the priority queue by const lvalue reference
+    void push(const T& value) override {
+        const key_type k = key(value);
+        assert(k >= last && "radix_heap: pushed value is larger than the last top value");
+        buckets[bucket(k)].push_back(value);
+        ++num_elements;
+    }
+    /// Add an element to the priority queue by rvalue reference (with move)
+    void push(T&& value) override {
+        push(static_cast<const T&>(value));
+    }
+
+    /// Deletes the top element
+    void pop() override {
+        if (buckets[0].empty())
+            refill();
+        buckets[0].pop_back();
+        --num_elements;
+    }
+
+    /// Retrieves the top element
+    const T& top() override {
+        if (buckets[0].empty())
+            refill();
+        return buckets[0].back();
+    }
+
+    /// Get the number of elements in the priority queue
+    size_t size() override {
+        return num_elements;
+    }
+
+protected:
+    using key_type = typename std::make_unsigned<T>::type;
+    static constexpr size_t bits = std::numeric_limits<key_type>::digits;
+
+    // Flip the sign bit for an order-preserving map to unsigned integers,
+    // and invert that to get a max-heap
+    static key_type key(T value) {
+        const key_type sign_bit = std::is_signed<T>::value ? key_type(1) << (bits - 1) : 0;
+        return ~(static_cast<key_type>(value) ^ sign_bit);
+    }
+
+    // Index of the bucket for key k, i.e. one more than the index of the
+    // highest bit in which k differs from the last key
+    size_t bucket(key_type k) const {
+        const uint64_t diff = k ^ last;
+        return diff == 0 ? 0 : 64 - __builtin_clzll(diff);
+    }
+
+    // Make the smallest key the new reference and move its bucket down.
+    // The queue must not be empty.
+    void refill() {
+        size_t i = 1;
+        while (buckets[i].empty()) ++i;
+        std::vector<T> &source = buckets[i];
+        key_type smallest = key(source.front());
+        for (const T &value : source) {
+            const key_type k = key(value);
+            if (k < smallest) smallest = k;
+        }
+        last = smallest;
+        for (const T &value : source)
+            buckets[bucket(key(value))].push_back(value);
+        source.clear();
+    }
+
+    std::vector<T> buckets[bits + 1];
+    key_type last;
+    size_t num_elements;
+};
+
+}
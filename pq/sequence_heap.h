@@ -0,0 +1,364 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "../common/contenders.h"
+#include "priority_queue.h"
+
+namespace pq {
+
+/// Tournament tree for merging k sorted ranges. Each inner node stores the
+/// loser of the match played there and tree[0] the overall winner, so taking
+/// the winner only replays the matches on the path from its leaf to the root.
+/// The nodes hold the current element of their input, which saves an
+/// indirection per match. Before(a, b) is true if a has to be output before b.
+template <typename T, typename Before>
+class loser_tree {
+public:
+    explicit loser_tree(const Before &before) : before(before), k(0) {}
+
+    /// Add the range [begin, end) to the inputs. Call init() afterwards.
+    void add(T *begin, T *end) {
+        sources.emplace_back(begin, end);
+    }
+
+    /// Play the initial tournament
+    void init() {
+        k = 1;
+        while (k < sources.size()) k *= 2;
+        // Pad with empty inputs to get a complete tree
+        sources.resize(k, std::make_pair(nullptr, nullptr));
+        tree.resize(k);
+        tree[0] = play(1);
+    }
+
+    bool empty() const {
+        return tree[0].done;
+    }
+
+    /// Move the winner to out and replace it with the next element of its input
+    template <typename OutputIt>
+    OutputIt pop(OutputIt out) {
+        *out++ = std::move(tree[0].key);
+        node winner = next(tree[0].source);
+        for (size_t index = (winner.source + k) / 2; index > 0; index /= 2) {
+            if (wins(tree[index], winner))
+                std::swap(tree[index], winner);
+        }
+        tree[0] = std::move(winner);
+        return out;
+    }
+
+    /// Stop merging and move the elements that are still in the tree back
+    /// to their inputs
+    void finish() {
+        for (node &n : tree) {
+            if (!n.done)
+                *--sources[n.source].first = std::move(n.key);
+        }
+    }
+
+    /// How far input i has been consumed, valid after finish()
+    T* position(size_t i) const {
+        return sources[i].first;
+    }
+
+protected:
+    struct node {
+        T key;
+        size_t source;
+        bool done; // input is used up
+    };
+
+    // Take the next element of an input
+    node next(size_t source) {
+        auto &range = sources[source];
+        if (range.first == range.second)
+            return node{T(), source, true};
+        return node{std::move(*range.first++), source, false};
+    }
+
+    // Ties go to a, used up inputs lose
+    bool wins(const node &a, const node &b) const {
+        return !a.done && (b.done || !before(b.key, a.key));
+    }
+
+    // Play the subtree of index and return its winner
+    node play(size_t index) {
+        if (index >= k) return next(index - k);
+        node left = play(2 * index), right = play(2 * index + 1);
+        if (wins(left, right)) {
+            tree[index] = std::move(right);
+            return left;
+        }
+        tree[index] = std::move(left);
+        return right;
+    }
+
+    Before before;
+    size_t k;
+    std::vector<std::pair<T*, T*>> sources;
+    std::vector<node> tree;
+};
+
+
+/// Sequence heap (Sanders, "Fast Priority Queues for Cached Memory", 2000),
+/// a max-heap that mostly works on sorted sequences and thus has good
+/// locality even if it is much larger than the caches.
+///
+/// New elements go into a small insertion heap. When it is full, it is
+/// sorted and becomes a new sequence in the first group. Every group holds
+/// up to Arity sorted sequences, which are merged by a loser tree into the
+/// group's buffer on demand. When a group is full, all of its sequences are
+/// merged into a single one which moves up to the next group, so the
+/// sequences of group i are about BufferSize * Arity^i elements long.
+/// The group buffers are merged into the deletion buffer, from which the
+/// largest elements are taken. The insertion heap and all buffers hold up
+/// to BufferSize elements.
+///
+/// Invariants: all elements of the deletion buffer leave the queue before
+/// those in the groups, and the elements of a group's buffer before those in
+/// the group's sequences. A group buffer is empty only if its group has no
+/// sequences. The insertion heap is unordered with respect to the rest, so
+/// the top element is either the top of the insertion heap or the first
+/// element of the deletion buffer.
+template <typename T,
+          size_t BufferSize = 256,
+          size_t Arity = 64,
+          typename Compare = std::less<T>>
+class sequence_heap : public priority_queue<T> {
+    static_assert(BufferSize >= 1, "Buffers need to hold at least one element");
+    static_assert(Arity >= 2, "Groups need to hold at least two sequences");
+public:
+    sequence_heap() : num_elements(0), cmp(), before{cmp} {
+        insertion_heap.reserve(BufferSize);
+    }
+
+    sequence_heap(const sequence_heap &other) = delete;
+    sequence_heap& operator=(const sequence_heap &other) = delete;
+
+    virtual ~sequence_heap() {}
+
+    static void register_contenders(common::contender_list<priority_queue<T>> &list) {
+        using Factory = common::contender_factory<priority_queue<T>>;
+        list.register_contender(Factory("sequence heap m=128 k=32", "sequence-heap-128-32",
+            [](){ return new sequence_heap<T, 128, 32>(); }
+        ));
+        list.register_contender(Factory("sequence heap m=256 k=64", "sequence-heap-256-64",
+            [](){ return new sequence_heap<T, 256, 64>(); }
+        ));
+    }
+
+    /// Add an element to the priority queue by const lvalue reference
+    void push(const T& value) override {
+        push(T(value));
+    }
+    /// Add an element to the priority queue by rvalue reference (with move)
+    void push(T&& value) override {
+        insertion_heap.push_back(std::move(value));
+        std::push_heap(insertion_heap.begin(), insertion_heap.end(), cmp);
+        ++num_elements;
+        if (insertion_heap.size() == BufferSize)
+            flush_insertion_heap();
+    }
+
+    /// Deletes the top element
+    void pop() override {
+        if (top_in_insertion_heap()) {
+            std::pop_heap(insertion_heap.begin(), insertion_heap.end(), cmp);
+            insertion_heap.pop_back();
+        } else {
+            // Moved-from elements are removed when the buffer is refilled
+            ++deletion_buffer.head;
+        }
+        --num_elements;
+    }
+
+    /// Retrieves the top element
+    const T& top() override {
+        if (top_in_insertion_heap())
+            return insertion_heap.front();
+        return deletion_buffer.front();
+    }
+
+    /// Get the number of elements in the priority queue
+    size_t size() override {
+        return num_elements;
+    }
+
+protected:
+    // Whether a leaves the queue before b
+    struct leaves_before {
+        const Compare &cmp;
+        bool operator()(const T &a, const T &b) const {
+            return cmp(b, a);
+        }
+    };
+
+    // A sorted sequence that is consumed from the front. The elements are
+    // stored in the order in which they leave the queue.
+    struct sequence {
+        std::vector<T> data;
+        size_t head = 0;
+
+        bool empty() const { return head == data.size(); }
+        size_t size() const { return data.size() - head; }
+        const T& front() const { return data[head]; }
+        T* begin() { return data.data() + head; }
+        T* end() { return data.data() + data.size(); }
+
+        // Remove the elements that were consumed already
+        void compact() {
+            data.erase(data.begin(), data.begin() + head);
+            head = 0;
+        }
+    };
+
+    struct group {
+        std::vector<sequence> sequences;
+        sequence buffer;
+    };
+
+    using merger = loser_tree<T, leaves_before>;
+
+    // Refill the deletion buffer if needed and find out where the top
+    // element is. The queue must not be empty.
+    bool top_in_insertion_heap() {
+        if (deletion_buffer.empty())
+            refill_deletion_buffer();
+        return deletion_buffer.empty() ||
+            (!insertion_heap.empty() && cmp(deletion_buffer.front(), insertion_heap.front()));
+    }
+
+    // Merge the group buffers into the deletion buffer
+    void refill_deletion_buffer() {
+        deletion_buffer.data.clear();
+        deletion_buffer.head = 0;
+        // There are only a few groups, so a linear scan is fine here
+        while (deletion_buffer.data.size() < BufferSize) {
+            group *best = nullptr;
+            for (group &g : groups) {
+                if (!g.buffer.empty() &&
+                    (best == nullptr || before(g.buffer.front(), best->buffer.front())))
+                    best = &g;
+            }
+            if (best == nullptr) break;
+            deletion_buffer.data.push_back(std::move(best->buffer.data[best->buffer.head++]));
+            if (best->buffer.empty())
+                refill_group_buffer(*best);
+        }
+    }
+
+    // Merge the group's sequences into its buffer until it is full
+    void refill_group_buffer(group &g) {
+        g.buffer.compact();
+        if (g.sequences.empty()) return;
+        merger tree(before);
+        for (sequence &s : g.sequences)
+            tree.add(s.begin(), s.end());
+        tree.init();
+        auto out = std::back_inserter(g.buffer.data);
+        while (g.buffer.data.size() < BufferSize && !tree.empty())
+            out = tree.pop(out);
+        tree.finish();
+        // Advance the sequences and drop those that are used up
+        size_t kept = 0;
+        for (size_t i = 0; i < g.sequences.size(); ++i) {
+            sequence &s = g.sequences[i];
+            s.head = tree.position(i) - s.data.data();
+            if (s.empty()) continue;
+            if (kept != i) g.sequences[kept] = std::move(s);
+            ++kept;
+        }
+        g.sequences.resize(kept);
+    }
+
+    // Sort the full insertion heap and add it to the first group. To keep the
+    // invariants, it is merged with the deletion buffer and the first group
+    // buffer, which then take back the elements that leave first.
+    void flush_insertion_heap() {
+        if (groups.empty())
+            groups.emplace_back();
+        if (groups[0].sequences.size() == Arity)
+            spill(0);
+        group &first = groups[0];
+
+        // sort_heap sorts ascendingly, so the largest element ends up last
+        std::sort_heap(insertion_heap.begin(), insertion_heap.end(), cmp);
+        std::reverse(insertion_heap.begin(), insertion_heap.end());
+
+        const size_t deletion_size = deletion_buffer.size(),
+                     buffer_size = first.buffer.size();
+        std::vector<T> buffers, merged;
+        buffers.reserve(deletion_size + buffer_size);
+        std::merge(std::make_move_iterator(deletion_buffer.begin()),
+                   std::make_move_iterator(deletion_buffer.end()),
+                   std::make_move_iterator(first.buffer.begin()),
+                   std::make_move_iterator(first.buffer.end()),
+                   std::back_inserter(buffers), before);
+        merged.reserve(buffers.size() + insertion_heap.size());
+        std::merge(std::make_move_iterator(buffers.begin()),
+                   std::make_move_iterator(buffers.end()),
+                   std::make_move_iterator(insertion_heap.begin()),
+                   std::make_move_iterator(insertion_heap.end()),
+                   std::back_inserter(merged), before);
+        insertion_heap.clear();
+
+        auto it = std::make_move_iterator(merged.begin());
+        deletion_buffer.data.assign(it, it + deletion_size);
+        deletion_buffer.head = 0;
+        first.buffer.data.assign(it + deletion_size, it + deletion_size + buffer_size);
+        first.buffer.head = 0;
+        merged.erase(merged.begin(), merged.begin() + deletion_size + buffer_size);
+
+        first.sequences.emplace_back();
+        first.sequences.back().data = std::move(merged);
+        if (first.buffer.empty())
+            refill_group_buffer(first);
+    }
+
+    // Merge all sequences of a full group into one and add it to the next
+    // group, which may have to be spilled first
+    void spill(size_t index) {
+        if (groups.size() == index + 1)
+            groups.emplace_back();
+        if (groups[index + 1].sequences.size() == Arity)
+            spill(index + 1);
+        group &g = groups[index], &next = groups[index + 1];
+
+        // Merge the next group's buffer as well, as its elements need not
+        // leave before those of the new sequence
+        merger tree(before);
+        size_t total = next.buffer.size();
+        tree.add(next.buffer.begin(), next.buffer.end());
+        for (sequence &s : g.sequences) {
+            tree.add(s.begin(), s.end());
+            total += s.size();
+        }
+        tree.init();
+        sequence merged;
+        merged.data.reserve(total);
+        auto out = std::back_inserter(merged.data);
+        while (!tree.empty())
+            out = tree.pop(out);
+        g.sequences.clear();
+        next.buffer.data.clear();
+        next.buffer.head = 0;
+
+        next.sequences.push_back(std::move(merged));
+        refill_group_buffer(next);
+    }
+
+    std::vector<T> insertion_heap;
+    sequence deletion_buffer;
+    std::vector<group> groups;
+    size_t num_elements;
+    Compare cmp;
+    leaves_before before;
+};
+
+}
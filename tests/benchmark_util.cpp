@@ -0,0 +1,146 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <common/benchmark_util.h>
+
+namespace {
+// How often each key of 1..n is drawn in count draws
+std::vector<size_t> histogram(const common::key_distribution &dist, size_t n, size_t count) {
+	common::util::key_generator next(dist, n, count, 42);
+	std::vector<size_t> h(n + 1, 0);
+	size_t out_of_range = 0;
+	for (size_t i = 0; i < count; ++i) {
+		const size_t key = next();
+		if (key < 1 || key > n) {
+			++out_of_range;
+			continue;
+		}
+		h[key]++;
+	}
+	CHECK(out_of_range == 0);
+	return h;
+}
+}
+
+SCENARIO("key_generator draws keys by their distribution", "[benchmark_util]") {
+	const size_t n = 1000;
+	GIVEN("Sequential and shuffled keys") {
+		THEN("Every key is drawn once") {
+			common::util::key_generator sequential(common::key_distribution::sequential(), n, n, 42);
+			CHECK(sequential() == 1);
+			CHECK(sequential() == 2);
+			const auto h = histogram(common::key_distribution::shuffled(), n, n);
+			CHECK(std::count(h.begin() + 1, h.end(), 1) == n);
+		}
+	}
+	GIVEN("Zipf-distributed keys") {
+		const auto h = histogram(common::key_distribution::zipf(1), n, 100000);
+		THEN("The most popular key gets about 1/H_n of the draws") {
+			double harmonic = 0;
+			for (size_t r = 1; r <= n; ++r) harmonic += 1.0 / r;
+			const double top = *std::max_element(h.begin(), h.end()) / 100000.0;
+			CHECK(top == Approx(1 / harmonic).epsilon(0.05));
+		}
+		THEN("The popular keys aren't neighbours") {
+			std::vector<size_t> keys(n);
+			for (size_t k = 0; k < n; ++k) keys[k] = k + 1;
+			std::sort(keys.begin(), keys.end(), [&h](size_t a, size_t b) { return h[a] > h[b]; });
+			const size_t spread = *std::max_element(keys.begin(), keys.begin() + 10) -
+				*std::min_element(keys.begin(), keys.begin() + 10);
+			CHECK(spread > 10);
+		}
+	}
+	GIVEN("A hotspot of 10% of the keys with 90% of the accesses") {
+		const auto h = histogram(common::key_distribution::hotspot(0.1, 0.9), n, 100000);
+		THEN("The 100 most popular keys get about 90% of the accesses") {
+			std::vector<size_t> counts(h.begin() + 1, h.end());
+			std::sort(counts.rbegin(), counts.rend());
+			size_t hot = 0;
+			for (size_t i = 0; i < 100; ++i) hot += counts[i];
+			const double fraction = hot / 100000.0;
+			CHECK(fraction == Approx(0.9).epsilon(0.02));
+		}
+	}
+	GIVEN("A sliding window of 1% of the keys") {
+		common::util::key_generator next(common::key_distribution::sliding_window(0.01), n, 10000, 42);
+		THEN("The keys move from the first to the last ones") {
+			for (size_t i = 0; i < 100; ++i) {
+				CHECK(next() <= 20);
+			}
+			for (size_t i = 100; i < 9900; ++i) next();
+			for (size_t i = 9900; i < 10000; ++i) {
+				CHECK(next() >= 980);
+			}
+		}
+	}
+}
+
+SCENARIO("zipf_sampler draws ranks like the cumulative weights do", "[benchmark_util]") {
+	const size_t n = 1000, count = 200000;
+	for (double s : {0.5, 0.99, 1.0, 1.5}) {
+		common::util::zipf_sampler sample(n, s);
+		std::mt19937 gen(42);
+		std::vector<size_t> h(n + 1, 0);
+		size_t out_of_range = 0;
+		for (size_t i = 0; i < count; ++i) {
+			const size_t rank = sample(gen);
+			if (rank < 1 || rank > n) ++out_of_range;
+			else h[rank]++;
+		}
+		CHECK(out_of_range == 0);
+		double weights = 0;
+		for (size_t r = 1; r <= n; ++r) weights += std::pow(r, -s);
+		for (size_t r : {1, 2, 10}) {
+			const double expected = std::pow(r, -s) / weights, observed = h[r] / static_cast<double>(count);
+			CHECK(observed == Approx(expected).epsilon(0.05));
+		}
+	}
+}
+
+SCENARIO("key_configuration describes its distribution", "[benchmark_util]") {
+	std::ostringstream plain, zipf;
+	plain << common::key_configuration(1024, 42);
+	zipf << common::key_configuration(1024, 42, common::key_distribution::zipf(0.99));
+	CHECK(plain.str() == "(1024, 42)");
+	CHECK(zipf.str() == "(1024, 42, zipf-0.99)");
+}
+
+SCENARIO("Columns for the relational benchmarks have the requested shape", "[benchmark_util]") {
+	GIVEN("Probe keys for a table on 1..1000 with a match rate of 30%") {
+		const size_t n = 1000, count = 100000;
+		int *keys = static_cast<int*>(common::util::fill_probe_keys<int>(count, n, 0.3, 42));
+		THEN("About 30% of them are in the table, the others in n+1..2n") {
+			size_t matches = 0, out_of_range = 0;
+			for (size_t i = 0; i < count; ++i) {
+				if (keys[i] >= 1 && keys[i] <= static_cast<int>(n)) ++matches;
+				else if (keys[i] <= static_cast<int>(n) || keys[i] > static_cast<int>(2 * n)) ++out_of_range;
+			}
+			CHECK(out_of_range == 0);
+			const double fraction = matches / static_cast<double>(count);
+			CHECK(fraction == Approx(0.3).epsilon(0.05));
+		}
+		common::util::delete_data<int>(keys);
+	}
+	GIVEN("Uniform values from 0..99") {
+		int *values = static_cast<int*>(common::util::fill_data_uniform<int>(10000, 99, 42));
+		const auto range = std::minmax_element(values, values + 10000);
+		CHECK(*range.first == 0);
+		CHECK(*range.second == 99);
+		common::util::delete_data<int>(values);
+	}
+	GIVEN("The configurations of a group-by and a join") {
+		std::ostringstream group_by, join, result;
+		group_by << common::relational_configuration::group_by(4096, 16, 42);
+		const auto config = common::relational_configuration::hash_join(1024, 4096, 0.5, 42);
+		join << config;
+		config.result(result);
+		CHECK(group_by.str() == "(4096 rows, 16 groups, 42)");
+		CHECK(join.str() == "(1024 build, 4096 probe, 0.5 matching, 42)");
+		CHECK(result.str() == " rows=4096 keys=1024 match_rate=0.5 seed=42");
+	}
+}
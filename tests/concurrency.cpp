@@ -0,0 +1,43 @@
+#include "catch.hpp"
+
+#include <atomic>
+#include <vector>
+
+#include <common/concurrency.h>
+
+SCENARIO("thread_pool runs a function on every thread", "[concurrency]") {
+	GIVEN("A pool of four threads") {
+		common::util::thread_pool pool(4);
+		CHECK(pool.size() == 4);
+
+		WHEN("We run functions on it several times") {
+			std::vector<std::atomic<int>> calls(4);
+			for (auto &c : calls) c = 0;
+			for (int run = 0; run < 100; ++run) {
+				pool.run([&](size_t thread) { ++calls[thread]; });
+			}
+			THEN("Every thread ran every function exactly once") {
+				for (auto &c : calls)
+					CHECK(c.load() == 100);
+			}
+		}
+	}
+
+	GIVEN("The pool of run_parallel") {
+		WHEN("It was started for a number of threads") {
+			common::util::thread_pool &pool = common::util::start_threads(3);
+			THEN("run_parallel reuses it for that number") {
+				CHECK(&common::util::start_threads(3) == &pool);
+				std::atomic<size_t> sum{0};
+				common::util::run_parallel(3, [&](size_t thread) { sum += thread + 1; });
+				CHECK(sum.load() == 6u);
+			}
+			AND_THEN("It is replaced for other numbers") {
+				CHECK(common::util::start_threads(2).size() == 2);
+				std::atomic<size_t> sum{0};
+				common::util::run_parallel(1, [&](size_t thread) { sum += thread + 1; });
+				CHECK(sum.load() == 1u);
+			}
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#include "catch.hpp"
+#include "hashtable_reference.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <hashtable/concurrent_cuckoo.h>
+
+SCENARIO("concurrent_cuckoo's basic functions work", "[hashtable]") {
+	GIVEN("A concurrent_cuckoo table") {
+		hashtable::concurrent_cuckoo<int, int> m;
+		const int n = 10000;
+		for (int i = 0; i < n; ++i) {
+			CHECK(m.insert(i, i));
+		}
+
+		WHEN("We ask for the elements") {
+			THEN("Their values are correct") {
+				CHECK(m.size() == n);
+				for (int i = 0; i < n; ++i) {
+					REQUIRE(m.find(i) == just<int>(i));
+				}
+				CHECK(m.find(n) == nothing<int>());
+			}
+		}
+
+		WHEN("We insert existing keys again") {
+			THEN("Their values are overwritten") {
+				CHECK_FALSE(m.insert(0, 42));
+				CHECK(m.find(0) == just<int>(42));
+				CHECK(m.size() == n);
+			}
+		}
+
+		WHEN("We delete half the elements") {
+			for (int i = 0; i < n; i += 2) {
+				CHECK(m.erase(i) == 1);
+			}
+			THEN("Only the others are found") {
+				CHECK(m.size() == n/2);
+				CHECK(m.find(0) == nothing<int>());
+				CHECK(m.find(1) == just<int>(1));
+			}
+		}
+	}
+}
+
+SCENARIO("concurrent_cuckoo agrees with std::unordered_map", "[hashtable]") {
+	GIVEN("Random operations with many deletions") {
+		THEN("4-way buckets agree") {
+			hashtable::concurrent_cuckoo<int, int, 4> m;
+			check_against_reference(m, 200000, 5000, 42);
+		}
+		AND_THEN("8-way buckets agree") {
+			hashtable::concurrent_cuckoo<int, int, 8> m;
+			check_against_reference(m, 200000, 5000, 43);
+		}
+	}
+}
+
+SCENARIO("concurrent_cuckoo works with multiple threads", "[hashtable]") {
+	GIVEN("Four threads inserting disjoint key ranges, erasing every other key") {
+		hashtable::concurrent_cuckoo<int, int> m;
+		const int threads = 4, per_thread = 20000;
+		std::atomic<int> failures{0};
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; ++t) {
+			workers.emplace_back([&m, &failures, t]() {
+				for (int i = t * per_thread; i < (t + 1) * per_thread; ++i) {
+					if (!m.insert(i, -i)) ++failures;
+				}
+				for (int i = t * per_thread; i < (t + 1) * per_thread; i += 2) {
+					if (m.erase(i) != 1) ++failures;
+				}
+			});
+		}
+		for (auto &worker : workers)
+			worker.join();
+
+		THEN("All operations succeeded and the remaining keys are found") {
+			CHECK(failures == 0);
+			CHECK(m.size() == threads * per_thread / 2);
+			for (int i = 0; i < threads * per_thread; ++i) {
+				REQUIRE(m.find(i) == ((i % 2 == 0) ? nothing<int>() : just<int>(-i)));
+			}
+		}
+	}
+}
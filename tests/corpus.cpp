@@ -0,0 +1,106 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <common/corpus.h>
+#include <hashtable/swiss_table.h>
+#include <hashtable/unordered_map.h>
+#include <hashtable/wordcount.h>
+
+SCENARIO("Synthetic corpora are deterministic Zipf-distributed texts", "[corpus]") {
+	GIVEN("The words of the vocabulary") {
+		CHECK(common::util::corpus_word(1) == "a");
+		CHECK(common::util::corpus_word(26) == "z");
+		CHECK(common::util::corpus_word(27) == "aa");
+		CHECK(common::util::corpus_word(26 * 27 + 1) == "aaa");
+		for (size_t k : {1, 26, 27, 702, 703, 20000000})
+			CHECK(common::util::corpus_word_rank(common::util::corpus_word(k)) == k);
+		CHECK(common::util::corpus_word_rank("Als") == 0);
+	}
+	GIVEN("A synthetic text") {
+		const std::string text = common::util::generate_corpus(1000, 1, 100000, 42);
+		THEN("It has the number of tokens and the vocabulary asked for") {
+			std::istringstream in(text);
+			std::string word;
+			size_t tokens = 0, most_frequent = 0;
+			std::unordered_set<std::string> distinct;
+			while (in >> word) {
+				++tokens;
+				if (word == "a") ++most_frequent;
+				distinct.insert(word);
+			}
+			CHECK(tokens == 100000);
+			CHECK(distinct.size() <= 1000);
+			CHECK(distinct.size() > 900);
+			// 1/H_1000 of the tokens
+			const double fraction = most_frequent / 100000.0;
+			CHECK(fraction == Approx(0.1336).epsilon(0.05));
+		}
+		THEN("The same parameters give the same text") {
+			CHECK(common::util::generate_corpus(1000, 1, 100000, 42) == text);
+			CHECK(common::util::generate_corpus(1000, 1, 100000, 43) != text);
+		}
+	}
+}
+
+SCENARIO("corpus_configuration describes and loads texts", "[corpus]") {
+	const auto synthetic = common::corpus_configuration::synthetic(1000, 0.8, 5000);
+	std::ostringstream s, result;
+	s << synthetic;
+	synthetic.result(result);
+	CHECK(s.str() == "(synthetic, 1000 words, zipf-0.8, 5000 tokens, 42)");
+	CHECK(result.str() == " corpus=synthetic vocabulary=1000 zipf=0.8 tokens=5000 seed=42");
+	CHECK(common::corpus_configuration::file("Kafka_Verwandl").filename() == "data/wordcount_Kafka_Verwandl.txt");
+
+	THEN("The text is generated once") {
+		const common::corpus_text &text = common::corpus_text::get(synthetic);
+		CHECK(&common::corpus_text::get(synthetic) == &text);
+		size_t tokens = 0;
+		text.for_each_token([&tokens](common::string_view) { ++tokens; });
+		CHECK(tokens == 5000);
+	}
+	THEN("A missing file throws") {
+		CHECK_THROWS_AS(common::corpus_text::get(common::corpus_configuration::file("missing")),
+		                const std::invalid_argument &);
+	}
+}
+
+SCENARIO("wordcount finds the most frequent words", "[corpus]") {
+	using HashTable = hashtable::hashtable<std::string, int>;
+	using wordcount = hashtable::wordcount<HashTable>;
+	const auto config = common::corpus_configuration::synthetic(1000, 0.8, 20000);
+	std::vector<std::string> &words = wordcount::words(config);
+
+	// Counts of all words, most frequent first, ties broken by the larger word
+	std::map<std::string, int> counts;
+	for (const std::string &word : words)
+		++counts[word];
+	std::vector<std::pair<int, std::string>> expected;
+	for (auto &entry : counts)
+		expected.emplace_back(entry.second, entry.first);
+	std::sort(expected.begin(), expected.end(), std::greater<std::pair<int, std::string>>());
+
+	GIVEN("The words counted by an unordered_map and a Swiss table") {
+		hashtable::unordered_map<std::string, int> node_based;
+		hashtable::swiss_table<std::string, int> dense;
+		for (HashTable *map : {static_cast<HashTable*>(&node_based), static_cast<HashTable*>(&dense)}) {
+			wordcount::count(*map, words.begin(), words.end());
+			REQUIRE(map->size() == counts.size());
+
+			const auto top = wordcount::top_words(*map, 10);
+			const std::vector<std::pair<int, std::string>> first(expected.begin(), expected.begin() + 10);
+			CHECK(top == first);
+			const auto all = wordcount::top_words(*map, counts.size() + 5);
+			CHECK(all == expected);
+			CHECK(wordcount::top_words(*map, 0).empty());
+		}
+	}
+	wordcount::clear_cache();
+}
@@ -0,0 +1,85 @@
+#include "catch.hpp"
+#include "hashtable_reference.h"
+
+#include <hashtable/cuckoo_pages.h>
+
+SCENARIO("cuckoo_pages's basic functions work", "[hashtable]") {
+	GIVEN("A cuckoo_pages table") {
+		hashtable::cuckoo_pages<int, int> m;
+		const int n = 10000;
+		for (int i = 0; i < n; ++i) {
+			m[i] = i;
+		}
+
+		WHEN("We ask for the elements") {
+			THEN("Their values are correct") {
+				CHECK(m.size() == n);
+				for (int i = 0; i < n; ++i) {
+					REQUIRE(m.find(i) == just<int>(i));
+				}
+				CHECK(m.find(n) == nothing<int>());
+			}
+			AND_THEN("The table is well-filled") {
+				CHECK(m.load_factor() > 0.4);
+				CHECK(m.stashed() <= 4);
+			}
+		}
+
+		WHEN("We delete half the elements") {
+			for (int i = 0; i < n; i += 2) {
+				CHECK(m.erase(i) == 1);
+			}
+			THEN("Only the others are found") {
+				CHECK(m.size() == n/2);
+				CHECK(m.find(0) == nothing<int>());
+				CHECK(m.find(1) == just<int>(1));
+			}
+		}
+
+		WHEN("We delete all elements") {
+			CHECK(m.overflowed() > 0);
+			for (int i = 0; i < n; ++i) {
+				CHECK(m.erase(i) == 1);
+			}
+			THEN("No page counts overflowed elements any more") {
+				CHECK(m.size() == 0);
+				CHECK(m.overflowed() == 0);
+			}
+		}
+	}
+
+	GIVEN("A cuckoo_pages table with string keys") {
+		hashtable::cuckoo_pages<std::string, int> m;
+		for (int i = 0; i < 1000; ++i) {
+			m["key" + std::to_string(i)] = i;
+		}
+		THEN("All keys are found") {
+			CHECK(m.size() == 1000);
+			CHECK(m.find("key0") == just<int>(0));
+			CHECK(m.find("key999") == just<int>(999));
+			CHECK(m.find("key1000") == nothing<int>());
+		}
+	}
+}
+
+SCENARIO("cuckoo_pages agrees with std::unordered_map", "[hashtable]") {
+	GIVEN("Random operations with many deletions") {
+		THEN("Two hash functions, one cache line, stash agree") {
+			hashtable::cuckoo_pages<int, int, 2, 64, 4> m;
+			check_against_reference(m, 200000, 5000, 42);
+		}
+		AND_THEN("Three hash functions, two cache lines, no stash agree") {
+			hashtable::cuckoo_pages<int, int, 3, 128, 0> m;
+			check_against_reference(m, 200000, 5000, 43);
+		}
+	}
+}
+
+SCENARIO("cuckoo_pages's batch operations work", "[hashtable]") {
+	GIVEN("Batches of random keys") {
+		THEN("Batched inserts and lookups agree with std::unordered_map") {
+			hashtable::cuckoo_pages<int, int> m;
+			check_batches(m, 20000, 44);
+		}
+	}
+}
@@ -0,0 +1,162 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <pq/dary_heap.h>
+
+template <typename T, int Arity, typename Generator>
+static void check_against_std_pq(size_t steps, size_t seed, Generator &&generate) {
+	pq::dary_heap<T, Arity> heap;
+	std::priority_queue<T> reference;
+	std::mt19937 gen(seed);
+	for (size_t i = 0; i < steps; ++i) {
+		// more pushes than pops in the first half, the other way round after
+		const bool push = reference.empty() || (gen() % 100) < (i < steps / 2 ? 60u : 40u);
+		if (push) {
+			const T value = generate(gen);
+			heap.push(value);
+			reference.push(value);
+		} else {
+			REQUIRE(heap.top() == reference.top());
+			heap.pop();
+			reference.pop();
+		}
+		REQUIRE(heap.size() == reference.size());
+	}
+	while (!reference.empty()) {
+		REQUIRE(heap.top() == reference.top());
+		heap.pop();
+		reference.pop();
+	}
+	CHECK(heap.size() == 0);
+}
+
+SCENARIO("dary_heap behaves like std::priority_queue", "[pq]") {
+	auto random_int = [](std::mt19937 &gen) { return static_cast<int>(gen() % 1000); };
+	GIVEN("Random pushes and pops of ints with many duplicates") {
+		THEN("The binary heap agrees") {
+			check_against_std_pq<int, 2>(100000, 42, random_int);
+		}
+		AND_THEN("The 4-ary heap agrees") {
+			check_against_std_pq<int, 4>(100000, 43, random_int);
+		}
+		AND_THEN("The 8-ary heap agrees") {
+			check_against_std_pq<int, 8>(100000, 44, random_int);
+		}
+		AND_THEN("The 16-ary heap agrees") {
+			check_against_std_pq<int, 16>(100000, 45, random_int);
+		}
+	}
+
+	GIVEN("Random pushes and pops of strings") {
+		THEN("The 3-ary heap agrees") {
+			check_against_std_pq<std::string, 3>(20000, 46, [](std::mt19937 &gen) {
+				return "value " + std::to_string(gen() % 5000);
+			});
+		}
+	}
+
+	GIVEN("Random pushes and pops of strings too long for the small string optimization") {
+		THEN("The 4-ary heap agrees and frees all of them") {
+			check_against_std_pq<std::string, 4>(20000, 50, [](std::mt19937 &gen) {
+				return "a value that has to live on the heap " + std::to_string(gen() % 5000);
+			});
+		}
+	}
+
+	GIVEN("A heap of ints") {
+		pq::dary_heap<int, 16> heap;
+		for (int i = 0; i < 1000; ++i) {
+			heap.push(i);
+		}
+		THEN("Popping it yields them in descending order") {
+			for (int i = 999; i >= 0; --i) {
+				REQUIRE(heap.top() == i);
+				heap.pop();
+			}
+		}
+	}
+}
+
+template <typename T, int Arity, typename Generator>
+static void check_bulk_against_std_pq(size_t rounds, size_t seed, Generator &&generate) {
+	pq::dary_heap<T, Arity> heap;
+	std::priority_queue<T> reference;
+	std::mt19937 gen(seed);
+	std::vector<T> values, popped;
+	for (size_t round = 0; round < rounds; ++round) {
+		// batches both smaller and larger than the heap, to get both the
+		// sift-up and the rebuild
+		values.clear();
+		const size_t count = gen() % (2 * reference.size() + 100);
+		for (size_t i = 0; i < count; ++i) {
+			values.push_back(generate(gen));
+			reference.push(values.back());
+		}
+		heap.push_bulk(values.data(), values.data() + values.size());
+		REQUIRE(heap.size() == reference.size());
+		REQUIRE(heap.top() == reference.top());
+
+		// sometimes more than there are
+		const size_t k = gen() % (reference.size() + 10);
+		popped.resize(k);
+		const size_t n = heap.pop_n(k, popped.data());
+		REQUIRE(n == std::min(k, reference.size()));
+		for (size_t i = 0; i < n; ++i) {
+			REQUIRE(popped[i] == reference.top());
+			reference.pop();
+		}
+		REQUIRE(heap.size() == reference.size());
+	}
+	while (!reference.empty()) {
+		REQUIRE(heap.top() == reference.top());
+		heap.pop();
+		reference.pop();
+	}
+	CHECK(heap.size() == 0);
+}
+
+SCENARIO("dary_heap's bulk operations behave like std::priority_queue", "[pq]") {
+	auto random_int = [](std::mt19937 &gen) { return static_cast<int>(gen() % 1000); };
+	GIVEN("Random bulk pushes and pops of ints") {
+		THEN("The binary heap agrees") {
+			check_bulk_against_std_pq<int, 2>(200, 47, random_int);
+		}
+		AND_THEN("The 8-ary heap agrees") {
+			check_bulk_against_std_pq<int, 8>(200, 48, random_int);
+		}
+	}
+
+	GIVEN("Random bulk pushes and pops of strings") {
+		THEN("The 3-ary heap agrees") {
+			check_bulk_against_std_pq<std::string, 3>(100, 49, [](std::mt19937 &gen) {
+				return "value " + std::to_string(gen() % 5000);
+			});
+		}
+		AND_THEN("The 4-ary heap agrees for strings too long for the small string optimization") {
+			check_bulk_against_std_pq<std::string, 4>(100, 51, [](std::mt19937 &gen) {
+				return "a value that has to live on the heap " + std::to_string(gen() % 5000);
+			});
+		}
+	}
+
+	GIVEN("A permutation pushed in bulk") {
+		pq::dary_heap<int, 4> heap;
+		std::vector<int> values(1000);
+		for (int i = 0; i < 1000; ++i) {
+			values[i] = (i * 7919) % 1000;
+		}
+		heap.push_bulk(values.data(), values.data() + values.size());
+		THEN("Taking all of them out at once yields them in descending order") {
+			REQUIRE(heap.pop_n(values.size(), values.data()) == values.size());
+			for (int i = 0; i < 1000; ++i) {
+				REQUIRE(values[i] == 999 - i);
+			}
+			CHECK(heap.size() == 0);
+		}
+	}
+}
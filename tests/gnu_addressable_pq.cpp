@@ -0,0 +1,120 @@
+#include "catch.hpp"
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <pq/dijkstra.h>
+#include <pq/gnu_pq.h>
+
+using PQ = pq::addressable_priority_queue<uint64_t, uint32_t>;
+
+// Textbook Dijkstra on a std::set as reference
+static std::vector<uint64_t> reference_distances(const pq::graph &g, uint32_t source) {
+	std::vector<uint64_t> dist(g.num_nodes(), pq::dijkstra<PQ>::unreached);
+	std::set<std::pair<uint64_t, uint32_t>> queue;
+	dist[source] = 0;
+	queue.emplace(0, source);
+	while (!queue.empty()) {
+		const uint32_t u = queue.begin()->second;
+		queue.erase(queue.begin());
+		for (uint32_t e = g.offsets[u]; e < g.offsets[u+1]; ++e) {
+			const uint32_t v = g.targets[e];
+			if (dist[u] + g.weights[e] < dist[v]) {
+				queue.erase(std::make_pair(dist[v], v));
+				dist[v] = dist[u] + g.weights[e];
+				queue.emplace(dist[v], v);
+			}
+		}
+	}
+	return dist;
+}
+
+template <typename Tag>
+static void check_against_multimap(size_t steps, size_t seed) {
+	pq::gnu_addressable_pq<uint64_t, uint32_t, Tag> queue;
+	std::multimap<uint64_t, PQ::handle> reference;
+	std::map<PQ::handle, uint64_t> keys;
+	std::mt19937 gen(seed);
+	for (size_t i = 0; i < steps; ++i) {
+		const int op = gen() % 10;
+		if (op < 4 || keys.empty()) {
+			const uint64_t key = gen() % 100000;
+			const PQ::handle h = queue.push(key, i);
+			REQUIRE(keys.count(h) == 0);
+			keys[h] = key;
+			reference.emplace(key, h);
+			REQUIRE(queue.value(h) == i);
+		} else {
+			// some element that's in the queue
+			auto it = keys.lower_bound(gen() % (keys.rbegin()->first + 1));
+			if (it == keys.end()) it = keys.begin();
+			const PQ::handle h = it->first;
+			auto range = reference.equal_range(it->second);
+			while (range.first->second != h) ++range.first;
+			reference.erase(range.first);
+			if (op < 7) {
+				const uint64_t key = it->second / 2;
+				queue.decrease_key(h, key);
+				REQUIRE(queue.key(h) == key);
+				it->second = key;
+				reference.emplace(key, h);
+			} else if (op < 9) {
+				queue.erase(h);
+				keys.erase(it);
+			} else {
+				// pop instead, put the element back
+				reference.emplace(it->second, h);
+				const PQ::handle top = queue.top_handle();
+				REQUIRE(queue.key(top) == reference.begin()->first);
+				auto pos = reference.equal_range(queue.key(top)).first;
+				while (pos->second != top) ++pos;
+				reference.erase(pos);
+				keys.erase(top);
+				queue.pop();
+			}
+		}
+		REQUIRE(queue.size() == reference.size());
+		if (!reference.empty()) {
+			REQUIRE(queue.key(queue.top_handle()) == reference.begin()->first);
+		}
+	}
+}
+
+SCENARIO("gnu_addressable_pq behaves like a multimap", "[pq]") {
+	GIVEN("Random pushes, decrease_keys, erases and pops") {
+		THEN("The pairing heap agrees") {
+			check_against_multimap<__gnu_pbds::pairing_heap_tag>(20000, 42);
+		}
+		AND_THEN("The thin heap agrees") {
+			check_against_multimap<__gnu_pbds::thin_heap_tag>(20000, 43);
+		}
+	}
+}
+
+SCENARIO("Dijkstra with an addressable queue finds shortest paths", "[pq]") {
+	pq::gnu_addressable_pq<uint64_t, uint32_t> queue;
+	std::vector<uint64_t> distances;
+
+	GIVEN("A grid graph") {
+		const pq::graph g = pq::graph::grid(50, 42);
+		CHECK(g.num_nodes() == 2500);
+		CHECK(g.num_edges() == 4 * 2500 - 4 * 50);
+		THEN("The distances are those of the reference") {
+			pq::dijkstra<PQ>::shortest_paths(queue, g, 0, distances);
+			CHECK(queue.empty());
+			CHECK(distances == reference_distances(g, 0));
+		}
+	}
+
+	GIVEN("A random graph") {
+		const pq::graph g = pq::graph::random(5000, 3, 43);
+		THEN("The distances are those of the reference") {
+			pq::dijkstra<PQ>::shortest_paths(queue, g, 17, distances);
+			CHECK(distances == reference_distances(g, 17));
+		}
+	}
+}
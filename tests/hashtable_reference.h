@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "catch.hpp"
+
+#include <common/maybe.h>
+#include <hashtable/hashtable.h>
+
+// Check that for_each visits exactly the elements of ref, each once, both
+// directly and through the virtual interface, and that it can modify values
+template <typename HashTable>
+void check_for_each(HashTable &m, const std::unordered_map<int, int> &ref) {
+	std::vector<std::pair<int, int>> expected(ref.begin(), ref.end()), visited;
+	m.for_each([&visited](const int &key, int &value) {
+		visited.emplace_back(key, value);
+	});
+	std::sort(expected.begin(), expected.end());
+	std::sort(visited.begin(), visited.end());
+	REQUIRE(visited == expected);
+
+	hashtable::hashtable<int, int> &base = m;
+	base.for_each([](const int &, int &value) { value = -value; });
+	for (auto &entry : ref)
+		REQUIRE(m.find(entry.first) == common::monad::just<int>(-entry.second));
+}
+
+// Run a random sequence of inserts, finds and erases on a hash table and on
+// std::unordered_map and check that they agree. Keys are drawn from a small
+// universe so that erased keys are re-inserted a lot.
+template <typename HashTable>
+void check_against_reference(HashTable &m, size_t ops, int universe, size_t seed) {
+	std::unordered_map<int, int> ref;
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<int> key_dist(1, universe), op_dist(0, 9);
+	for (size_t i = 0; i < ops; ++i) {
+		const int key = key_dist(gen);
+		const int op = op_dist(gen);
+		if (op < 4) {
+			m[key] = static_cast<int>(i);
+			ref[key] = static_cast<int>(i);
+		} else if (op < 7) {
+			REQUIRE(m.erase(key) == ref.erase(key));
+		} else {
+			auto it = ref.find(key);
+			if (it == ref.end())
+				REQUIRE(m.find(key) == common::monad::nothing<int>());
+			else
+				REQUIRE(m.find(key) == common::monad::just<int>(it->second));
+		}
+	}
+	REQUIRE(m.size() == ref.size());
+	for (auto &entry : ref)
+		REQUIRE(m.find(entry.first) == common::monad::just<int>(entry.second));
+	check_for_each(m, ref);
+}
+
+// Insert random keys in batches, some of them several times, and look them
+// up in batches along with keys that don't exist
+template <typename HashTable>
+void check_batches(HashTable &m, size_t n, size_t seed) {
+	std::unordered_map<int, int> ref;
+	std::mt19937 gen(seed);
+	std::uniform_int_distribution<int> key_dist(1, static_cast<int>(n));
+	std::vector<int> keys(n), values(n);
+	for (size_t i = 0; i < n; ++i) {
+		keys[i] = key_dist(gen);
+		values[i] = static_cast<int>(i);
+		ref[keys[i]] = values[i];
+	}
+	for (size_t i = 0; i < n; i += 100) {
+		const size_t batch = std::min<size_t>(100, n - i);
+		m.insert_batch(keys.data() + i, values.data() + i, batch);
+	}
+	REQUIRE(m.size() == ref.size());
+
+	std::vector<int> queries(2 * n);
+	for (size_t i = 0; i < queries.size(); ++i)
+		queries[i] = static_cast<int>(i + 1);
+	std::vector<common::monad::maybe<int>> results(queries.size());
+	m.find_batch(queries.data(), queries.size(), results.data());
+	for (size_t i = 0; i < queries.size(); ++i) {
+		auto it = ref.find(queries[i]);
+		if (it == ref.end())
+			REQUIRE(results[i] == common::monad::nothing<int>());
+		else
+			REQUIRE(results[i] == common::monad::just<int>(it->second));
+	}
+}
@@ -0,0 +1,62 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <common/histogram.h>
+
+SCENARIO("log_linear_histogram's percentiles are accurate", "[histogram]") {
+	GIVEN("A histogram of small values") {
+		common::log_linear_histogram<> h;
+		for (uint64_t i = 1; i <= 100; ++i) {
+			h.record(i);
+		}
+		THEN("Small values are exact") {
+			CHECK(h.count() == 100);
+			CHECK(h.min() == 1);
+			CHECK(h.max() == 100);
+			CHECK(h.percentile(0.5) == 50);
+			CHECK(h.percentile(0.99) == 99);
+			CHECK(h.percentile(1) == 100);
+		}
+		WHEN("We clear it") {
+			h.clear();
+			THEN("It is empty") {
+				CHECK(h.count() == 0);
+				CHECK(h.percentile(0.5) == 0);
+			}
+		}
+	}
+
+	GIVEN("A histogram of values over a wide range") {
+		common::log_linear_histogram<7> h, first, second;
+		std::mt19937_64 gen(42);
+		std::vector<uint64_t> values;
+		for (int i = 0; i < 100000; ++i) {
+			// log-uniform between 1 and 2^40
+			const uint64_t value = gen() >> (24 + gen() % 40);
+			values.push_back(value);
+			h.record(value);
+			(i % 2 == 0 ? first : second).record(value);
+		}
+		std::sort(values.begin(), values.end());
+
+		THEN("Percentiles are within the relative error bound") {
+			for (double p : {0.1, 0.5, 0.9, 0.99, 0.999}) {
+				const double exact = values[static_cast<size_t>(p * values.size()) - 1];
+				const double approx = h.percentile(p);
+				REQUIRE(approx >= exact * (1 - 1.0/128));
+				REQUIRE(approx <= exact * (1 + 1.0/128) + 1);
+			}
+			CHECK(h.percentile(1) == values.back());
+		}
+		AND_THEN("Merged halves are the same histogram") {
+			first.merge(second);
+			CHECK(first.count() == h.count());
+			for (double p : {0.1, 0.5, 0.9, 0.99, 0.999, 1.0}) {
+				REQUIRE(first.percentile(p) == h.percentile(p));
+			}
+		}
+	}
+}
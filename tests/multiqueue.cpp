@@ -0,0 +1,71 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include <pq/multiqueue.h>
+
+SCENARIO("multiqueue pops what was pushed", "[pq]") {
+	GIVEN("A MultiQueue filled by one thread") {
+		pq::multiqueue<int> queue;
+		const int n = 10000;
+		for (int i = 0; i < n; ++i) {
+			queue.push(i);
+		}
+		CHECK(queue.size() == n);
+
+		THEN("Draining it yields every element once, roughly in descending order") {
+			std::vector<int> popped;
+			int value;
+			while (queue.try_pop(value)) {
+				popped.push_back(value);
+			}
+			CHECK(queue.size() == 0);
+			REQUIRE(popped.size() == n);
+			// The first pops come from the top
+			CHECK(*std::min_element(popped.begin(), popped.begin() + 10) >= n / 2);
+			std::sort(popped.begin(), popped.end());
+			for (int i = 0; i < n; ++i) {
+				REQUIRE(popped[i] == i);
+			}
+		}
+	}
+
+	GIVEN("Four threads that push and pop concurrently") {
+		pq::multiqueue<int, 4> queue;
+		const int threads = 4, per_thread = 20000;
+		std::vector<std::vector<int>> popped(threads);
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; ++t) {
+			workers.emplace_back([&queue, &popped, t]() {
+				int value;
+				for (int i = 0; i < per_thread; ++i) {
+					queue.push(t * per_thread + i);
+					if (i % 2 == 0 && queue.try_pop(value))
+						popped[t].push_back(value);
+				}
+			});
+		}
+		for (auto &worker : workers) {
+			worker.join();
+		}
+
+		THEN("The pops and the remaining elements are exactly what was pushed") {
+			std::vector<int> all;
+			for (const auto &p : popped) {
+				all.insert(all.end(), p.begin(), p.end());
+			}
+			CHECK(queue.size() == threads * per_thread - all.size());
+			int value;
+			while (queue.try_pop(value)) {
+				all.push_back(value);
+			}
+			REQUIRE(all.size() == threads * per_thread);
+			std::sort(all.begin(), all.end());
+			for (int i = 0; i < threads * per_thread; ++i) {
+				REQUIRE(all[i] == i);
+			}
+		}
+	}
+}
@@ -0,0 +1,79 @@
+#include "catch.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <random>
+
+#include <pq/radix_heap.h>
+
+// Random monotone pushes and pops: pushed values are never larger than the
+// last top value
+template <typename T>
+static void check_against_std_pq(size_t steps, size_t seed, T start, T max_decrement) {
+	pq::radix_heap<T> heap;
+	std::priority_queue<T> reference;
+	std::mt19937_64 gen(seed);
+	T last = start;
+	for (size_t i = 0; i < steps; ++i) {
+		// more pushes than pops in the first half, the other way round after
+		const bool push = reference.empty() || (gen() % 100) < (i < steps / 2 ? 60u : 40u);
+		if (push) {
+			const T value = last - static_cast<T>(gen() % max_decrement);
+			heap.push(value);
+			reference.push(value);
+		} else {
+			REQUIRE(heap.top() == reference.top());
+			last = reference.top();
+			heap.pop();
+			reference.pop();
+		}
+		REQUIRE(heap.size() == reference.size());
+	}
+	while (!reference.empty()) {
+		REQUIRE(heap.top() == reference.top());
+		heap.pop();
+		reference.pop();
+	}
+	CHECK(heap.size() == 0);
+}
+
+SCENARIO("radix_heap behaves like std::priority_queue on monotone inputs", "[pq]") {
+	GIVEN("Monotone pushes and pops of ints with many duplicates") {
+		THEN("The radix heap agrees") {
+			check_against_std_pq<int>(100000, 42, 1000, 10);
+		}
+	}
+
+	GIVEN("Monotone pushes and pops of ints that cross zero") {
+		THEN("The radix heap agrees") {
+			check_against_std_pq<int>(100000, 43, 1 << 20, 1 << 10);
+		}
+	}
+
+	GIVEN("Monotone pushes and pops of 64-bit unsigned integers") {
+		THEN("The radix heap agrees") {
+			check_against_std_pq<uint64_t>(100000, 44,
+				std::numeric_limits<uint64_t>::max(), uint64_t(1) << 50);
+		}
+	}
+
+	GIVEN("A radix heap of arbitrary ints") {
+		pq::radix_heap<int> heap;
+		std::mt19937 gen(45);
+		std::priority_queue<int> reference;
+		for (int i = 0; i < 10000; ++i) {
+			const int value = static_cast<int>(gen());
+			heap.push(value);
+			reference.push(value);
+		}
+		THEN("Popping it yields them in descending order") {
+			while (!reference.empty()) {
+				REQUIRE(heap.top() == reference.top());
+				heap.pop();
+				reference.pop();
+			}
+			CHECK(heap.size() == 0);
+		}
+	}
+}
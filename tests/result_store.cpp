@@ -0,0 +1,218 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/archive/text_oarchive.hpp>
+
+#include <common/benchmark.h>
+#include <common/displacement.h>
+#include <common/instrumentation.h>
+#include <common/regression.h>
+#include <common/result_store.h>
+#include <hashtable/robin_hood.h>
+
+namespace {
+using Results = common::result_store::Results;
+
+// A finished aggregate of timer results with the given run times
+common::benchmark_result_aggregate timings(const std::string &benchmark, const std::string &instance,
+                                           const std::vector<double> &times)
+{
+	common::benchmark_result_aggregate aggregate(new common::timer_result(1e100),
+		new common::timer_result(), new common::timer_result(), new common::timer_result(),
+		new common::timer_result(), new common::timer_result());
+	for (double t : times) {
+		aggregate.add_result(new common::timer_result(t));
+	}
+	aggregate.finish();
+	aggregate.set_properties(benchmark, instance, 42, "timer");
+	return aggregate;
+}
+
+Results two_contenders(double factor) {
+	Results results(2);
+	for (int i = 0; i < 2; ++i) {
+		const std::string instance = "contender " + std::to_string(i);
+		results[i].push_back(timings("insert", instance, {10 * factor, 11 * factor, 12 * factor}));
+		results[i].push_back(timings("find", instance, {5 * factor}));
+	}
+	return results;
+}
+
+void destroy(Results &results) {
+	for (auto &ds_results : results) {
+		for (auto &res : ds_results) {
+			res.destroy();
+		}
+	}
+}
+}
+
+SCENARIO("result_store keeps results across appended runs", "[result_store]") {
+	const std::string fn = "result_store_test.bin";
+	GIVEN("A store written by one run") {
+		Results first = two_contenders(1);
+		common::result_store::write(fn, first);
+		REQUIRE(common::result_store::is_store(fn));
+
+		THEN("Loading it gives the same results") {
+			Results loaded;
+			REQUIRE(common::read_results(fn, loaded));
+			REQUIRE(loaded.size() == 2);
+			REQUIRE(loaded[1].size() == 2);
+			const auto &res = loaded[1][0];
+			CHECK(res.instance_desc() == "contender 1");
+			CHECK(res.benchmark_name() == "insert");
+			CHECK(res.configuration_desc() == "42");
+			CHECK(res.instrumentation_desc() == "timer");
+			CHECK(res.runs_components() == first[1][0].runs_components());
+			CHECK(res.medians() == first[1][0].medians());
+			CHECK(res.is_same_type(first[1][0]));
+			CHECK(loaded[0][1].runs_components().size() == 1);
+			destroy(loaded);
+		}
+
+		WHEN("A second run is appended") {
+			Results second = two_contenders(2);
+			common::result_store::append(fn, second);
+			THEN("Its results follow those of the first run") {
+				common::result_store store(fn);
+				CHECK(store.num_blocks() == 2);
+				Results loaded;
+				store.load(loaded);
+				REQUIRE(loaded.size() == 2);
+				REQUIRE(loaded[0].size() == 4);
+				CHECK(loaded[0][0].medians() == first[0][0].medians());
+				CHECK(loaded[0][2].medians() == second[0][0].medians());
+				CHECK(loaded[0][3].runs_components() == second[0][1].runs_components());
+				destroy(loaded);
+			}
+			destroy(second);
+		}
+
+		WHEN("The last block is cut off") {
+			Results second = two_contenders(2);
+			common::result_store::append(fn, second);
+			std::ifstream in(fn, std::ios::binary);
+			std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+			in.close();
+			std::ofstream(fn, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size() - 16);
+			THEN("The complete blocks can still be read") {
+				common::result_store store(fn);
+				CHECK(store.num_blocks() == 1);
+			}
+			destroy(second);
+		}
+		destroy(first);
+	}
+
+	GIVEN("A text archive of an older version") {
+		Results old = two_contenders(1);
+		{
+			std::ofstream out(fn);
+			boost::archive::text_oarchive oa(out);
+			oa << old;
+		}
+		THEN("It isn't a store, but can be read") {
+			CHECK_FALSE(common::result_store::is_store(fn));
+			Results loaded;
+			REQUIRE(common::read_results(fn, loaded));
+			CHECK(loaded[1][0].runs_components() == old[1][0].runs_components());
+			destroy(loaded);
+		}
+		destroy(old);
+	}
+	std::remove(fn.c_str());
+}
+
+SCENARIO("result_store keeps the displacement that a table reported", "[result_store]") {
+	const std::string fn = "result_store_test.bin";
+	GIVEN("A displacement instrumentation and a Robin Hood table") {
+		hashtable::robin_hood<int, int> map;
+		for (int i = 0; i < 1000; ++i) {
+			map[i] = i;
+		}
+		common::displacement_instrumentation instrumentation;
+		common::benchmark_result_aggregate aggregate(instrumentation.new_result(true),
+			instrumentation.new_result(), instrumentation.new_result(), instrumentation.new_result(),
+			instrumentation.new_result(), instrumentation.new_result());
+		instrumentation.setup();
+		common::instrumentation::active() = &instrumentation;
+		const hashtable::displacement_statistics &table = map;
+		common::report_displacement(table);
+		common::instrumentation::active() = nullptr;
+		aggregate.add_result(instrumentation.result());
+		aggregate.finish();
+		aggregate.set_properties("insert", "robin hood", 42, "displacement");
+
+		THEN("The stored result is the table's displacement") {
+			Results results(1);
+			results[0].emplace_back(std::move(aggregate));
+			common::result_store::write(fn, results);
+			Results loaded;
+			REQUIRE(common::read_results(fn, loaded));
+			REQUIRE(loaded[0].size() == 1);
+			const auto medians = loaded[0][0].medians();
+			CHECK(medians[0] == map.max_displacement());
+			CHECK(medians[1] == Approx(map.mean_displacement()));
+			CHECK(loaded[0][0].is_same_type(results[0][0]));
+			destroy(loaded);
+			destroy(results);
+		}
+	}
+	std::remove(fn.c_str());
+}
+
+SCENARIO("regression_check is only conclusive if it tested everything", "[result_store]") {
+	auto runs = [](double factor) {
+		std::vector<double> times;
+		for (int i = 0; i < 8; ++i) {
+			times.push_back((10 + i) * factor);
+		}
+		return times;
+	};
+
+	GIVEN("Results with enough runs to test") {
+		Results baseline(1), candidate(1);
+		baseline[0].push_back(timings("insert", "contender", runs(1)));
+		candidate[0].push_back(timings("insert", "contender", runs(2)));
+		common::regression_check check(baseline, candidate);
+		check.compare();
+		THEN("A slowdown is found and the check is conclusive") {
+			CHECK(check.regressions() == 1);
+			CHECK(check.conclusive());
+		}
+		destroy(baseline);
+		destroy(candidate);
+	}
+
+	GIVEN("Results with too few runs") {
+		Results baseline = two_contenders(1), candidate = two_contenders(2);
+		common::regression_check check(baseline, candidate);
+		check.compare();
+		THEN("Nothing is found, but the check isn't conclusive") {
+			CHECK(check.regressions() == 0);
+			CHECK_FALSE(check.conclusive());
+		}
+		destroy(baseline);
+		destroy(candidate);
+	}
+
+	GIVEN("A baseline with the same result twice, as in appended stores") {
+		Results baseline(1), candidate(1);
+		baseline[0].push_back(timings("insert", "contender", runs(1)));
+		baseline[0].push_back(timings("insert", "contender", runs(2)));
+		candidate[0].push_back(timings("insert", "contender", runs(2)));
+		common::regression_check check(baseline, candidate);
+		check.compare();
+		THEN("It isn't compared to either of them") {
+			CHECK(check.regressions() == 0);
+			CHECK_FALSE(check.conclusive());
+		}
+		destroy(baseline);
+		destroy(candidate);
+	}
+}
@@ -0,0 +1,76 @@
+#include "catch.hpp"
+#include "hashtable_reference.h"
+
+#include <hashtable/robin_hood.h>
+
+SCENARIO("robin_hood's basic functions work", "[hashtable]") {
+	GIVEN("A robin_hood table") {
+		hashtable::robin_hood<int, int> m;
+		const int n = 1000;
+		for (int i = 0; i < n; ++i) {
+			m[i] = i*i;
+		}
+
+		WHEN("We ask for the elements") {
+			THEN("Their values are correct") {
+				CHECK(m.size() == n);
+				CHECK(m[10] == 100);
+				CHECK(m.find(999) == just<int>(998001));
+				CHECK(m.find(n) == nothing<int>());
+			}
+		}
+
+		WHEN("We delete every other element") {
+			for (int i = 0; i < n; i += 2) {
+				CHECK(m.erase(i) == 1);
+			}
+			THEN("The others are still found after the backward shifts") {
+				CHECK(m.size() == n/2);
+				for (int i = 1; i < n; i += 2) {
+					REQUIRE(m.find(i) == just<int>(i*i));
+				}
+				CHECK(m.find(0) == nothing<int>());
+			}
+		}
+
+		WHEN("We look at the displacement statistics") {
+			THEN("They are within the load factor's bounds") {
+				CHECK(m.load_factor() <= 0.9);
+				CHECK(m.mean_displacement() <= m.max_displacement());
+				CHECK(m.max_displacement() < 100);
+			}
+		}
+
+		WHEN("We delete all elements") {
+			for (int i = 0; i < n; ++i) {
+				m.erase(i);
+			}
+			THEN("All displacements are gone") {
+				CHECK(m.size() == 0);
+				CHECK(m.max_displacement() == 0);
+			}
+		}
+	}
+}
+
+SCENARIO("robin_hood agrees with std::unordered_map", "[hashtable]") {
+	GIVEN("Random operations with many deletions") {
+		THEN("The default variant agrees") {
+			hashtable::robin_hood<int, int> m;
+			check_against_reference(m, 200000, 5000, 42);
+		}
+		AND_THEN("The 95% load variant agrees") {
+			hashtable::robin_hood<int, int, 95> m;
+			check_against_reference(m, 200000, 5000, 43);
+		}
+	}
+}
+
+SCENARIO("robin_hood's batch operations work", "[hashtable]") {
+	GIVEN("Batches of random keys") {
+		THEN("Batched inserts and lookups agree with std::unordered_map") {
+			hashtable::robin_hood<int, int> m;
+			check_batches(m, 20000, 44);
+		}
+	}
+}
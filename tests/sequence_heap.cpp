@@ -0,0 +1,78 @@
+#include "catch.hpp"
+
+#include <queue>
+#include <random>
+#include <string>
+
+#include <pq/sequence_heap.h>
+
+template <typename T, size_t BufferSize, size_t Arity, typename Generator>
+static void check_against_std_pq(size_t steps, size_t seed, Generator &&generate) {
+	pq::sequence_heap<T, BufferSize, Arity> heap;
+	std::priority_queue<T> reference;
+	std::mt19937 gen(seed);
+	for (size_t i = 0; i < steps; ++i) {
+		// more pushes than pops in the first half, the other way round after
+		const bool push = reference.empty() || (gen() % 100) < (i < steps / 2 ? 60u : 40u);
+		if (push) {
+			const T value = generate(gen);
+			heap.push(value);
+			reference.push(value);
+		} else {
+			REQUIRE(heap.top() == reference.top());
+			heap.pop();
+			reference.pop();
+		}
+		REQUIRE(heap.size() == reference.size());
+	}
+	while (!reference.empty()) {
+		REQUIRE(heap.top() == reference.top());
+		heap.pop();
+		reference.pop();
+	}
+	CHECK(heap.size() == 0);
+}
+
+SCENARIO("sequence_heap behaves like std::priority_queue", "[pq]") {
+	auto random_int = [](std::mt19937 &gen) { return static_cast<int>(gen() % 1000); };
+	auto wide_int = [](std::mt19937 &gen) { return static_cast<int>(gen() >> 1); };
+	GIVEN("Random pushes and pops of ints with many duplicates") {
+		THEN("A sequence heap with tiny buffers and many groups agrees") {
+			check_against_std_pq<int, 4, 2>(100000, 42, random_int);
+		}
+		AND_THEN("A sequence heap with small buffers agrees") {
+			check_against_std_pq<int, 16, 4>(100000, 43, random_int);
+		}
+		AND_THEN("The default sequence heap agrees") {
+			check_against_std_pq<int, 256, 64>(100000, 44, random_int);
+		}
+	}
+
+	GIVEN("Random pushes and pops of distinct ints") {
+		THEN("A sequence heap with small buffers agrees") {
+			check_against_std_pq<int, 8, 3>(200000, 45, wide_int);
+		}
+	}
+
+	GIVEN("Random pushes and pops of strings") {
+		THEN("A sequence heap with small buffers agrees") {
+			check_against_std_pq<std::string, 8, 4>(20000, 46, [](std::mt19937 &gen) {
+				return "value " + std::to_string(gen() % 5000);
+			});
+		}
+	}
+
+	GIVEN("A sequence heap that spans several groups") {
+		pq::sequence_heap<int, 8, 4> heap;
+		for (int i = 0; i < 10000; ++i) {
+			heap.push(i);
+		}
+		THEN("Popping it yields the elements in descending order") {
+			for (int i = 9999; i >= 0; --i) {
+				REQUIRE(heap.top() == i);
+				heap.pop();
+			}
+			CHECK(heap.size() == 0);
+		}
+	}
+}
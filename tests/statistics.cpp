@@ -0,0 +1,215 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <common/benchmark.h>
+#include <common/statistics.h>
+
+SCENARIO("Robust statistics of samples", "[statistics]") {
+	GIVEN("A small sample with an outlier") {
+		const std::vector<double> values{10, 11, 9, 10, 12, 10, 50};
+		THEN("Median and MAD ignore the outlier") {
+			CHECK(common::util::median(values) == 10);
+			CHECK(common::util::mad(values) == 1);
+			CHECK(common::util::median(std::vector<double>{4, 1, 3, 2}) == 2.5);
+		}
+		THEN("Only the outlier is rejected") {
+			const auto outliers = common::util::mad_outliers(values);
+			for (size_t i = 0; i + 1 < values.size(); ++i) {
+				CHECK_FALSE(outliers[i]);
+			}
+			CHECK(outliers.back());
+		}
+		THEN("The standard deviation is that of the sample") {
+			CHECK(common::util::stddev(std::vector<double>{2, 4, 4, 4, 5, 5, 7, 9}) ==
+				Approx(std::sqrt(32.0 / 7)));
+			CHECK(common::util::stddev(std::vector<double>{3}) == 0);
+		}
+	}
+
+	GIVEN("Normally distributed samples") {
+		std::mt19937 gen(42);
+		std::normal_distribution<double> normal(100, 5);
+		std::vector<double> small, large;
+		for (int i = 0; i < 10; ++i) small.push_back(normal(gen));
+		for (int i = 0; i < 1000; ++i) large.push_back(normal(gen));
+		THEN("The confidence interval of the median contains it and shrinks with more values") {
+			const auto s = common::util::median_confidence_interval(small),
+			           l = common::util::median_confidence_interval(large);
+			CHECK(s.first <= common::util::median(small));
+			CHECK(s.second >= common::util::median(small));
+			CHECK(l.first <= 100);
+			CHECK(l.second >= 100);
+			const double small_width = s.second - s.first, large_width = l.second - l.first;
+			CHECK(large_width < small_width);
+		}
+	}
+}
+
+SCENARIO("Mann-Whitney U test", "[statistics]") {
+	GIVEN("Small samples without ties") {
+		const std::vector<double> low{1, 2, 3, 4, 5}, high{6, 7, 8, 9, 10};
+		THEN("Completely separated samples get the exact p-value") {
+			// 2 of the 252 orderings are at least as extreme
+			CHECK(common::util::mann_whitney_u(low, high) == Approx(2.0 / 252));
+			CHECK(common::util::mann_whitney_u(high, low) == Approx(2.0 / 252));
+		}
+		THEN("Interleaved samples are not significant") {
+			CHECK(common::util::mann_whitney_u({1, 3, 5, 7, 9}, {2, 4, 6, 8, 10}) > 0.5);
+		}
+		THEN("Two runs each can't be significant") {
+			CHECK(common::util::mann_whitney_u_min(5, 5) == Approx(2.0 / 252));
+			CHECK(common::util::mann_whitney_u_min(2, 2) == Approx(1.0 / 3));
+		}
+	}
+	GIVEN("Samples with ties") {
+		THEN("Identical samples are not different at all") {
+			const std::vector<double> same(10, 42);
+			CHECK(common::util::mann_whitney_u(same, same) == 1);
+		}
+		THEN("Large shifted samples are significant") {
+			std::mt19937 gen(42);
+			std::normal_distribution<double> normal(100, 5);
+			std::vector<double> a, b;
+			for (int i = 0; i < 50; ++i) {
+				a.push_back(std::round(normal(gen)));
+				b.push_back(std::round(normal(gen)) + 10);
+			}
+			CHECK(common::util::mann_whitney_u(a, b) < 0.001);
+		}
+	}
+}
+
+SCENARIO("repetition_policy decides when to stop", "[statistics]") {
+	GIVEN("A fixed number of runs") {
+		common::repetition_policy policy(3);
+		THEN("It stops after exactly that many") {
+			CHECK_FALSE(policy.done({1, 2}, 0));
+			CHECK(policy.done({1, 2, 3}, 0));
+		}
+	}
+	GIVEN("An adaptive policy") {
+		auto policy = common::repetition_policy::adaptive(0.05, 1000, 5, 20);
+		THEN("Stable values stop after the minimum") {
+			CHECK_FALSE(policy.done({100, 100, 101, 100}, 0));
+			CHECK(policy.done({100, 100, 101, 100, 99}, 0));
+		}
+		THEN("Noisy values continue until the budget or the maximum") {
+			const std::vector<double> noisy{50, 150, 100, 70, 130, 90};
+			CHECK_FALSE(policy.done(noisy, 500));
+			CHECK(policy.done(noisy, 1000));
+			CHECK(policy.done(std::vector<double>(20, 1), 0));
+		}
+	}
+}
+
+namespace {
+// A result with two components
+class pair_result : public common::benchmark_result {
+public:
+	double a, b;
+	pair_result(double a = 0, double b = 0) : a(a), b(b) {}
+
+	bool is_same_type(common::benchmark_result*) const override { return true; }
+	void add(const common::benchmark_result *const other) override {
+		a += dynamic_cast<const pair_result*>(other)->a;
+		b += dynamic_cast<const pair_result*>(other)->b;
+	}
+	void min(const common::benchmark_result *const other) override {
+		a = std::min(a, dynamic_cast<const pair_result*>(other)->a);
+		b = std::min(b, dynamic_cast<const pair_result*>(other)->b);
+	}
+	void max(const common::benchmark_result *const other) override {
+		a = std::max(a, dynamic_cast<const pair_result*>(other)->a);
+		b = std::max(b, dynamic_cast<const pair_result*>(other)->b);
+	}
+	void div(const int divisor) override { a /= divisor; b /= divisor; }
+	std::vector<double> compare_to(const common::benchmark_result*) override { return {}; }
+	std::ostream& print_component(int, std::ostream &os) override { return os; }
+	std::ostream& print(std::ostream &os) const override { return os << a << ", " << b; }
+	std::ostream& result(std::ostream &os) const override { return os; }
+	std::vector<double> components() const override { return {a, b}; }
+	void set_components(const std::vector<double> &values) override { a = values[0]; b = values[1]; }
+};
+
+// A result with three components
+class triple_result : public common::benchmark_result {
+public:
+	double a, b, c;
+	triple_result(double a = 0, double b = 0, double c = 0) : a(a), b(b), c(c) {}
+
+	bool is_same_type(common::benchmark_result*) const override { return true; }
+	void add(const common::benchmark_result *const other) override {
+		auto o = dynamic_cast<const triple_result*>(other);
+		a += o->a; b += o->b; c += o->c;
+	}
+	void min(const common::benchmark_result *const other) override {
+		auto o = dynamic_cast<const triple_result*>(other);
+		a = std::min(a, o->a); b = std::min(b, o->b); c = std::min(c, o->c);
+	}
+	void max(const common::benchmark_result *const other) override {
+		auto o = dynamic_cast<const triple_result*>(other);
+		a = std::max(a, o->a); b = std::max(b, o->b); c = std::max(c, o->c);
+	}
+	void div(const int divisor) override { a /= divisor; b /= divisor; c /= divisor; }
+	std::vector<double> compare_to(const common::benchmark_result*) override { return {}; }
+	std::ostream& print_component(int, std::ostream &os) override { return os; }
+	std::ostream& print(std::ostream &os) const override { return os << a << ", " << b << ", " << c; }
+	std::ostream& result(std::ostream &os) const override { return os; }
+	std::vector<double> components() const override { return {a, b, c}; }
+	void set_components(const std::vector<double> &values) override {
+		a = values[0]; b = values[1]; c = values[2];
+	}
+};
+}
+
+SCENARIO("benchmark_result_aggregate leaves out outliers", "[statistics]") {
+	GIVEN("Runs of which one is an outlier in the second component") {
+		common::benchmark_result_aggregate aggregate(new pair_result(1e100, 1e100), new pair_result(),
+			new pair_result(), new pair_result(), new pair_result(), new pair_result());
+		const double as[] = {10, 11, 9, 10, 12, 10}, bs[] = {5, 5, 6, 5, 100, 4};
+		for (int i = 0; i < 6; ++i) {
+			aggregate.add_result(new pair_result(as[i], bs[i]));
+		}
+		aggregate.finish();
+		THEN("The statistics are those of the other runs") {
+			auto avg = dynamic_cast<const pair_result*>(aggregate.average());
+			auto max = dynamic_cast<const pair_result*>(aggregate.maximum());
+			auto median = dynamic_cast<const pair_result*>(aggregate.med());
+			CHECK(avg->a == Approx(10));
+			CHECK(avg->b == Approx(5));
+			CHECK(max->a == 11);
+			CHECK(max->b == 6);
+			CHECK(median->a == 10);
+			CHECK(median->b == 5);
+			CHECK(aggregate.runs_components().size() == 6);
+		}
+		aggregate.destroy();
+	}
+}
+
+SCENARIO("benchmark_result_aggregate finds outliers in every component", "[statistics]") {
+	GIVEN("Runs with an outlier in the first component and another one in the second") {
+		common::benchmark_result_aggregate aggregate(new triple_result(1e100, 1e100, 1e100), new triple_result(),
+			new triple_result(), new triple_result(), new triple_result(), new triple_result());
+		const double as[] = {10, 11, 9, 10, 100, 10, 12, 10},
+		             bs[] = {5, 6, 4, 5, 7, 500, 6, 5},
+		             cs[] = {1, 2, 1, 1, 1, 1, 2, 1};
+		for (int i = 0; i < 8; ++i) {
+			aggregate.add_result(new triple_result(as[i], bs[i], cs[i]));
+		}
+		aggregate.finish();
+		THEN("Both are left out, and only they") {
+			auto avg = dynamic_cast<const triple_result*>(aggregate.average());
+			auto max = dynamic_cast<const triple_result*>(aggregate.maximum());
+			CHECK(avg->a == Approx(62.0 / 6));
+			CHECK(avg->b == Approx(31.0 / 6));
+			CHECK(max->a == 12);
+			CHECK(max->b == 6);
+			CHECK(max->c == 2);
+		}
+		aggregate.destroy();
+	}
+}
@@ -0,0 +1,86 @@
+#include "catch.hpp"
+#include "hashtable_reference.h"
+
+#include <hashtable/swiss_table.h>
+
+SCENARIO("swiss_table's basic functions work", "[hashtable]") {
+	GIVEN("A swiss_table") {
+		hashtable::swiss_table<int, int> m;
+		const int n = 1000;
+		for (int i = 0; i < n; ++i) {
+			m[i] = i*i;
+		}
+
+		WHEN("We ask for the elements") {
+			THEN("Their values are correct") {
+				CHECK(m.size() == n);
+				CHECK(m[0] == 0);
+				CHECK(m[10] == 100);
+				CHECK(m.find(999) == just<int>(998001));
+				CHECK(m.find(n) == nothing<int>());
+			}
+		}
+
+		WHEN("We delete and re-insert elements") {
+			for (int i = 0; i < n; i += 2) {
+				CHECK(m.erase(i) == 1);
+			}
+			CHECK(m.erase(0) == 0);
+			THEN("Only the remaining ones are found") {
+				CHECK(m.size() == n/2);
+				CHECK(m.find(0) == nothing<int>());
+				CHECK(m.find(1) == just<int>(1));
+			}
+			AND_THEN("Re-inserting reuses the freed slots") {
+				for (int i = 0; i < n; i += 2) {
+					m[i] = -i;
+				}
+				CHECK(m.size() == n);
+				CHECK(m.find(2) == just<int>(-2));
+			}
+		}
+
+		WHEN("We clear it") {
+			m.clear();
+			THEN("It is empty and can be reused") {
+				CHECK(m.size() == 0);
+				CHECK(m.find(1) == nothing<int>());
+				m[1] = 2;
+				CHECK(m.find(1) == just<int>(2));
+			}
+		}
+	}
+
+	GIVEN("A swiss_table with string keys") {
+		hashtable::swiss_table<std::string, std::string> m;
+		m["foo"] = "oof";
+		m["bar"] = "rab";
+		m.erase("foo");
+		THEN("Erased keys are gone and the others remain") {
+			CHECK(m.find("foo") == nothing<std::string>());
+			CHECK(m.find("bar") == just<std::string>("rab"));
+		}
+	}
+}
+
+SCENARIO("swiss_table agrees with std::unordered_map", "[hashtable]") {
+	GIVEN("Random operations with many deletions") {
+		THEN("The SSE2 variant agrees") {
+			hashtable::swiss_table<int, int> m;
+			check_against_reference(m, 200000, 5000, 42);
+		}
+		AND_THEN("The portable variant agrees") {
+			hashtable::swiss_table<int, int, hashtable::swiss::portable_group> m;
+			check_against_reference(m, 200000, 5000, 43);
+		}
+	}
+}
+
+SCENARIO("swiss_table's batch operations work", "[hashtable]") {
+	GIVEN("Batches of random keys") {
+		THEN("Batched inserts and lookups agree with std::unordered_map") {
+			hashtable::swiss_table<int, int> m;
+			check_batches(m, 20000, 44);
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <common/tokenizer.h>
+
+namespace {
+std::vector<std::string> tokens_of(const std::string &text) {
+	std::vector<std::string> tokens;
+	common::util::for_each_token(text.data(), text.data() + text.size(),
+		[&tokens](common::string_view token) {
+			tokens.emplace_back(token.data(), token.size());
+		});
+	return tokens;
+}
+
+std::vector<std::string> read_tokens(const std::string &text) {
+	std::istringstream in(text);
+	std::vector<std::string> tokens;
+	std::string token;
+	while (in >> token) tokens.push_back(token);
+	return tokens;
+}
+}
+
+SCENARIO("for_each_token splits at whitespace like a stream", "[tokenizer]") {
+	GIVEN("Some simple texts") {
+		CHECK(tokens_of("").empty());
+		CHECK(tokens_of(" \t\n").empty());
+		CHECK(tokens_of("a") == std::vector<std::string>{"a"});
+		CHECK(tokens_of("  Als Gregor\r\nSamsa\teines  ") ==
+		      (std::vector<std::string>{"Als", "Gregor", "Samsa", "eines"}));
+	}
+	GIVEN("Random texts with all whitespace characters and long tokens") {
+		// Tokens and gaps across 64-byte blocks, and bytes >= 0x80
+		const std::string alphabet = " \t\n\v\f\rab\x7f\x80\xff";
+		std::mt19937 gen(42);
+		for (size_t length : {1, 15, 16, 17, 63, 64, 65, 127, 128, 200, 1000}) {
+			for (int run = 0; run < 20; ++run) {
+				std::string text;
+				std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1), span(1, 80);
+				while (text.size() < length) {
+					text.append(span(gen), alphabet[pick(gen)]);
+				}
+				text.resize(length);
+				CHECK(tokens_of(text) == read_tokens(text));
+			}
+		}
+	}
+}
+
+SCENARIO("mapped_file maps a file", "[tokenizer]") {
+	const std::string fn = "tokenizer_test.txt";
+	std::ofstream(fn) << "to be or not to be\n";
+	{
+		common::mapped_file file(fn);
+		REQUIRE(file.size() == 19);
+		CHECK(std::string(file.begin(), file.end()) == "to be or not to be\n");
+	}
+	std::ofstream(fn, std::ios::trunc).flush();
+	THEN("An empty file has no tokens") {
+		common::mapped_file file(fn);
+		CHECK(file.size() == 0);
+		size_t tokens = 0;
+		common::util::for_each_token(file.begin(), file.end(), [&tokens](common::string_view) { ++tokens; });
+		CHECK(tokens == 0);
+	}
+	std::remove(fn.c_str());
+	THEN("A missing file throws") {
+		CHECK_THROWS_AS(common::mapped_file("no_such_file.txt"), const std::invalid_argument &);
+	}
+}
@@ -1,4 +1,5 @@
 #include "catch.hpp"
+#include "hashtable_reference.h"
 
 #include <hashtable/unordered_map.h>
 
@@ -134,3 +135,30 @@ SCENARIO("unordered_map with string keys or values", "[hashtable]") {
 		}
 	}
 }
+
+SCENARIO("unordered_map's for_each visits every element", "[hashtable]") {
+	GIVEN("An unordered_map with some elements erased") {
+		hashtable::unordered_map<int, int> m;
+		std::unordered_map<int, int> ref;
+		for (int i = 1; i <= 1000; ++i) {
+			m[i] = 3 * i;
+			ref[i] = 3 * i;
+		}
+		for (int i = 1; i <= 1000; i += 7) {
+			m.erase(i);
+			ref.erase(i);
+		}
+		THEN("It visits exactly the remaining ones") {
+			check_for_each(m, ref);
+		}
+	}
+}
+
+SCENARIO("unordered_map's default batch operations work", "[hashtable]") {
+	GIVEN("Batches of random keys") {
+		THEN("Batched inserts and lookups agree with std::unordered_map") {
+			hashtable::unordered_map<int, int> m;
+			check_batches(m, 20000, 45);
+		}
+	}
+}